@@ -0,0 +1,107 @@
+/*
+ * Method IDs handled by WMBB in dsdt.dsl, line 9147.
+ * Generated by tools/wmiextract/wmbbgen; do not edit.
+ */
+
+#ifndef CLEVO_WMBB_H
+#define CLEVO_WMBB_H
+
+#define WMBB_CAP_PRESENT	0x01	/* handled by the method */
+#define WMBB_CAP_NOOP		0x02	/* handled, but does nothing */
+#define WMBB_CAP_ARG		0x04	/* uses its input argument */
+#define WMBB_CAP_RESULT		0x08	/* sets the value returned */
+#define WMBB_CAP_EC_READ	0x10	/* reads EC registers */
+#define WMBB_CAP_EC_WRITE	0x20	/* writes EC registers */
+#define WMBB_CAP_GATED		0x40	/* depends on a platform flag */
+#define WMBB_CAP_SUBFUNC	0x80	/* has sub-functions of its own */
+
+#define WMBB_NUM_IDS		26
+#define WMBB_MAX_ID		0x6A
+
+/* capabilities of each ID handled, for #if */
+#define WMBB_CAPS_01		(WMBB_CAP_PRESENT | WMBB_CAP_NOOP)
+#define WMBB_CAPS_05		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_06		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_07		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_09		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT)
+#define WMBB_CAPS_0A		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_11		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT)
+#define WMBB_CAPS_13		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_1E		(WMBB_CAP_PRESENT | WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_21		(WMBB_CAP_PRESENT | WMBB_CAP_EC_READ | \
+				 WMBB_CAP_EC_WRITE | WMBB_CAP_GATED)
+#define WMBB_CAPS_22		(WMBB_CAP_PRESENT | WMBB_CAP_EC_READ | \
+				 WMBB_CAP_EC_WRITE | WMBB_CAP_GATED)
+#define WMBB_CAPS_2A		(WMBB_CAP_PRESENT | WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_32		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ | WMBB_CAP_GATED)
+#define WMBB_CAPS_33		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT)
+#define WMBB_CAPS_34		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT)
+#define WMBB_CAPS_45		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_READ)
+#define WMBB_CAPS_46		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_4A		(WMBB_CAP_PRESENT | WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_4C		(WMBB_CAP_PRESENT | WMBB_CAP_EC_READ | \
+				 WMBB_CAP_EC_WRITE | WMBB_CAP_GATED)
+#define WMBB_CAPS_4F		(WMBB_CAP_PRESENT | WMBB_CAP_ARG | \
+				 WMBB_CAP_RESULT | WMBB_CAP_EC_WRITE | \
+				 WMBB_CAP_SUBFUNC)
+#define WMBB_CAPS_52		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT)
+#define WMBB_CAPS_55		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_5E		(WMBB_CAP_PRESENT | WMBB_CAP_EC_WRITE)
+#define WMBB_CAPS_62		(WMBB_CAP_PRESENT | WMBB_CAP_RESULT | \
+				 WMBB_CAP_GATED)
+#define WMBB_CAPS_67		(WMBB_CAP_PRESENT | WMBB_CAP_ARG | \
+				 WMBB_CAP_RESULT | WMBB_CAP_EC_WRITE | \
+				 WMBB_CAP_SUBFUNC)
+#define WMBB_CAPS_6A		(WMBB_CAP_PRESENT | WMBB_CAP_ARG | \
+				 WMBB_CAP_EC_WRITE)
+
+/* the IDs handled, in order */
+static const unsigned short wmbb_ids[WMBB_NUM_IDS] = {
+	0x01, 0x05, 0x06, 0x07, 0x09, 0x0A, 0x11, 0x13,
+	0x1E, 0x21, 0x22, 0x2A, 0x32, 0x33, 0x34, 0x45,
+	0x46, 0x4A, 0x4C, 0x4F, 0x52, 0x55, 0x5E, 0x62,
+	0x67, 0x6A,
+};
+
+/* capabilities by ID, 0 for an ID that isn't handled */
+static const unsigned char wmbb_caps[WMBB_MAX_ID + 1] = {
+	[0x01] = WMBB_CAPS_01,	/* line 9160 */
+	[0x05] = WMBB_CAPS_05,	/* line 9163 */
+	[0x06] = WMBB_CAPS_06,	/* line 9183 */
+	[0x07] = WMBB_CAPS_07,	/* line 9203 */
+	[0x09] = WMBB_CAPS_09,	/* line 9223 */
+	[0x0A] = WMBB_CAPS_0A,	/* line 9236 */
+	[0x11] = WMBB_CAPS_11,	/* line 9256 */
+	[0x13] = WMBB_CAPS_13,	/* line 9269 */
+	[0x1E] = WMBB_CAPS_1E,	/* line 9282 */
+	[0x21] = WMBB_CAPS_21,	/* line 9290 */
+	[0x22] = WMBB_CAPS_22,	/* line 9301 */
+	[0x2A] = WMBB_CAPS_2A,	/* line 9312 */
+	[0x32] = WMBB_CAPS_32,	/* line 9320 */
+	[0x33] = WMBB_CAPS_33,	/* line 9333 */
+	[0x34] = WMBB_CAPS_34,	/* line 9339 */
+	[0x45] = WMBB_CAPS_45,	/* line 9363 */
+	[0x46] = WMBB_CAPS_46,	/* line 9426 */
+	[0x4A] = WMBB_CAPS_4A,	/* line 9345 */
+	[0x4C] = WMBB_CAPS_4C,	/* line 9369 */
+	[0x4F] = WMBB_CAPS_4F,	/* line 9380 */
+	[0x52] = WMBB_CAPS_52,	/* line 9413 */
+	[0x55] = WMBB_CAPS_55,	/* line 9419 */
+	[0x5E] = WMBB_CAPS_5E,	/* line 9435 */
+	[0x62] = WMBB_CAPS_62,	/* line 9443 */
+	[0x67] = WMBB_CAPS_67,	/* line 9465 */
+	[0x6A] = WMBB_CAPS_6A,	/* line 9352 */
+};
+
+#define wmbb_has(id)	((unsigned int)(id) <= WMBB_MAX_ID && wmbb_caps[id])
+
+#endif
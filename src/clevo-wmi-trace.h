@@ -0,0 +1,90 @@
+/*
+ *  clevo-wmi-trace.h
+ *
+ *  Tracepoints for each request clevo-wmi makes of the firmware, with
+ *  how long it took: perf trace -e 'clevo_wmi:*', or
+ *  /sys/kernel/debug/tracing/events/clevo_wmi.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM clevo_wmi
+
+#if !defined(_CLEVO_WMI_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _CLEVO_WMI_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(clevo_wmbb,
+
+	TP_PROTO(u32 method_id, u32 arg, u32 result, int err, u64 ns),
+
+	TP_ARGS(method_id, arg, result, err, ns),
+
+	TP_STRUCT__entry(
+		__field(u32, method_id)
+		__field(u32, arg)
+		__field(u32, result)
+		__field(int, err)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+		__entry->method_id = method_id;
+		__entry->arg       = arg;
+		__entry->result    = result;
+		__entry->err       = err;
+		__entry->ns        = ns;
+	),
+
+	TP_printk("method=0x%02x arg=%#x result=%#x err=%d ns=%llu",
+	          __entry->method_id, __entry->arg, __entry->result,
+	          __entry->err, (unsigned long long) __entry->ns)
+);
+
+DECLARE_EVENT_CLASS(clevo_ec,
+
+	TP_PROTO(u8 addr, u8 val, int err, u64 ns),
+
+	TP_ARGS(addr, val, err, ns),
+
+	TP_STRUCT__entry(
+		__field(u8, addr)
+		__field(u8, val)
+		__field(int, err)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+		__entry->addr = addr;
+		__entry->val  = val;
+		__entry->err  = err;
+		__entry->ns   = ns;
+	),
+
+	TP_printk("addr=0x%02x val=0x%02x err=%d ns=%llu",
+	          __entry->addr, __entry->val, __entry->err,
+	          (unsigned long long) __entry->ns)
+);
+
+DEFINE_EVENT(clevo_ec, clevo_ec_read,
+	TP_PROTO(u8 addr, u8 val, int err, u64 ns),
+	TP_ARGS(addr, val, err, ns)
+);
+
+DEFINE_EVENT(clevo_ec, clevo_ec_write,
+	TP_PROTO(u8 addr, u8 val, int err, u64 ns),
+	TP_ARGS(addr, val, err, ns)
+);
+
+#endif /* _CLEVO_WMI_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE clevo-wmi-trace
+#include <trace/define_trace.h>
@@ -30,85 +30,1110 @@
 #define CLEVO_WMI_VER "0.1"
 #define CLEVO_WMI_NAME KBUILD_MODNAME
 
+#include <acpi/button.h>
 #include <linux/acpi.h>
+#include <linux/atomic.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dmi.h>
+#include <linux/hrtimer.h>
 #include <linux/input.h>
+#include <linux/input/sparse-keymap.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/leds.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/notifier.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/workqueue.h>
 
+#include "clevo-wmbb.h"
+
+#define CREATE_TRACE_POINTS
+#include "clevo-wmi-trace.h"
+
 MODULE_AUTHOR("Ash Hughes <ashley.hughes@blueyonder.co.uk>");
 MODULE_DESCRIPTION("Clevo WMI Driver");
 MODULE_LICENSE("GPL");
 MODULE_VERSION(CLEVO_WMI_VER);
 
-struct clevo_wmi
-{
-	struct workqueue_struct *led_workqueue;
-}
+#define CLEVO_EVENT_GUID  "ABBC0F6B-8EA1-11D1-00A0-C90629100000"
+#define CLEVO_GET_GUID    "ABBC0F6D-8EA1-11D1-00A0-C90629100000"
+
+/*
+ * method IDs for CLEVO_GET; clevo-wmbb.h, generated from the DSDT with
+ * make wmbb, says which of them its WMBB handles
+ */
+#define GET_EVENT		0x01
+#define GET_AP			0x46
+
+#ifndef WMBB_CAPS_01
+#error "WMBB has no GET_EVENT (0x01): regenerate clevo-wmbb.h from this machine's DSDT"
+#endif
+
+/* the notify value of CLEVO_EVENT, and what GET_EVENT returns then */
+#define CLEVO_WMI_EVENT		0xD0
+#define CLEVO_EVENT_AIRPLANE	0xF4
+
+#define EC_AIRPLANE_LED		0xD9
+#define EC_AIRPLANE_LED_BIT	0x40
+#define EC_RINF			0xDB
+#define EC_RINF_AIRPLANE	0x40
+
+#define POLL_FREQ_MIN     1
+#define POLL_FREQ_MAX     20
+#define POLL_FREQ_DEFAULT 20
+#define POLL_IDLE_MS      2000
 
-static struct workqueue_struct *led_workqueue;
+static unsigned char param_poll_freq = POLL_FREQ_DEFAULT;
+module_param_named(poll_freq, param_poll_freq, byte, S_IRUSR);
+MODULE_PARM_DESC(poll_freq, "Hotkey polling frequency after activity, where the EC has no query methods");
+
+/* one ordered queue for all the driver's EC work */
+static struct workqueue_struct *clevo_workqueue;
 struct platform_device *clevo_platform_device;
 
-static int clevo_wmi_probe(struct platform_device *dev)
+
+/*
+ * Everything the driver asks of the firmware goes through clevo_ec_read(),
+ * clevo_ec_write() and clevo_wmbb(), which count and time each request.
+ * tools/wmisim stands in for the firmware by providing ec_read(),
+ * ec_write() and wmi_evaluate_method() itself.
+ */
+static int clevo_acpi_wmbb(u32 method_id, u32 arg, u32 *retval)
 {
+	struct acpi_buffer in  = { (acpi_size) sizeof(arg), &arg };
+	struct acpi_buffer out = { ACPI_ALLOCATE_BUFFER, NULL };
+	union acpi_object *obj;
+	acpi_status status;
+
+	status = wmi_evaluate_method(CLEVO_GET_GUID, 0x01,
+	                             method_id, &in, &out);
+	if (unlikely(ACPI_FAILURE(status)))
+		return -EIO;
+
+	obj = (union acpi_object *) out.pointer;
+	if (retval)
+		*retval = obj && obj->type == ACPI_TYPE_INTEGER ?
+		          (u32) obj->integer.value : 0;
+
+	kfree(obj);
 	return 0;
 }
 
-static int clevo_wmi_remove(struct platform_device *dev)
+enum clevo_op {
+	CLEVO_OP_EC_READ,
+	CLEVO_OP_EC_WRITE,
+	CLEVO_OP_WMBB,
+	CLEVO_OP_MAX,
+};
+
+static const char * const clevo_op_names[CLEVO_OP_MAX] = {
+	[CLEVO_OP_EC_READ]  = "ec_read",
+	[CLEVO_OP_EC_WRITE] = "ec_write",
+	[CLEVO_OP_WMBB]     = "wmbb",
+};
+
+static struct clevo_op_stats {
+	atomic_long_t calls;
+	atomic_long_t errors;
+	atomic64_t ns;
+} clevo_stats[CLEVO_OP_MAX];
+
+/*
+ * How long the requests took, by WMBB method ID and by EC register, in
+ * log2 buckets: under 1 us, 1-2 us, 2-4 us and so on, the last taking
+ * everything from 65 ms up. debugfs clevo_wmi/latency shows them.
+ */
+#define CLEVO_HIST_BUCKETS	18
+
+struct clevo_hist {
+	atomic_t bucket[CLEVO_HIST_BUCKETS];
+};
+
+static struct {
+	struct clevo_hist wmbb[WMBB_MAX_ID + 1];
+	struct clevo_hist ec_read[256];
+	struct clevo_hist ec_write[256];
+} clevo_latency;
+
+static u64 clevo_account(enum clevo_op op, ktime_t start, int err,
+                         struct clevo_hist *hist)
+{
+	struct clevo_op_stats *s = &clevo_stats[op];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned int bucket = 0;
+
+	atomic_long_inc(&s->calls);
+	if (err)
+		atomic_long_inc(&s->errors);
+	atomic64_add(ns, &s->ns);
+
+	if (ns >= 1024)
+		bucket = min_t(unsigned int, ilog2(ns) - 9, CLEVO_HIST_BUCKETS - 1);
+	atomic_inc(&hist->bucket[bucket]);
+	return ns;
+}
+
+static int clevo_ec_read(u8 addr, u8 *val)
+{
+	ktime_t start = ktime_get();
+	int err = ec_read(addr, val);
+	u64 ns = clevo_account(CLEVO_OP_EC_READ, start, err,
+	                       &clevo_latency.ec_read[addr]);
+
+	trace_clevo_ec_read(addr, err ? 0 : *val, err, ns);
+	return err;
+}
+
+static int clevo_ec_write(u8 addr, u8 val)
+{
+	ktime_t start = ktime_get();
+	int err = ec_write(addr, val);
+	u64 ns = clevo_account(CLEVO_OP_EC_WRITE, start, err,
+	                       &clevo_latency.ec_write[addr]);
+
+	trace_clevo_ec_write(addr, val, err, ns);
+	return err;
+}
+
+/* an ID the DSDT's WMBB doesn't handle isn't called at all */
+static int clevo_wmbb(u32 method_id, u32 arg, u32 *retval)
+{
+	ktime_t start;
+	int err;
+	u64 ns;
+
+	if (!wmbb_has(method_id))
+		return -EOPNOTSUPP;
+
+	start = ktime_get();
+	err = clevo_acpi_wmbb(method_id, arg, retval);
+	ns = clevo_account(CLEVO_OP_WMBB, start, err,
+	                   &clevo_latency.wmbb[method_id]);
+
+	trace_clevo_wmbb(method_id, arg, !err && retval ? *retval : 0, err, ns);
+	return err;
+}
+
+
+/*
+ * A copy of the EC RAM bytes the driver uses, so that a read doesn't
+ * always take an EC transaction. How each byte may be cached depends on
+ * who changes it (see code-dump/clevo-wmi/Clevo_B7130-EC_RAM.txt):
+ *
+ *   volatile       the EC changes it at any time: always read
+ *   write-through  only the driver changes it: kept until resume, and
+ *                  a write updates the copy (or drops it if it fails)
+ *
+ * A byte that isn't listed is volatile.
+ */
+enum clevo_ec_class {
+	CLEVO_EC_VOLATILE,
+	CLEVO_EC_WRITE_THROUGH,
+};
+
+static const u8 clevo_ec_class[256] = {
+	/* unnamed in the map; the EC leaves the LED as it was set */
+	[EC_AIRPLANE_LED] = CLEVO_EC_WRITE_THROUGH,
+	/* RINF: the GPU state, and the hotkey bit the EC sets */
+	[EC_RINF]         = CLEVO_EC_VOLATILE,
+};
+
+static struct {
+	struct mutex lock;
+	u8 val[256];
+	DECLARE_BITMAP(valid, 256);
+	atomic_long_t hits;
+	atomic_long_t misses;
+	atomic_long_t invalidations;
+} clevo_ec_cache = {
+	.lock = __MUTEX_INITIALIZER(clevo_ec_cache.lock),
+};
+
+/* read an EC byte, from the copy if it may be cached; call with the lock held */
+static int __clevo_ec_get(u8 addr, u8 *val)
+{
+	int err;
+
+	if (clevo_ec_class[addr] == CLEVO_EC_VOLATILE)
+		return clevo_ec_read(addr, val);
+
+	if (test_bit(addr, clevo_ec_cache.valid)) {
+		*val = clevo_ec_cache.val[addr];
+		atomic_long_inc(&clevo_ec_cache.hits);
+		return 0;
+	}
+
+	atomic_long_inc(&clevo_ec_cache.misses);
+	err = clevo_ec_read(addr, val);
+	if (!err) {
+		clevo_ec_cache.val[addr] = *val;
+		set_bit(addr, clevo_ec_cache.valid);
+	}
+
+	return err;
+}
+
+/* write an EC byte, and keep or drop the copy as its class says; lock held too */
+static int __clevo_ec_set(u8 addr, u8 val)
+{
+	int err;
+
+	err = clevo_ec_write(addr, val);
+	if (clevo_ec_class[addr] == CLEVO_EC_VOLATILE)
+		return err;
+
+	if (!err && clevo_ec_class[addr] == CLEVO_EC_WRITE_THROUGH) {
+		clevo_ec_cache.val[addr] = val;
+		set_bit(addr, clevo_ec_cache.valid);
+	} else {
+		clear_bit(addr, clevo_ec_cache.valid);
+	}
+
+	return err;
+}
+
+static int clevo_ec_get(u8 addr, u8 *val)
+{
+	int err;
+
+	if (clevo_ec_class[addr] == CLEVO_EC_VOLATILE)
+		return clevo_ec_read(addr, val);
+
+	mutex_lock(&clevo_ec_cache.lock);
+	err = __clevo_ec_get(addr, val);
+	mutex_unlock(&clevo_ec_cache.lock);
+
+	return err;
+}
+
+/* forget the copy on resume, as the EC may have been reset */
+static void clevo_ec_invalidate(void)
+{
+	mutex_lock(&clevo_ec_cache.lock);
+	bitmap_zero(clevo_ec_cache.valid, 256);
+	mutex_unlock(&clevo_ec_cache.lock);
+
+	atomic_long_inc(&clevo_ec_cache.invalidations);
+}
+
+
+/*
+ * Changes to bits of EC bytes, from any context: each is queued as the
+ * bits to change and the values to give them, and one worker makes
+ * them. However many changes to a byte come in before it runs, they
+ * cost one read-modify-write, made with the cache lock held so that
+ * nothing gets in between the read and the write.
+ */
+static struct {
+	spinlock_t lock;
+	u8 mask[256];
+	u8 bits[256];
+	DECLARE_BITMAP(pending, 256);
+	struct work_struct work;
+	atomic_long_t updates;
+	atomic_long_t merged;
+	atomic_long_t writes;
+} clevo_ec_rmw = {
+	.lock = __SPIN_LOCK_UNLOCKED(clevo_ec_rmw.lock),
+};
+
+static void clevo_ec_update_bits(u8 addr, u8 mask, u8 bits)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&clevo_ec_rmw.lock, flags);
+	if (test_and_set_bit(addr, clevo_ec_rmw.pending))
+		atomic_long_inc(&clevo_ec_rmw.merged);
+	clevo_ec_rmw.bits[addr] = (clevo_ec_rmw.bits[addr] & ~mask) | (bits & mask);
+	clevo_ec_rmw.mask[addr] |= mask;
+	spin_unlock_irqrestore(&clevo_ec_rmw.lock, flags);
+
+	atomic_long_inc(&clevo_ec_rmw.updates);
+	queue_work(clevo_workqueue, &clevo_ec_rmw.work);
+}
+
+static void clevo_ec_rmw_one(u8 addr, u8 mask, u8 bits)
+{
+	u8 old, new;
+
+	mutex_lock(&clevo_ec_cache.lock);
+	if (!__clevo_ec_get(addr, &old)) {
+		new = (old & ~mask) | bits;
+		if (new != old) {
+			__clevo_ec_set(addr, new);
+			atomic_long_inc(&clevo_ec_rmw.writes);
+		}
+	}
+	mutex_unlock(&clevo_ec_cache.lock);
+}
+
+static void clevo_ec_rmw_work(struct work_struct *work)
 {
+	unsigned long flags;
+	unsigned int addr;
+	u8 mask, bits;
+
+	spin_lock_irqsave(&clevo_ec_rmw.lock, flags);
+	while ((addr = find_first_bit(clevo_ec_rmw.pending, 256)) < 256) {
+		clear_bit(addr, clevo_ec_rmw.pending);
+		mask = clevo_ec_rmw.mask[addr];
+		bits = clevo_ec_rmw.bits[addr] & mask;
+		clevo_ec_rmw.mask[addr] = 0;
+		spin_unlock_irqrestore(&clevo_ec_rmw.lock, flags);
+
+		clevo_ec_rmw_one(addr, mask, bits);
+
+		spin_lock_irqsave(&clevo_ec_rmw.lock, flags);
+	}
+	spin_unlock_irqrestore(&clevo_ec_rmw.lock, flags);
+}
+
+
+/*
+ * Hotkey events, as GET_EVENT decodes them or the poller finds them,
+ * are put on a ring and reported to the input core by a worker, so that
+ * neither the WMI notify handler (or the drain work it schedules) nor
+ * the poller waits on it. The notify handler runs in ACPI's notify
+ * context, alongside the poll work on the driver's workqueue, so
+ * producers claim a slot by moving the head on with a cmpxchg, and each
+ * slot has a sequence number that says whether it is free or filled (as
+ * in Vyukov's bounded queue): the worker is the only consumer, and
+ * needs no lock either.
+ *
+ * Each event carries its source and when it was found, and the time
+ * window is the dedupe: the worker drops a press less than POLL_IDLE_MS
+ * after one from the other source, the same press found by both the
+ * poller and the firmware. Events from one source aren't deduplicated;
+ * each is found once, and the ring keeps them in order.
+ */
+enum clevo_source {
+	CLEVO_SOURCE_WMI,
+	CLEVO_SOURCE_POLL,
+	CLEVO_SOURCE_MAX,
+};
+
+struct clevo_event {
+	u8 source;
+	u8 code;		/* what GET_EVENT returns, never 0 */
+	ktime_t time;
+};
+
+#define CLEVO_RING_SIZE 16	/* a power of two */
+
+static struct {
+	struct {
+		atomic_t seq;
+		struct clevo_event event;
+	} slot[CLEVO_RING_SIZE];
+	atomic_t head;
+	unsigned int tail;	/* the worker's */
+	struct work_struct work;
+	atomic_long_t queued;
+	atomic_long_t dropped;
+	atomic_long_t duplicates;
+	atomic_long_t unknown;
+	atomic_long_t reported;
+	atomic_long_t batches;
+} clevo_ring;
+
+/*
+ * What GET_EVENT returns depends on the firmware. A WMBB that does
+ * nothing for it (WMBB_CAP_NOOP) only returns EVNT, which each _Qxx
+ * method sets before it notifies and no read clears: a notify takes
+ * exactly one event, there and then, before the next _Qxx can set
+ * another. Asked again, it would return the same event again.
+ *
+ * One that does something for it may keep events queued, faster than a
+ * key repeats, and needn't notify each one: a notify schedules a drain,
+ * which takes events with GET_EVENT until it returns none, and the
+ * notifies that come before it runs are covered by it. The ring's worker
+ * runs after the drain, on the same ordered workqueue, and reports all
+ * it took with one input_sync.
+ */
+#define CLEVO_EVENT_LATCHED	(WMBB_CAPS_01 & WMBB_CAP_NOOP)
+
+static struct {
+	struct work_struct work;
+	atomic_long_t notifies;
+	atomic_long_t drains;
+	atomic_long_t events;
+	atomic_long_t empty;	/* drains that found nothing */
+	unsigned int most;	/* events taken by one drain */
+} clevo_drain;
+
+static void clevo_ring_init(void)
+{
+	int i;
+
+	for (i = 0; i < CLEVO_RING_SIZE; i++)
+		atomic_set(&clevo_ring.slot[i].seq, i);
+	atomic_set(&clevo_ring.head, 0);
+	clevo_ring.tail = 0;
+}
+
+/* from any context; the event is dropped if the ring is full */
+static void clevo_event_queue(enum clevo_source source, u8 code)
+{
+	unsigned int pos = atomic_read(&clevo_ring.head);
+	int diff;
+
+	for (;;) {
+		diff = atomic_read_acquire(&clevo_ring.slot[pos % CLEVO_RING_SIZE].seq) - pos;
+		if (diff == 0) {
+			if (atomic_cmpxchg(&clevo_ring.head, pos, pos + 1) == pos)
+				break;
+			pos = atomic_read(&clevo_ring.head);
+		} else if (diff < 0) {
+			atomic_long_inc(&clevo_ring.dropped);
+			return;
+		} else {
+			pos = atomic_read(&clevo_ring.head);
+		}
+	}
+
+	clevo_ring.slot[pos % CLEVO_RING_SIZE].event = (struct clevo_event) {
+		.source = source,
+		.code   = code,
+		.time   = ktime_get(),
+	};
+	atomic_set_release(&clevo_ring.slot[pos % CLEVO_RING_SIZE].seq, pos + 1);
+
+	atomic_long_inc(&clevo_ring.queued);
+	queue_work(clevo_workqueue, &clevo_ring.work);
+}
+
+/* the worker's; false if the ring is empty */
+static bool clevo_event_dequeue(struct clevo_event *event)
+{
+	unsigned int pos = clevo_ring.tail;
+
+	if ((int) (atomic_read_acquire(&clevo_ring.slot[pos % CLEVO_RING_SIZE].seq) -
+	           (pos + 1)) < 0)
+		return false;
+
+	*event = clevo_ring.slot[pos % CLEVO_RING_SIZE].event;
+	atomic_set_release(&clevo_ring.slot[pos % CLEVO_RING_SIZE].seq,
+	                   pos + CLEVO_RING_SIZE);
+	clevo_ring.tail = pos + 1;
+	return true;
+}
+
+
+static struct dentry *clevo_debugfs_dir;
+
+static int clevo_stats_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_printf(m, "%-9s %10s %8s %14s\n", "op", "calls", "errors", "ns");
+	for (i = 0; i < CLEVO_OP_MAX; i++)
+		seq_printf(m, "%-9s %10ld %8ld %14lld\n", clevo_op_names[i],
+		           atomic_long_read(&clevo_stats[i].calls),
+		           atomic_long_read(&clevo_stats[i].errors),
+		           (long long) atomic64_read(&clevo_stats[i].ns));
+
+	seq_printf(m, "\nec cache: %ld hits, %ld misses, %ld invalidations\n",
+	           atomic_long_read(&clevo_ec_cache.hits),
+	           atomic_long_read(&clevo_ec_cache.misses),
+	           atomic_long_read(&clevo_ec_cache.invalidations));
+	seq_printf(m, "ec rmw: %ld updates, %ld merged, %ld writes\n",
+	           atomic_long_read(&clevo_ec_rmw.updates),
+	           atomic_long_read(&clevo_ec_rmw.merged),
+	           atomic_long_read(&clevo_ec_rmw.writes));
+	seq_printf(m, "events: %ld queued, %ld dropped, %ld duplicates, %ld unknown, %ld reported in %ld batches\n",
+	           atomic_long_read(&clevo_ring.queued),
+	           atomic_long_read(&clevo_ring.dropped),
+	           atomic_long_read(&clevo_ring.duplicates),
+	           atomic_long_read(&clevo_ring.unknown),
+	           atomic_long_read(&clevo_ring.reported),
+	           atomic_long_read(&clevo_ring.batches));
+	seq_printf(m, "notifies: %ld, %ld events in %ld drains (at most %u in one), %ld empty\n",
+	           atomic_long_read(&clevo_drain.notifies),
+	           atomic_long_read(&clevo_drain.events),
+	           atomic_long_read(&clevo_drain.drains),
+	           READ_ONCE(clevo_drain.most),
+	           atomic_long_read(&clevo_drain.empty));
 	return 0;
 }
 
-static int clevo_wmi_resume(struct platform_device *dev)
+static int clevo_stats_open(struct inode *inode, struct file *file)
 {
+	return single_open(file, clevo_stats_show, inode->i_private);
+}
+
+static const struct file_operations clevo_stats_fops = {
+	.owner   = THIS_MODULE,
+	.open    = clevo_stats_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+/* the rows of hist that have counts, labelled name and the row number */
+static void clevo_latency_show_hist(struct seq_file *m, const char *name,
+                                    const struct clevo_hist *hist,
+                                    unsigned int rows)
+{
+	unsigned int row, i;
+	bool used;
+
+	for (row = 0; row < rows; row++) {
+		used = false;
+		for (i = 0; i < CLEVO_HIST_BUCKETS; i++)
+			used |= atomic_read(&hist[row].bucket[i]) != 0;
+		if (!used)
+			continue;
+
+		seq_printf(m, "%-8s 0x%02x", name, row);
+		for (i = 0; i < CLEVO_HIST_BUCKETS; i++)
+			seq_printf(m, " %6d", atomic_read(&hist[row].bucket[i]));
+		seq_putc(m, '\n');
+	}
+}
+
+static int clevo_latency_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	seq_printf(m, "%-13s %6s", "us", "<1");
+	for (i = 1; i < CLEVO_HIST_BUCKETS; i++)
+		seq_printf(m, " %6u", 1U << (i - 1));
+	seq_putc(m, '\n');
+
+	clevo_latency_show_hist(m, "wmbb", clevo_latency.wmbb,
+	                        ARRAY_SIZE(clevo_latency.wmbb));
+	clevo_latency_show_hist(m, "ec_read", clevo_latency.ec_read,
+	                        ARRAY_SIZE(clevo_latency.ec_read));
+	clevo_latency_show_hist(m, "ec_write", clevo_latency.ec_write,
+	                        ARRAY_SIZE(clevo_latency.ec_write));
 	return 0;
 }
 
-static struct platform_driver clevo_platform_driver = {
-	.remove = clevo_wmi_remove,
-	.resume = clevo_wmi_resume,
-	.driver = {
-		.name  = CLEVO_WMI_NAME,
-		.owner = THIS_MODULE,
-	},
+static int clevo_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, clevo_latency_show, inode->i_private);
+}
+
+static const struct file_operations clevo_latency_fops = {
+	.owner   = THIS_MODULE,
+	.open    = clevo_latency_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
 };
 
-static struct _led_work {
+static void __init clevo_debugfs_init(void)
+{
+	clevo_debugfs_dir = debugfs_create_dir(CLEVO_WMI_NAME, NULL);
+	if (IS_ERR_OR_NULL(clevo_debugfs_dir))
+		return;
+
+	debugfs_create_file("stats", S_IRUSR, clevo_debugfs_dir, NULL,
+	                    &clevo_stats_fops);
+	debugfs_create_file("latency", S_IRUSR, clevo_debugfs_dir, NULL,
+	                    &clevo_latency_fops);
+}
+
+static void clevo_debugfs_exit(void)
+{
+	debugfs_remove_recursive(clevo_debugfs_dir);
+	clevo_debugfs_dir = NULL;
+}
+
+
+static struct input_dev *clevo_input_device;
+
+/*
+ * The EC sets a bit of RINF when the airplane mode key is pressed, and on
+ * most machines the _Qxx query method it then runs raises the WMI event.
+ * On some nothing does, and the namespace doesn't tell which: every EC
+ * has query methods, for the battery, the AC adapter and so on. So, as
+ * tuxedo-wmi did, the bit is polled while the input device is open and
+ * the system isn't suspended, until a WMI event for the key shows that
+ * the firmware reports it.
+ *
+ * The interval is short after activity (a press, the lid opening, a
+ * resume) and doubles with each quiet poll, up to POLL_IDLE_MS. The
+ * timer is an hrtimer with a quarter of the interval as slack, so that
+ * its expiry can be put together with other wakeups; the EC is read
+ * from work, as an EC transaction may sleep.
+ */
+static bool clevo_wmi_reports_key;
+
+static struct {
+	struct mutex lock;	/* the flags, and clevo_wmi_reports_key */
+	bool open;
+	bool suspended;
+	bool running;
+	struct hrtimer timer;
 	struct work_struct work;
-	int wk;
-} led_work;
+	unsigned int interval;	/* ms, the next one */
+	ktime_t last;		/* the last poll */
+	ktime_t started;
+	atomic_long_t wakeups;
+	atomic_long_t presses;
+	atomic64_t active_ns;
+	atomic64_t latency_ns;	/* since the poll before each press */
+	atomic64_t latency_max_ns;
+} clevo_poll = {
+	.lock = __MUTEX_INITIALIZER(clevo_poll.lock),
+};
+
+static unsigned int clevo_poll_fast_ms(void)
+{
+	return 1000 / clamp_t(unsigned char, param_poll_freq,
+	                      POLL_FREQ_MIN, POLL_FREQ_MAX);
+}
 
-static void airplane_led_update(struct work_struct *work)
+static enum hrtimer_restart clevo_poll_timer(struct hrtimer *timer)
 {
+	queue_work(clevo_workqueue, &clevo_poll.work);
+	return HRTIMER_NORESTART;
+}
+
+static void clevo_poll_work(struct work_struct *work)
+{
+	ktime_t now = ktime_get();
+	unsigned int interval;
+	s64 latency;
 	u8 byte;
-	struct _led_work *w;
 
-	w = container_of(work, struct _led_work, work);
+	if (!READ_ONCE(clevo_poll.running))
+		return;
+
+	atomic_long_inc(&clevo_poll.wakeups);
+	interval = READ_ONCE(clevo_poll.interval);
+
+	if (!clevo_ec_get(EC_RINF, &byte) && byte & EC_RINF_AIRPLANE) {
+		clevo_ec_update_bits(EC_RINF, EC_RINF_AIRPLANE, 0);
+		clevo_event_queue(CLEVO_SOURCE_POLL, CLEVO_EVENT_AIRPLANE);
+
+		latency = ktime_to_ns(ktime_sub(now, clevo_poll.last));
+		atomic_long_inc(&clevo_poll.presses);
+		atomic64_add(latency, &clevo_poll.latency_ns);
+		if (latency > atomic64_read(&clevo_poll.latency_max_ns))
+			atomic64_set(&clevo_poll.latency_max_ns, latency);
+
+		interval = clevo_poll_fast_ms();
+	}
+
+	clevo_poll.last = now;
+	hrtimer_start_range_ns(&clevo_poll.timer, ms_to_ktime(interval),
+	                       (u64) interval * NSEC_PER_MSEC / 4,
+	                       HRTIMER_MODE_REL);
+	WRITE_ONCE(clevo_poll.interval,
+	           min_t(unsigned int, interval * 2, POLL_IDLE_MS));
+}
+
+/* start or stop polling as things now stand; call with the lock held */
+static void clevo_poll_update(void)
+{
+	bool run = clevo_poll.open && !clevo_poll.suspended &&
+	           !clevo_wmi_reports_key;
+
+	if (run == clevo_poll.running)
+		return;
+
+	if (run) {
+		clevo_poll.started = clevo_poll.last = ktime_get();
+		WRITE_ONCE(clevo_poll.interval, clevo_poll_fast_ms());
+		WRITE_ONCE(clevo_poll.running, true);
+		queue_work(clevo_workqueue, &clevo_poll.work);
+		return;
+	}
+
+	/* the work may arm the timer once more before it sees this */
+	WRITE_ONCE(clevo_poll.running, false);
+	hrtimer_cancel(&clevo_poll.timer);
+	cancel_work_sync(&clevo_poll.work);
+	hrtimer_cancel(&clevo_poll.timer);
+
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), clevo_poll.started)),
+	             &clevo_poll.active_ns);
+}
+
+/* something happened that the user may follow with a press: poll now, and often */
+static void clevo_poll_kick(void)
+{
+	mutex_lock(&clevo_poll.lock);
+	if (clevo_poll.running) {
+		WRITE_ONCE(clevo_poll.interval, clevo_poll_fast_ms());
+		queue_work(clevo_workqueue, &clevo_poll.work);
+	}
+	mutex_unlock(&clevo_poll.lock);
+}
+
+static void clevo_poll_set(bool *flag, bool value)
+{
+	mutex_lock(&clevo_poll.lock);
+	*flag = value;
+	clevo_poll_update();
+	mutex_unlock(&clevo_poll.lock);
+}
+
+static int clevo_lid_notify(struct notifier_block *nb, unsigned long open,
+                            void *data)
+{
+	if (open)
+		clevo_poll_kick();
+	return NOTIFY_OK;
+}
+
+static struct notifier_block clevo_lid_notifier = {
+	.notifier_call = clevo_lid_notify,
+};
+
+static int clevo_poll_show(struct seq_file *m, void *v)
+{
+	unsigned long wakeups = atomic_long_read(&clevo_poll.wakeups);
+	unsigned long presses = atomic_long_read(&clevo_poll.presses);
+	u64 active_ns, rate;
+
+	mutex_lock(&clevo_poll.lock);
+	active_ns = atomic64_read(&clevo_poll.active_ns);
+	if (clevo_poll.running)
+		active_ns += ktime_to_ns(ktime_sub(ktime_get(), clevo_poll.started));
+	seq_printf(m, "state:       %s\n",
+	           clevo_wmi_reports_key ? "not needed" :
+	           clevo_poll.running ? "polling" : "stopped");
+	mutex_unlock(&clevo_poll.lock);
+
+	/* hundredths of a wakeup a second */
+	rate = active_ns ? div64_u64((u64) wakeups * 100 * NSEC_PER_SEC, active_ns) : 0;
+
+	seq_printf(m, "interval:    %u ms\n", READ_ONCE(clevo_poll.interval));
+	seq_printf(m, "polling for: %llu ms\n",
+	           (unsigned long long) div64_u64(active_ns, NSEC_PER_MSEC));
+	seq_printf(m, "wakeups:     %lu (%llu.%02llu/s)\n", wakeups,
+	           (unsigned long long) rate / 100, (unsigned long long) rate % 100);
+	seq_printf(m, "presses:     %lu\n", presses);
+	seq_printf(m, "detection:   within %llu ms on average, %llu ms at most\n",
+	           (unsigned long long) (presses ?
+	           div64_u64(atomic64_read(&clevo_poll.latency_ns),
+	                     (u64) presses * NSEC_PER_MSEC) : 0),
+	           (unsigned long long) div64_u64(atomic64_read(&clevo_poll.latency_max_ns),
+	                                          NSEC_PER_MSEC));
+	return 0;
+}
+
+static int clevo_poll_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, clevo_poll_show, inode->i_private);
+}
+
+static const struct file_operations clevo_poll_fops = {
+	.owner   = THIS_MODULE,
+	.open    = clevo_poll_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int clevo_input_open(struct input_dev *dev)
+{
+	clevo_poll_set(&clevo_poll.open, true);
+	return 0;
+}
+
+static void clevo_input_close(struct input_dev *dev)
+{
+	clevo_poll_set(&clevo_poll.open, false);
+}
+
+/*
+ * What the events GET_EVENT returns mean, from tuxedo-wmi and
+ * clevo_laptop, in one list that both the dispatch table and the
+ * keymap are built from: the key to report (none if KEY_RESERVED), a
+ * function to call, and flags. Events that aren't listed are counted
+ * and ignored. The keys can be remapped through the input device's
+ * keymap, and the table follows.
+ */
+#define CLEVO_EVENT_KNOWN	0x01
+#define CLEVO_EVENT_POLLED	0x02	/* the poller finds it too */
+
+static void clevo_event_airplane(const struct clevo_event *event);
+
+#define CLEVO_EVENTS(E)								\
+	E(0x81, KEY_KBDILLUMDOWN,   NULL, 0)	/* keyboard backlight */	\
+	E(0x82, KEY_KBDILLUMUP,     NULL, 0)					\
+	E(0x83, KEY_RESERVED,       NULL, 0)	/* its next mode */		\
+	E(0x9F, KEY_KBDILLUMTOGGLE, NULL, 0)					\
+	E(0xDE, KEY_RESERVED,       NULL, 0)	/* silent fan mode */		\
+	E(0xDF, KEY_RESERVED,       NULL, 0)	/* normal fan mode */		\
+	E(0xE0, KEY_RESERVED,       NULL, 0)	/* LCD brightness, set */	\
+	E(0xE1, KEY_RESERVED,       NULL, 0)	/* by the firmware */		\
+	E(0xE2, KEY_RESERVED,       NULL, 0)					\
+	E(0xE3, KEY_RESERVED,       NULL, 0)					\
+	E(0xE4, KEY_RESERVED,       NULL, 0)					\
+	E(0xE5, KEY_RESERVED,       NULL, 0)					\
+	E(0xE6, KEY_RESERVED,       NULL, 0)					\
+	E(0xE7, KEY_RESERVED,       NULL, 0)					\
+	E(0xEA, KEY_WWAN,           NULL, 0)	/* 3G off */			\
+	E(0xEB, KEY_WWAN,           NULL, 0)	/* 3G on */			\
+	E(0xF4, KEY_RFKILL,         clevo_event_airplane, CLEVO_EVENT_POLLED)	\
+	E(0xF5, KEY_WLAN,           NULL, 0)					\
+	E(0xF6, KEY_CAMERA,         NULL, 0)	/* camera off */		\
+	E(0xF7, KEY_CAMERA,         NULL, 0)	/* camera on */			\
+	E(0xF8, KEY_BLUETOOTH,      NULL, 0)	/* Bluetooth off */		\
+	E(0xF9, KEY_BLUETOOTH,      NULL, 0)	/* Bluetooth on */		\
+	E(0xFA, KEY_RESERVED,       NULL, 0)	/* volume, up or down */	\
+	E(0xFB, KEY_MUTE,           NULL, 0)					\
+	E(0xFC, KEY_TOUCHPAD_OFF,   NULL, 0)					\
+	E(0xFD, KEY_TOUCHPAD_ON,    NULL, 0)
+
+static struct clevo_event_entry {
+	u16 keycode;
+	u8 flags;
+	void (*handler)(const struct clevo_event *event);
+} clevo_event_table[256] = {
+#define CLEVO_EVENT_ENTRY(code, key, fn, fl) \
+	[code] = { .keycode = key, .flags = (fl) | CLEVO_EVENT_KNOWN, .handler = fn },
+	CLEVO_EVENTS(CLEVO_EVENT_ENTRY)
+#undef CLEVO_EVENT_ENTRY
+};
+
+static const struct key_entry clevo_keymap[] __initconst = {
+#define CLEVO_KEY_ENTRY(event, key, fn, fl) \
+	{ .type = (key) ? KE_KEY : KE_IGNORE, .code = event, { .keycode = key } },
+	CLEVO_EVENTS(CLEVO_KEY_ENTRY)
+#undef CLEVO_KEY_ENTRY
+	{ .type = KE_END }
+};
+
+static void clevo_event_airplane(const struct clevo_event *event)
+{
+	/* the firmware reports the key itself, stop polling for it */
+	if (event->source == CLEVO_SOURCE_WMI && !READ_ONCE(clevo_wmi_reports_key)) {
+		clevo_poll_set(&clevo_wmi_reports_key, true);
+		clevo_ec_update_bits(EC_RINF, EC_RINF_AIRPLANE, 0);
+	}
+}
+
+static int (*clevo_sparse_setkeycode)(struct input_dev *dev,
+                                      const struct input_keymap_entry *ke,
+                                      unsigned int *old_keycode);
+
+/* remap through the sparse keymap, then bring the dispatch table into line */
+static int clevo_setkeycode(struct input_dev *dev,
+                            const struct input_keymap_entry *ke,
+                            unsigned int *old_keycode)
+{
+	const struct key_entry *key;
+	int err;
+
+	err = clevo_sparse_setkeycode(dev, ke, old_keycode);
+	if (err)
+		return err;
+
+	for (key = dev->keycode; key->type != KE_END; key++)
+		if (key->type == KE_KEY)
+			WRITE_ONCE(clevo_event_table[key->code].keycode,
+			           key->keycode);
+	return 0;
+}
+
+static int __init clevo_input_init(void)
+{
+	int err;
+
+	clevo_input_device = input_allocate_device();
+	if (unlikely(!clevo_input_device))
+		return -ENOMEM;
+
+	clevo_input_device->name = "Clevo WMI Hotkeys";
+	clevo_input_device->phys = CLEVO_WMI_NAME "/input0";
+	clevo_input_device->id.bustype = BUS_HOST;
+	clevo_input_device->dev.parent = &clevo_platform_device->dev;
+
+	clevo_input_device->open  = clevo_input_open;
+	clevo_input_device->close = clevo_input_close;
+
+	err = sparse_keymap_setup(clevo_input_device, clevo_keymap, NULL);
+	if (unlikely(err)) {
+		input_free_device(clevo_input_device);
+		clevo_input_device = NULL;
+		return err;
+	}
+	clevo_sparse_setkeycode = clevo_input_device->setkeycode;
+	clevo_input_device->setkeycode = clevo_setkeycode;
+
+	/* a press from before the driver was loaded isn't one to report */
+	clevo_ec_update_bits(EC_RINF, EC_RINF_AIRPLANE, 0);
+
+	err = input_register_device(clevo_input_device);
+	if (unlikely(err)) {
+		input_free_device(clevo_input_device);
+		clevo_input_device = NULL;
+		return err;
+	}
+
+	acpi_lid_notifier_register(&clevo_lid_notifier);
+	if (!IS_ERR_OR_NULL(clevo_debugfs_dir))
+		debugfs_create_file("poll", S_IRUSR, clevo_debugfs_dir,
+		                    NULL, &clevo_poll_fops);
+
+	return 0;
+}
+
+static void clevo_input_exit(void)
+{
+	struct input_dev *dev = clevo_input_device;
+
+	if (!dev)
+		return;
+
+	acpi_lid_notifier_unregister(&clevo_lid_notifier);
+
+	/* let the events on their way be reported, or dropped after this */
+	WRITE_ONCE(clevo_input_device, NULL);
+	flush_workqueue(clevo_workqueue);
+
+	input_unregister_device(dev);
+}
+
+static void clevo_event_work(struct work_struct *work)
+{
+	static struct clevo_event last_press;
+	struct input_dev *dev = READ_ONCE(clevo_input_device);
+	const struct clevo_event_entry *entry;
+	struct clevo_event event;
+	unsigned int reported = 0;
+	u16 keycode;
+
+	while (clevo_event_dequeue(&event)) {
+		entry = &clevo_event_table[event.code];
+		if (!(entry->flags & CLEVO_EVENT_KNOWN)) {
+			atomic_long_inc(&clevo_ring.unknown);
+			continue;
+		}
+
+		if (entry->handler)
+			entry->handler(&event);
+
+		if (entry->flags & CLEVO_EVENT_POLLED) {
+			if (last_press.code && event.source != last_press.source &&
+			    event.code == last_press.code &&
+			    ktime_to_ms(ktime_sub(event.time, last_press.time)) < POLL_IDLE_MS) {
+				atomic_long_inc(&clevo_ring.duplicates);
+				last_press.code = 0;
+				continue;
+			}
+			last_press = event;
+		}
+
+		keycode = READ_ONCE(entry->keycode);
+		if (!dev || keycode == KEY_RESERVED)
+			continue;
 
-	ec_read(0xD9, &byte);
-	ec_write(0xD9, w->wk ? byte | 0x40 : byte & ~0x40);
+		input_event(dev, EV_MSC, MSC_SCAN, event.code);
+		input_report_key(dev, keycode, 1);
+		input_report_key(dev, keycode, 0);
+		reported++;
+	}
+
+	if (!reported)
+		return;
+
+	input_sync(dev);
+	atomic_long_add(reported, &clevo_ring.reported);
+	atomic_long_inc(&clevo_ring.batches);
+}
+
+/* takes up to max events with GET_EVENT; fewer if it returns none */
+static void clevo_event_take(unsigned int max)
+{
+	unsigned int n;
+	u32 event;
+
+	for (n = 0; n < max; n++) {
+		if (clevo_wmbb(GET_EVENT, 0, &event) || !event)
+			break;
+		clevo_event_queue(CLEVO_SOURCE_WMI, event);
+	}
+
+	atomic_long_inc(&clevo_drain.drains);
+	atomic_long_add(n, &clevo_drain.events);
+	if (!n)
+		atomic_long_inc(&clevo_drain.empty);
+	if (n > clevo_drain.most)
+		WRITE_ONCE(clevo_drain.most, n);
+}
+
+static void clevo_drain_work(struct work_struct *work)
+{
+	/* no more than the ring holds, should the firmware never run dry */
+	clevo_event_take(CLEVO_RING_SIZE);
+}
+
+static void clevo_wmi_notify(u32 value, void *context)
+{
+	if (value != CLEVO_WMI_EVENT) {
+		pr_info(CLEVO_WMI_NAME ": Unexpected WMI event (%#x)\n", value);
+		return;
+	}
+
+	atomic_long_inc(&clevo_drain.notifies);
+	if (CLEVO_EVENT_LATCHED)
+		clevo_event_take(1);
+	else
+		queue_work(clevo_workqueue, &clevo_drain.work);
 }
 
+static int clevo_wmi_probe(struct platform_device *dev)
+{
+	clevo_wmbb(GET_AP, 0, NULL);
+
+	return 0;
+}
+
+static int clevo_wmi_suspend(struct platform_device *dev, pm_message_t state)
+{
+	clevo_poll_set(&clevo_poll.suspended, true);
+	return 0;
+}
+
+static int clevo_wmi_resume(struct platform_device *dev)
+{
+	clevo_ec_invalidate();
+	clevo_wmbb(GET_AP, 0, NULL);
+	clevo_poll_set(&clevo_poll.suspended, false);
+	return 0;
+}
+
+static struct platform_driver clevo_platform_driver = {
+	.suspend = clevo_wmi_suspend,
+	.resume  = clevo_wmi_resume,
+	.driver = {
+		.name  = CLEVO_WMI_NAME,
+		.owner = THIS_MODULE,
+	},
+};
+
 static enum led_brightness airplane_led_get(struct led_classdev *led_cdev)
 {
 	u8 byte;
 
-	ec_read(0xD9, &byte);
-	return byte & 0x40 ? LED_FULL : LED_OFF;
+	if (clevo_ec_get(EC_AIRPLANE_LED, &byte))
+		return LED_OFF;
+	return byte & EC_AIRPLANE_LED_BIT ? LED_FULL : LED_OFF;
 }
 
 /* must not sleep */
 static void airplane_led_set(struct led_classdev *led_cdev,
                              enum led_brightness value)
 {
-	led_work.wk = value;
-	queue_work(led_workqueue, &led_work.work);
+	clevo_ec_update_bits(EC_AIRPLANE_LED, EC_AIRPLANE_LED_BIT,
+	                     value ? EC_AIRPLANE_LED_BIT : 0);
 }
 
 static struct led_classdev airplane_led = {
@@ -120,56 +1145,96 @@ static struct led_classdev airplane_led = {
 
 static int __init clevo_led_init(void)
 {
-	int err;
-
-	led_workqueue = create_singlethread_workqueue("led_workqueue");
-	if (unlikely(!led_workqueue))
-		return -ENOMEM;
-
-	INIT_WORK(&led_work.work, airplane_led_update);
-
-	err = led_classdev_register(&clevo_platform_device->dev, &airplane_led);
-	if (err)
-		goto err_destroy_workqueue;
-
-	return 0;
-
-err_destroy_workqueue:
-	destroy_workqueue(led_workqueue);
-	led_workqueue = NULL;
-
-	return err;
+	return led_classdev_register(&clevo_platform_device->dev, &airplane_led);
 }
 
 static void clevo_led_exit(void)
 {
 	if (!IS_ERR_OR_NULL(airplane_led.dev))
 		led_classdev_unregister(&airplane_led);
-	if (led_workqueue)
-		destroy_workqueue(led_workqueue);
 }
 
 
+/* undo clevo_wmi_init() but for the notify handler, in reverse */
+static void clevo_wmi_teardown(void)
+{
+	clevo_led_exit();
+	clevo_input_exit();
+
+	/* no more suspend or resume to start the poller again */
+	platform_device_unregister(clevo_platform_device);
+	platform_driver_unregister(&clevo_platform_driver);
+
+	cancel_work_sync(&clevo_drain.work);
+	hrtimer_cancel(&clevo_poll.timer);
+	cancel_work_sync(&clevo_poll.work);
+
+	/* the EC updates and events still queued are made before it goes */
+	destroy_workqueue(clevo_workqueue);
+
+	clevo_debugfs_exit();
+}
+
 static int __init clevo_wmi_init(void)
 {
+	acpi_status status;
 	int err;
 
+	if (!wmi_has_guid(CLEVO_EVENT_GUID) || !wmi_has_guid(CLEVO_GET_GUID)) {
+		pr_info(CLEVO_WMI_NAME ": No Clevo WMI interface found\n");
+		return -ENODEV;
+	}
+
+	clevo_workqueue = create_singlethread_workqueue(CLEVO_WMI_NAME);
+	if (unlikely(!clevo_workqueue))
+		return -ENOMEM;
+
+	INIT_WORK(&clevo_ec_rmw.work, clevo_ec_rmw_work);
+	INIT_WORK(&clevo_poll.work, clevo_poll_work);
+	INIT_WORK(&clevo_ring.work, clevo_event_work);
+	INIT_WORK(&clevo_drain.work, clevo_drain_work);
+	clevo_ring_init();
+	hrtimer_init(&clevo_poll.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	clevo_poll.timer.function = clevo_poll_timer;
+
+	clevo_debugfs_init();
+
 	clevo_platform_device =
 		platform_create_bundle(&clevo_platform_driver,
 		                       clevo_wmi_probe, NULL, 0, NULL, 0);
 
-	if (unlikely(IS_ERR(clevo_platform_device)))
+	if (unlikely(IS_ERR(clevo_platform_device))) {
+		clevo_debugfs_exit();
+		destroy_workqueue(clevo_workqueue);
 		return PTR_RET(clevo_platform_device);
+	}
+
+	err = clevo_input_init();
+	if (unlikely(err))
+		pr_err(CLEVO_WMI_NAME ": Could not register input device\n");
 
 	err = clevo_led_init();
 	if (unlikely(err))
 		pr_err(CLEVO_WMI_NAME ": Could not register LED device\n");
+
+	/* last, so that a notify finds everything it reports to */
+	status = wmi_install_notify_handler(CLEVO_EVENT_GUID,
+	                                    clevo_wmi_notify, NULL);
+	if (unlikely(ACPI_FAILURE(status))) {
+		pr_err(CLEVO_WMI_NAME ": Could not register WMI notify handler (%#x)\n",
+		       status);
+		clevo_wmi_teardown();
+		return -EIO;
+	}
 	return 0;
 }
 
 static void __exit clevo_wmi_exit(void)
 {
-	clevo_led_exit();
+	/* first, so that no notify reports to what goes next */
+	wmi_remove_notify_handler(CLEVO_EVENT_GUID);
+
+	clevo_wmi_teardown();
 }
 
 module_init(clevo_wmi_init);
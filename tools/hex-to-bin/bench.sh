@@ -0,0 +1,58 @@
+#!/bin/sh
+# Compare hexxer against the flex scanner it replaces.
+#
+#   ./bench.sh [input.dsl]
+#
+# Without an input, a dump of 6 MB of data in iasl's layout (about 58 MB
+# of text) is generated. Every decoder must produce the same output and
+# the same warnings as flex; the best of three runs of each is reported.
+# FLEX=path picks another reference build.
+
+FLEX=${FLEX:-./hexxer-flex}
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+if [ -n "$1" ]; then
+    IN=$1
+else
+    IN=$TMP/dump.dsl
+    head -c 6000000 /dev/urandom | od -An -v -tx1 -w8 | awk '{
+        printf "                /* %04X */  ", (NR - 1) * 8 % 65536
+        for (i = 1; i <= NF; i++)
+            printf "0x%s, ", toupper($i)
+        printf "\n"
+    }' > "$IN"
+fi
+SIZE=$(wc -c < "$IN")
+
+# best of three, in seconds
+best() {
+    b=
+    for i in 1 2 3; do
+        t0=$(date +%s.%N)
+        "$@" "$IN" > "$TMP/out" 2> "$TMP/err"
+        t1=$(date +%s.%N)
+        b=$(echo "$t0 $t1 $b" | awk '{ t = $2 - $1; print ($3 == "" || t < $3) ? t : $3 }')
+    done
+    echo "$b"
+}
+
+report() {
+    printf "%-16s %8.3f s %9.1f MB/s\n" "$1" "$2" "$(echo "$SIZE $2" | awk '{ print $1 / $2 / 1e6 }')"
+}
+
+echo "input: $IN, $SIZE bytes"
+t=$(best "$FLEX") || exit 1
+mv "$TMP/out" "$TMP/ref.out"
+mv "$TMP/err" "$TMP/ref.err"
+report flex "$t"
+
+for opt in "-k avx2" "-k sse2" "-k scalar" "-j 0"; do
+    ./hexxer $opt /dev/null 2>/dev/null || continue
+    t=$(best ./hexxer $opt)
+    if ! cmp -s "$TMP/out" "$TMP/ref.out" || ! cmp -s "$TMP/err" "$TMP/ref.err"; then
+        echo "hexxer $opt: output differs from flex" >&2
+        exit 1
+    fi
+    report "hexxer $opt" "$t"
+done
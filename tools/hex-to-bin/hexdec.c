@@ -0,0 +1,320 @@
+#include <string.h>
+
+#include "hexdec.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEX_X86 1
+#endif
+
+#define BLOCK 64
+#define EVEN_BITS 0x5555555555555555ULL
+#define ODD_BITS  0xaaaaaaaaaaaaaaaaULL
+
+/*
+ * A block of input as bit masks, bit i for byte i, and for every byte the
+ * byte it would start if it and the next one were hex digits.
+ */
+struct block {
+    uint64_t hex, skip, zero;
+    uint8_t val[BLOCK];
+};
+
+enum { C_HEX = 1, C_SKIP = 2, C_ZERO = 4 };
+
+static uint8_t char_class[256], nibble[256];
+
+static void init_tables(void)
+{
+    const char *skip = " \t\n,\"x";
+    int c;
+
+    for (c = 0; c < 256; c++) {
+        if (c >= '0' && c <= '9')
+            nibble[c] = c - '0';
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            nibble[c] = (c | 0x20) - 'a' + 10;
+        else
+            continue;
+        char_class[c] = C_HEX;
+    }
+    for (; *skip; skip++)
+        char_class[(uint8_t)*skip] = C_SKIP;
+    char_class['0'] |= C_ZERO;
+}
+
+static void classify_scalar(const char *p, struct block *b)
+{
+    const uint8_t *u = (const uint8_t *)p;
+    uint64_t hex = 0, skip = 0, zero = 0, bit;
+    int i;
+
+    for (i = 0; i < BLOCK; i++) {
+        bit = 1ULL << i;
+        if (char_class[u[i]] & C_HEX)
+            hex |= bit;
+        if (char_class[u[i]] & C_SKIP)
+            skip |= bit;
+        if (char_class[u[i]] & C_ZERO)
+            zero |= bit;
+        b->val[i] = nibble[u[i]] << 4 | nibble[u[i + 1]];
+    }
+    b->hex = hex;
+    b->skip = skip;
+    b->zero = zero;
+}
+
+#ifdef HEX_X86
+/*
+ * The same with vectors. Bytes from 0x80 up are negative to the signed
+ * compares, and so fall outside every range, as they should. A nibble is
+ * the low four bits, plus 9 for letters; masking it once shifted keeps
+ * the junk in non-hex bytes out of their neighbours.
+ */
+__attribute__((target("sse2")))
+static __m128i in_range_sse2(__m128i c, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), c));
+}
+
+__attribute__((target("sse2")))
+static __m128i nibble_sse2(__m128i c)
+{
+    return _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0x0f)),
+                        _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('9')), _mm_set1_epi8(9)));
+}
+
+__attribute__((target("sse2")))
+static void classify_sse2(const char *p, struct block *b)
+{
+    uint64_t hex = 0, skip = 0, zero = 0;
+    __m128i c, h, s, v;
+    int i;
+
+    for (i = 0; i < BLOCK; i += 16) {
+        c = _mm_loadu_si128((const __m128i *)(p + i));
+        h = _mm_or_si128(in_range_sse2(c, '0', '9'),
+                         in_range_sse2(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'f'));
+        s = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+                                      _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')),
+                                      _mm_cmpeq_epi8(c, _mm_set1_epi8(','))));
+        s = _mm_or_si128(s, _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('"')),
+                                         _mm_cmpeq_epi8(c, _mm_set1_epi8('x'))));
+        v = _mm_and_si128(_mm_slli_epi16(nibble_sse2(c), 4), _mm_set1_epi8((char)0xf0));
+        v = _mm_or_si128(v, nibble_sse2(_mm_loadu_si128((const __m128i *)(p + i + 1))));
+        _mm_storeu_si128((__m128i *)(b->val + i), v);
+        hex |= (uint64_t)(unsigned)_mm_movemask_epi8(h) << i;
+        skip |= (uint64_t)(unsigned)_mm_movemask_epi8(s) << i;
+        zero |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('0'))) << i;
+    }
+    b->hex = hex;
+    b->skip = skip;
+    b->zero = zero;
+}
+
+__attribute__((target("avx2")))
+static __m256i in_range_avx2(__m256i c, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+}
+
+__attribute__((target("avx2")))
+static __m256i nibble_avx2(__m256i c)
+{
+    return _mm256_add_epi8(_mm256_and_si256(c, _mm256_set1_epi8(0x0f)),
+                           _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('9')),
+                                            _mm256_set1_epi8(9)));
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char *p, struct block *b)
+{
+    uint64_t hex = 0, skip = 0, zero = 0;
+    __m256i c, h, s, v;
+    int i;
+
+    for (i = 0; i < BLOCK; i += 32) {
+        c = _mm256_loadu_si256((const __m256i *)(p + i));
+        h = _mm256_or_si256(in_range_avx2(c, '0', '9'),
+                            in_range_avx2(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'f'));
+        s = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+                                            _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\t'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')),
+                                            _mm256_cmpeq_epi8(c, _mm256_set1_epi8(','))));
+        s = _mm256_or_si256(s, _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('"')),
+                                               _mm256_cmpeq_epi8(c, _mm256_set1_epi8('x'))));
+        v = _mm256_and_si256(_mm256_slli_epi16(nibble_avx2(c), 4), _mm256_set1_epi8((char)0xf0));
+        v = _mm256_or_si256(v, nibble_avx2(_mm256_loadu_si256((const __m256i *)(p + i + 1))));
+        _mm256_storeu_si256((__m256i *)(b->val + i), v);
+        hex |= (uint64_t)(uint32_t)_mm256_movemask_epi8(h) << i;
+        skip |= (uint64_t)(uint32_t)_mm256_movemask_epi8(s) << i;
+        zero |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('0'))) << i;
+    }
+    b->hex = hex;
+    b->skip = skip;
+    b->zero = zero;
+}
+#endif
+
+static const struct kernel {
+    const char *name;
+    void (*classify)(const char *p, struct block *b);
+} kernels[] = {
+#ifdef HEX_X86
+    { "avx2", classify_avx2 },
+    { "sse2", classify_sse2 },
+#endif
+    { "scalar", classify_scalar },
+};
+
+static const struct kernel *kernel;
+
+static int kernel_supported(const struct kernel *k)
+{
+#ifdef HEX_X86
+    if (k->classify == classify_avx2)
+        return __builtin_cpu_supports("avx2");
+    if (k->classify == classify_sse2)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return 1;
+}
+
+static void init(void)
+{
+    size_t i;
+
+    if (kernel)
+        return;
+    init_tables();
+    for (i = 0; !kernel_supported(&kernels[i]); i++)
+        ;
+    kernel = &kernels[i];
+}
+
+int hex_set_kernel(const char *name)
+{
+    size_t i;
+
+    init();
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        if (!strcmp(kernels[i].name, name) && kernel_supported(&kernels[i])) {
+            kernel = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *hex_kernel_name(void)
+{
+    init();
+    return kernel->name;
+}
+
+void hex_decoder_init(struct hex_decoder *d, hex_diag_fn diag, void *ctx)
+{
+    init();
+    d->in_comment = 0;
+    d->comment_start = NULL;
+    d->diag = diag;
+    d->ctx = ctx;
+}
+
+//one token the way flex would take it, outside a comment
+static const char *scalar_token(struct hex_decoder *d, const char *p, const char *end,
+                                uint8_t **out)
+{
+    uint8_t c = p[0], cls = char_class[c];
+
+    if (c == '/' && p + 1 < end && p[1] == '*') {
+        d->in_comment = 1;
+        d->comment_start = p;
+        return p + 2;
+    }
+    if ((cls & C_HEX) && p + 1 < end && (char_class[(uint8_t)p[1]] & C_HEX)) {
+        *(*out)++ = nibble[c] << 4 | nibble[(uint8_t)p[1]];
+        return p + 2;
+    }
+    if (!(cls & (C_SKIP | C_ZERO)))
+        d->diag(d->ctx, HEX_UNEXPECTED, p);
+    return p + 1;
+}
+
+//past the "*/" closing the comment, or NULL if it isn't closed before end
+static const char *comment_end(const char *p, const char *end)
+{
+    while ((p = memchr(p, '*', end - p)) != NULL) {
+        if (++p < end && *p == '/')
+            return p + 1;
+    }
+    return NULL;
+}
+
+size_t hex_decode(struct hex_decoder *d, const char *text, size_t len, uint8_t *out)
+{
+    const char *p = text, *end = text + len;
+    uint8_t *start = out;
+    struct block b;
+    uint64_t m, runs, odd_runs, pairs, singles, stop;
+    int limit;
+
+    while (p < end) {
+        if (d->in_comment) {
+            if ((p = comment_end(p, end)) == NULL)
+                break;
+            d->in_comment = 0;
+            continue;
+        }
+        //classify reads one byte past the block for the last pair
+        if (end - p <= BLOCK) {
+            p = scalar_token(d, p, end, &out);
+            continue;
+        }
+
+        kernel->classify(p, &b);
+        //stop at the first character that isn't a digit or skipped
+        stop = ~(b.hex | b.skip);
+        limit = stop ? __builtin_ctzll(stop) : BLOCK;
+        m = limit == BLOCK ? b.hex : b.hex & ((1ULL << limit) - 1);
+        //a run reaching the end of the block may go on in the next one
+        if (limit == BLOCK && (m >> (BLOCK - 1))) {
+            limit = ~m ? BLOCK - __builtin_clzll(~m) : 0;
+            m &= limit ? (1ULL << limit) - 1 : 0;
+        }
+
+        /*
+         * Pairs start at even offsets from the start of their run: on even
+         * bits for runs starting on one, on odd bits for the others.
+         * Adding a run's lowest bit to it clears it, which picks out the
+         * odd runs. A digit left over at the end of an odd run is skipped
+         * if it is a 0 and is an error otherwise.
+         */
+        runs = m & ~(m << 1);
+        odd_runs = ((m + (runs & ODD_BITS)) ^ m) & m;
+        pairs = ((m & ~odd_runs & EVEN_BITS) | (odd_runs & ODD_BITS)) & (m >> 1);
+        singles = m & ~(pairs | pairs << 1) & ~b.zero;
+        if (singles) {
+            limit = __builtin_ctzll(singles);
+            pairs &= (1ULL << limit) - 1;
+        }
+        while (pairs) {
+            *out++ = b.val[__builtin_ctzll(pairs)];
+            pairs &= pairs - 1;
+        }
+        p += limit;
+        if (limit < BLOCK)
+            p = scalar_token(d, p, end, &out);
+    }
+    return out - start;
+}
+
+void hex_finish(struct hex_decoder *d)
+{
+    if (d->in_comment)
+        d->diag(d->ctx, HEX_UNTERMINATED, d->comment_start);
+    d->in_comment = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef HEXDEC_H
+#define HEXDEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Decoder for hex dumps of ACPI buffers, with exactly the behaviour of the
+ * flex scanner in hex.l:
+ *
+ * - two hex digits in a row are a byte, pairing from the start of a run
+ * - space, tab, newline, comma, '"', '0' and 'x' on their own are skipped
+ * - C comments are skipped, and one still open at the end is an error
+ * - any other character, including a lone hex digit other than 0, is
+ *   reported as unexpected and skipped
+ *
+ * The input is classified 64 bytes at a time with SSE2 or AVX2, whichever
+ * the CPU has, falling back to plain C elsewhere: runs of hex digits
+ * become bit masks, the pairs in them are found with a few integer
+ * operations, and only the output bytes and the rare special characters
+ * are looked at one by one.
+ */
+
+enum hex_diag {
+    HEX_UNEXPECTED,     //pos is the unexpected character
+    HEX_UNTERMINATED,   //pos is the start of the comment still open at the end
+};
+
+typedef void (*hex_diag_fn)(void *ctx, enum hex_diag diag, const char *pos);
+
+struct hex_decoder {
+    int in_comment;             //carried from one piece of the input to the next
+    const char *comment_start;
+    hex_diag_fn diag;
+    void *ctx;
+};
+
+void hex_decoder_init(struct hex_decoder *d, hex_diag_fn diag, void *ctx);
+
+/*
+ * Decode the next len bytes of the input into out, which must have room
+ * for len / 2 bytes, and return how many were written. No token spans a
+ * line break, so the input may be split anywhere just after a newline.
+ */
+size_t hex_decode(struct hex_decoder *d, const char *text, size_t len, uint8_t *out);
+
+//at the end of the input, report a comment that is still open
+void hex_finish(struct hex_decoder *d);
+
+//choose "avx2", "sse2" or "scalar" rather than the best available; -1 if unsupported
+int hex_set_kernel(const char *name);
+
+//the kernel in use
+const char *hex_kernel_name(void);
+
+#endif
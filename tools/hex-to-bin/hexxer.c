@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hexdec.h"
+#include "mapfile.h"
+#include "parallel.h"
+
+//input is decoded this much at a time, split after a newline
+#define PIECE (1 << 20)
+//default chunk size for -j
+#define CHUNK (8 << 20)
+
+/*
+ * Line numbers for the diagnostics are only worked out when there is one
+ * to print, by counting newlines on from the previous one.
+ */
+struct lines {
+    const char *pos;
+    int line;
+};
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-k avx2|sse2|scalar] [-j threads [-c chunk_size]] [input_file]\n", prog_name);
+    fputs("\
+Turn the hex dump of a buffer from a decompiled DSDT, e.g. a WQxx block,\n\
+into the binary data, written to the standard output. C comments are\n\
+skipped; the input is read from input_file, or the standard input.\n\
+\n\
+\t-k\tuse this decoder rather than the fastest one the CPU supports\n\
+\t-j\tdecode on this many threads, 0 for one per CPU; the output is the\n\
+\t\tsame as from a single one\n\
+\t-c\tbytes of input per chunk for -j (default 8 MiB)\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+static int line_of(struct lines *l, const char *pos)
+{
+    const char *nl;
+
+    while ((nl = memchr(l->pos, '\n', pos - l->pos)) != NULL) {
+        l->line++;
+        l->pos = nl + 1;
+    }
+    return l->line;
+}
+
+static void print_diag(void *ctx, enum hex_diag diag, const char *pos)
+{
+    int line = line_of(ctx, pos);
+
+    if (diag == HEX_UNTERMINATED)
+        fprintf(stderr, "Error: Unterminated comment beginning on line %d\n", line);
+    else //a NUL prints as nothing, as it does from flex
+        fprintf(stderr, "Warning: Unexpected character '%.*s' on line %d\n", *pos != '\0', pos, line);
+}
+
+//read a file that can't be mapped, such as a pipe
+static char *read_all(FILE *fp, size_t *len)
+{
+    size_t got = 0, cap = 1 << 20;
+    char *buf = NULL, *tmp;
+
+    while (1) {
+        tmp = realloc(buf, cap);
+        if (tmp == NULL) {
+            free(buf);
+            return NULL;
+        }
+        buf = tmp;
+        got += fread(buf + got, 1, cap - got, fp);
+        if (got < cap)
+            break;
+        cap *= 2;
+    }
+    if (ferror(fp)) {
+        free(buf);
+        return NULL;
+    }
+    *len = got;
+    return buf;
+}
+
+//decode it all a piece at a time, writing each piece as it is done
+static int decode(const char *text, size_t len, FILE *out_fp, struct lines *lines)
+{
+    struct hex_decoder d;
+    const char *p, *end = text + len, *next, *nl;
+    uint8_t *out = NULL, *tmp;
+    size_t n, cap = 0;
+    int ret = 0;
+
+    hex_decoder_init(&d, print_diag, lines);
+    for (p = text; p < end && ret == 0; p = next) {
+        //pieces end after a newline, so one is only longer than PIECE if a line is
+        next = end - p > PIECE ? p + PIECE : end;
+        if (next < end)
+            next = (nl = memchr(next - 1, '\n', end - next + 1)) ? nl + 1 : end;
+        if ((size_t)(next - p) / 2 > cap) {
+            cap = (next - p) / 2;
+            tmp = realloc(out, cap);
+            if (tmp == NULL) {
+                perror("Error allocating memory");
+                exit(EXIT_FAILURE);
+            }
+            out = tmp;
+        }
+        n = hex_decode(&d, p, next - p, out);
+        if (fwrite(out, 1, n, out_fp) != n)
+            ret = -1;
+    }
+    if (ret == 0)
+        hex_finish(&d);
+    free(out);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    struct mapping mapping;
+    struct lines lines;
+    FILE *fp = stdin;
+    char *text;
+    size_t len, chunk_size = CHUNK;
+    long threads = 1;
+    int opt, mapped, ret = EXIT_SUCCESS;
+
+    while ((opt = getopt(argc, argv, "k:j:c:")) != -1) {
+        switch (opt) {
+        case 'k':
+            if (hex_set_kernel(optarg)) {
+                fprintf(stderr, "Decoder %s isn't supported here\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'j':
+            threads = atol(optarg);
+            if (threads == 0)
+                threads = sysconf(_SC_NPROCESSORS_ONLN);
+            if (threads < 1 || threads > 1024)
+                print_usage(argv[0]);
+            break;
+        case 'c':
+            chunk_size = strtoul(optarg, NULL, 0);
+            if (chunk_size == 0)
+                print_usage(argv[0]);
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if (argc - optind > 1)
+        print_usage(argv[0]);
+    if (argc > optind && strcmp(argv[optind], "-")) {
+        fp = fopen(argv[optind], "rb");
+        if (fp == NULL) {
+            perror(argv[optind]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    //whole DSL files give a warning for nearly every character outside the buffers
+    setvbuf(stderr, NULL, isatty(fileno(stderr)) ? _IOLBF : _IOFBF, 1 << 16);
+
+    mapped = map_input(fileno(fp), &mapping) == 0;
+    if (mapped) {
+        text = (char *)mapping.data;
+        len = mapping.len;
+    } else if ((text = read_all(fp, &len)) == NULL) {
+        perror("Error reading the input");
+        return EXIT_FAILURE;
+    }
+
+    lines.pos = text;
+    lines.line = 1;
+    if (threads > 1 && len > chunk_size)
+        ret = decode_parallel(text, len, stdout, threads, chunk_size, print_diag, &lines);
+    else
+        ret = decode(text, len, stdout, &lines);
+    if (ret || fflush(stdout) || ferror(stdout)) {
+        perror("Error writing the output");
+        ret = EXIT_FAILURE;
+    }
+
+    if (mapped)
+        unmap_input(&mapping);
+    else
+        free(text);
+    if (fp != stdin)
+        fclose(fp);
+    return ret;
+}
@@ -0,0 +1,238 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+/*
+ * The only state flex carries from one line to the next is whether it is
+ * inside a comment, so the input is cut into chunks after newlines and
+ * every chunk is decoded for both possibilities at once. Chunks are then
+ * stitched in order, each taking the variant for the state the previous
+ * one ended in.
+ *
+ * Decoding everything twice is rarely needed. Starting inside a comment,
+ * the decoder is out of it after the first comment terminator; if by the
+ * end of that line the decoder that started outside is out of a comment
+ * too, the two are in the same state from there on and the rest of the
+ * chunk is shared. Only when they still differ (the other one opened a
+ * comment on that line, say) does the second variant go on to the end of
+ * the chunk.
+ *
+ * Chunks are decoded a round at a time, a few per thread, so the output
+ * held in memory stays bounded however big the input is.
+ */
+
+#define CHUNKS_PER_THREAD 4
+
+struct diag {
+    enum hex_diag diag;
+    const char *pos;
+};
+
+//output and diagnostics of a stretch of a chunk
+struct part {
+    uint8_t *out;
+    size_t out_len, out_cap;
+    struct diag *diags;
+    size_t num_diags, cap_diags;
+};
+
+struct variant {
+    struct part own;
+    int shared;                     //goes on with the outside variant from here:
+    size_t resume_out, resume_diag;
+    int in_comment;                 //state at the end of the chunk
+    const char *comment_start;      //NULL if the comment is the one carried in
+};
+
+struct chunk {
+    const char *start, *end;
+    struct variant var[2];          //starting outside, and inside a comment
+};
+
+struct round {
+    struct chunk *chunks;
+    size_t num_chunks, next;
+    pthread_mutex_t lock;
+};
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (p == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void collect(void *ctx, enum hex_diag diag, const char *pos)
+{
+    struct part *part = ctx;
+
+    if (part->num_diags == part->cap_diags) {
+        part->cap_diags = part->cap_diags ? 2 * part->cap_diags : 64;
+        part->diags = xrealloc(part->diags, part->cap_diags * sizeof(*part->diags));
+    }
+    part->diags[part->num_diags].diag = diag;
+    part->diags[part->num_diags++].pos = pos;
+}
+
+static void decode_part(struct hex_decoder *d, struct part *part, const char *p, const char *end)
+{
+    size_t need = part->out_len + (end - p) / 2;
+
+    if (need > part->out_cap) {
+        part->out_cap = need;
+        part->out = xrealloc(part->out, need);
+    }
+    d->ctx = part;
+    part->out_len += hex_decode(d, p, end - p, part->out + part->out_len);
+}
+
+static void decode_chunk(struct chunk *c)
+{
+    struct variant *outside = &c->var[0], *inside = &c->var[1];
+    struct hex_decoder d0, d1;
+    const char *p, *sync = NULL;
+
+    //where the comment carried in ends, then the end of that line
+    for (p = c->start; (p = memchr(p, '*', c->end - p)) != NULL; ) {
+        if (++p < c->end && *p == '/') {
+            sync = memchr(p, '\n', c->end - p);
+            sync = sync ? sync + 1 : c->end;
+            break;
+        }
+    }
+
+    hex_decoder_init(&d0, collect, NULL);
+    hex_decoder_init(&d1, collect, NULL);
+    d1.in_comment = 1;
+    if (sync == NULL) {
+        //all of the chunk is still in that comment
+        decode_part(&d0, &outside->own, c->start, c->end);
+        inside->in_comment = 1;
+        inside->comment_start = NULL;
+    } else {
+        decode_part(&d0, &outside->own, c->start, sync);
+        decode_part(&d1, &inside->own, c->start, sync);
+        if (!d0.in_comment && !d1.in_comment) {
+            inside->shared = 1;
+            inside->resume_out = outside->own.out_len;
+            inside->resume_diag = outside->own.num_diags;
+        }
+        decode_part(&d0, &outside->own, sync, c->end);
+        if (inside->shared)
+            d1 = d0;
+        else
+            decode_part(&d1, &inside->own, sync, c->end);
+        inside->in_comment = d1.in_comment;
+        inside->comment_start = d1.comment_start;
+    }
+    outside->in_comment = d0.in_comment;
+    outside->comment_start = d0.comment_start;
+}
+
+static void *worker_main(void *arg)
+{
+    struct round *r = arg;
+    size_t i;
+
+    while (1) {
+        pthread_mutex_lock(&r->lock);
+        i = r->next++;
+        pthread_mutex_unlock(&r->lock);
+        if (i >= r->num_chunks)
+            return NULL;
+        decode_chunk(&r->chunks[i]);
+    }
+}
+
+static int write_part(const struct part *part, size_t out_from, size_t diag_from, FILE *out_fp,
+                      hex_diag_fn diag, void *ctx)
+{
+    size_t i;
+
+    for (i = diag_from; i < part->num_diags; i++)
+        diag(ctx, part->diags[i].diag, part->diags[i].pos);
+    if (part->out_len == out_from)
+        return 0;
+    return fwrite(part->out + out_from, 1, part->out_len - out_from, out_fp)
+        != part->out_len - out_from;
+}
+
+static void free_chunk(struct chunk *c)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        free(c->var[i].own.out);
+        free(c->var[i].own.diags);
+    }
+}
+
+int decode_parallel(const char *text, size_t len, FILE *out_fp, int threads, size_t chunk_size,
+                    hex_diag_fn diag, void *ctx)
+{
+    struct round r;
+    struct chunk *c;
+    struct variant *v;
+    pthread_t *workers;
+    const char *p = text, *end = text + len, *nl, *comment_start = NULL;
+    int in_comment = 0, ret = 0, i, err;
+    size_t k;
+
+    r.chunks = xrealloc(NULL, (size_t)threads * CHUNKS_PER_THREAD * sizeof(*r.chunks));
+    workers = xrealloc(NULL, threads * sizeof(*workers));
+    pthread_mutex_init(&r.lock, NULL);
+    hex_kernel_name(); //set up the decoder before there are threads
+
+    while (p < end) {
+        //cut the next round of chunks
+        memset(r.chunks, 0, (size_t)threads * CHUNKS_PER_THREAD * sizeof(*r.chunks));
+        for (r.num_chunks = 0; p < end && r.num_chunks < (size_t)threads * CHUNKS_PER_THREAD;
+                r.num_chunks++) {
+            c = &r.chunks[r.num_chunks];
+            c->start = p;
+            p = (size_t)(end - p) > chunk_size ? p + chunk_size : end;
+            if (p < end)
+                p = (nl = memchr(p - 1, '\n', end - p + 1)) ? nl + 1 : end;
+            c->end = p;
+        }
+
+        r.next = 0;
+        for (i = 0; i < threads; i++) {
+            if ((err = pthread_create(&workers[i], NULL, worker_main, &r))) {
+                fprintf(stderr, "Error creating a thread: %s\n", strerror(err));
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (i = 0; i < threads; i++)
+            pthread_join(workers[i], NULL);
+
+        for (k = 0; k < r.num_chunks; k++) {
+            c = &r.chunks[k];
+            v = &c->var[in_comment];
+            if (ret == 0)
+                ret = write_part(&v->own, 0, 0, out_fp, diag, ctx);
+            if (ret == 0 && v->shared)
+                ret = write_part(&c->var[0].own, v->resume_out, v->resume_diag, out_fp, diag, ctx);
+            if (v->in_comment && v->comment_start)
+                comment_start = v->comment_start;
+            in_comment = v->in_comment;
+            free_chunk(c);
+        }
+        if (ret)
+            break;
+    }
+    if (ret == 0 && in_comment)
+        diag(ctx, HEX_UNTERMINATED, comment_start);
+
+    pthread_mutex_destroy(&r.lock);
+    free(workers);
+    free(r.chunks);
+    return ret ? -1 : 0;
+}
@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdio.h>
+
+#include "hexdec.h"
+
+/*
+ * hexxer -j: decode the input as chunks on a pool of threads and write
+ * exactly what decoding it in one go would have, diagnostics included,
+ * which go to diag in order. chunk_size is a minimum; chunks end after a
+ * newline. Returns 0, or -1 if writing failed.
+ */
+int decode_parallel(const char *text, size_t len, FILE *out_fp, int threads, size_t chunk_size,
+                    hex_diag_fn diag, void *ctx);
+
+#endif
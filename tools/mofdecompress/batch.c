@@ -0,0 +1,497 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "bmof.h"
+#include "mapfile.h"
+
+/*
+ * Batch mode: decode many blobs with a pool of worker threads.
+ *
+ * Every input file is one task. The task list is split into one
+ * contiguous range per worker; a worker takes tasks from the front of its
+ * own range and, once that is empty, steals the back half of another
+ * worker's range. Each output is decoded into a temporary file in the
+ * destination directory and renamed into place, so a reader never sees a
+ * partial .mof. Inputs and outputs are mapped rather than copied through
+ * buffers wherever the files allow it.
+ */
+
+struct task {
+    const char *in_path;
+    char *out_path;
+    long in_size;
+    long out_size;
+    char error[128]; //empty on success
+};
+
+struct worker {
+    pthread_mutex_t lock;
+    size_t next, end; //tasks [next, end) are still owned by this worker
+    pthread_t thread;
+    struct batch *batch;
+};
+
+struct batch {
+    struct task *tasks;
+    size_t num_tasks, cap_tasks;
+    struct worker *workers;
+    int num_workers;
+    const char *out_dir;
+};
+
+static void set_error(struct task *t, const char *what, const char *why)
+{
+    snprintf(t->error, sizeof(t->error), "%s: %s", what, why);
+}
+
+static void sys_error(struct task *t, const char *what)
+{
+    char buf[64];
+
+    set_error(t, what, strerror_r(errno, buf, sizeof(buf)) == 0 ? buf : "I/O error");
+}
+
+//read in a file that can't be mapped, such as a named pipe
+static void *read_file(struct task *t, int fd, size_t *len)
+{
+    size_t got = 0, cap = 1 << 16;
+    uint8_t *buf, *tmp;
+    ssize_t n;
+
+    buf = malloc(cap);
+    while (buf) {
+        if (got == cap) {
+            cap *= 2;
+            tmp = realloc(buf, cap);
+            if (tmp == NULL) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = tmp;
+        }
+        n = read(fd, buf + got, cap - got);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            sys_error(t, "Error reading the input file");
+            free(buf);
+            return NULL;
+        }
+        if (n == 0) {
+            *len = got;
+            return buf;
+        }
+        got += n;
+    }
+    sys_error(t, "Error allocating memory for the input file");
+    return NULL;
+}
+
+//create a temporary file next to out_path, to be renamed over it when done
+static int open_temp(struct task *t, char **tmp)
+{
+    size_t plen = strlen(t->out_path);
+    int fd;
+
+    *tmp = malloc(plen + 8);
+    if (*tmp == NULL) {
+        sys_error(t, "Error allocating memory for the output file");
+        return -1;
+    }
+    memcpy(*tmp, t->out_path, plen);
+    memcpy(*tmp + plen, ".XXXXXX", 8);
+
+    fd = mkstemp(*tmp);
+    if (fd < 0) {
+        sys_error(t, "Error opening output file for writing");
+        free(*tmp);
+        return -1;
+    }
+    fchmod(fd, 0644);
+    return fd;
+}
+
+static int write_all(struct task *t, int fd, const uint8_t *buf, size_t len)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len) {
+        n = write(fd, buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            sys_error(t, "Error writing the output file");
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/*
+ * Decode into the temporary file: straight into a mapping of it when
+ * possible, otherwise into a buffer that is then written out.
+ */
+static long decode_to(struct task *t, int fd, const uint8_t *in, size_t len, size_t out_size)
+{
+    struct mapping out;
+    uint8_t *buf;
+    long ret;
+
+    if (map_output(fd, out_size, BMOF_OUT_SLACK, &out) == 0) {
+        ret = bmof_decompress(in, len, out.data, out_size + BMOF_OUT_SLACK);
+        if (ret < 0)
+            set_error(t, "Error decompressing", bmof_strerror(ret));
+        if (unmap_output(fd, &out, ret < 0 ? 0 : ret) && ret >= 0) {
+            sys_error(t, "Error writing the output file");
+            ret = -1;
+        }
+        return ret;
+    }
+
+    buf = malloc(out_size + BMOF_OUT_SLACK);
+    if (buf == NULL) {
+        sys_error(t, "Error allocating memory for the output file");
+        return -1;
+    }
+    ret = bmof_decompress(in, len, buf, out_size + BMOF_OUT_SLACK);
+    if (ret < 0)
+        set_error(t, "Error decompressing", bmof_strerror(ret));
+    else if (write_all(t, fd, buf, ret))
+        ret = -1;
+    free(buf);
+    return ret;
+}
+
+static void run_task(struct task *t)
+{
+    struct bmof_header hdr;
+    struct mapping in;
+    uint8_t *data;
+    size_t len;
+    char *tmp;
+    long ret;
+    int fd, mapped = 0;
+
+    fd = open(t->in_path, O_RDONLY);
+    if (fd < 0) {
+        sys_error(t, "Error opening input file for reading");
+        return;
+    }
+    if (map_input(fd, &in) == 0) {
+        mapped = 1;
+        data = in.data;
+        len = in.len;
+    } else {
+        data = read_file(t, fd, &len);
+        if (data == NULL) {
+            close(fd);
+            return;
+        }
+    }
+    close(fd);
+    t->in_size = len;
+
+    ret = bmof_read_header(data, len, &hdr);
+    if (ret) {
+        set_error(t, "Bad header", bmof_strerror(ret));
+        goto out;
+    }
+
+    fd = open_temp(t, &tmp);
+    if (fd < 0)
+        goto out;
+    ret = decode_to(t, fd, data, len, hdr.out_size);
+    if (close(fd) && ret >= 0) {
+        sys_error(t, "Error writing the output file");
+        ret = -1;
+    }
+    if (ret >= 0 && rename(tmp, t->out_path)) {
+        sys_error(t, "Error renaming the output file");
+        ret = -1;
+    }
+    if (ret < 0)
+        unlink(tmp);
+    else
+        t->out_size = ret;
+    free(tmp);
+
+out:
+    if (mapped)
+        unmap_input(&in);
+    else
+        free(data);
+}
+
+//take a task from our own range, or steal half of somebody else's
+static struct task *next_task(struct worker *self)
+{
+    struct batch *b = self->batch;
+    struct task *t = NULL;
+    int i;
+
+    pthread_mutex_lock(&self->lock);
+    if (self->next < self->end)
+        t = &b->tasks[self->next++];
+    pthread_mutex_unlock(&self->lock);
+    if (t)
+        return t;
+
+    for (i = 1; i < b->num_workers; i++) {
+        struct worker *victim = &b->workers[(self - b->workers + i) % b->num_workers];
+        size_t avail, take, start = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        avail = victim->end - victim->next;
+        take = (avail + 1) / 2;
+        if (take) {
+            victim->end -= take;
+            start = victim->end;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (!take)
+            continue;
+
+        pthread_mutex_lock(&self->lock);
+        self->next = start + 1;
+        self->end = start + take;
+        pthread_mutex_unlock(&self->lock);
+        return &b->tasks[start];
+    }
+    return NULL;
+}
+
+static void *worker_main(void *arg)
+{
+    struct worker *self = arg;
+    struct task *t;
+
+    while ((t = next_task(self)) != NULL)
+        run_task(t);
+    return NULL;
+}
+
+static int has_suffix(const char *s, const char *suffix)
+{
+    size_t ls = strlen(s), lx = strlen(suffix);
+
+    return ls >= lx && !strcmp(s + ls - lx, suffix);
+}
+
+static char *output_path(const char *in_path, const char *out_dir)
+{
+    const char *base = in_path, *slash;
+    size_t dir_len, base_len;
+    char *out;
+
+    slash = strrchr(in_path, '/');
+    if (out_dir) {
+        if (slash)
+            base = slash + 1;
+        dir_len = strlen(out_dir);
+    } else {
+        dir_len = 0;
+    }
+    base_len = strlen(base);
+    if (has_suffix(base, ".bmf"))
+        base_len -= 4;
+
+    out = malloc(dir_len + 1 + base_len + 5);
+    if (out == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+    if (out_dir)
+        sprintf(out, "%s/%.*s.mof", out_dir, (int)base_len, base);
+    else
+        sprintf(out, "%.*s.mof", (int)base_len, base);
+    return out;
+}
+
+static void add_task(struct batch *b, const char *path)
+{
+    struct task *t;
+
+    if (b->num_tasks == b->cap_tasks) {
+        b->cap_tasks = b->cap_tasks ? 2 * b->cap_tasks : 256;
+        b->tasks = realloc(b->tasks, b->cap_tasks * sizeof(*b->tasks));
+        if (b->tasks == NULL) {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+    }
+    t = &b->tasks[b->num_tasks++];
+    memset(t, 0, sizeof(*t));
+    t->in_path = path;
+    t->out_path = output_path(path, b->out_dir);
+}
+
+/*
+ * Whether the file starts with a compressed blob's header. Decoded MOF
+ * starts with the signature too, but not with BMOF_VERSION after it.
+ */
+static int has_bmof_header(const char *path)
+{
+    uint8_t buf[BMOF_HEADER_SIZE];
+    struct bmof_header hdr;
+    int fd, ok;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    ok = read(fd, buf, sizeof(buf)) == sizeof(buf) &&
+         bmof_read_header(buf, sizeof(buf), &hdr) == BMOF_OK;
+    close(fd);
+    return ok;
+}
+
+/*
+ * Add path, or every blob below it if it is a directory. What is given
+ * is decoded whatever it is, but a directory may hold anything: only the
+ * files in it that start with a blob's header are taken, which also
+ * leaves out our own outputs.
+ */
+static void add_path(struct batch *b, const char *path, int top_level)
+{
+    struct dirent *de;
+    struct stat st;
+    char *child;
+    DIR *dir;
+
+    if (stat(path, &st)) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        if (top_level || (S_ISREG(st.st_mode) && has_bmof_header(path)))
+            add_task(b, path);
+        return;
+    }
+
+    dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+            continue;
+        child = malloc(strlen(path) + strlen(de->d_name) + 2);
+        if (child == NULL) {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        sprintf(child, "%s/%s", path, de->d_name);
+        add_path(b, child, 0);
+    }
+    closedir(dir);
+}
+
+static void print_batch_usage(const char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s -b [-j jobs] [-o output_dir] input...\n", prog_name);
+    fputs("\
+Decompress every Binary MOF file given, descending into directories,\n\
+where only files that start with a compressed blob's header are taken.\n\
+Each foo.bmf is written to foo.mof, next to the input or in output_dir.\n\
+Files are decoded by jobs worker threads (default: one per CPU).\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+int batch_main(int argc, char **argv)
+{
+    struct batch b = { 0 };
+    struct timespec start, end;
+    size_t i, per_worker, failed = 0;
+    double in_total = 0, out_total = 0, secs;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt, err;
+
+    while ((opt = getopt(argc, argv, "bj:o:")) != -1) {
+        switch (opt) {
+        case 'b':
+            break;
+        case 'j':
+            jobs = strtol(optarg, NULL, 10);
+            break;
+        case 'o':
+            b.out_dir = optarg;
+            break;
+        default:
+            print_batch_usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+        print_batch_usage(argv[0]);
+    if (jobs < 1)
+        jobs = 1;
+
+    for (i = optind; i < (size_t)argc; i++)
+        add_path(&b, argv[i], 1);
+    if (jobs > (long)b.num_tasks)
+        jobs = b.num_tasks ? b.num_tasks : 1;
+
+    b.num_workers = jobs;
+    b.workers = calloc(jobs, sizeof(*b.workers));
+    if (b.workers == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    per_worker = b.num_tasks / jobs;
+    for (i = 0; i < (size_t)jobs; i++) {
+        struct worker *w = &b.workers[i];
+
+        pthread_mutex_init(&w->lock, NULL);
+        w->batch = &b;
+        w->next = i * per_worker;
+        w->end = i == (size_t)jobs - 1 ? b.num_tasks : w->next + per_worker;
+    }
+    for (i = 0; i < (size_t)jobs; i++) {
+        err = pthread_create(&b.workers[i].thread, NULL, worker_main, &b.workers[i]);
+        if (err) {
+            fprintf(stderr, "Error creating worker thread: %s\n", strerror(err));
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (i = 0; i < (size_t)jobs; i++)
+        pthread_join(b.workers[i].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (i = 0; i < b.num_tasks; i++) {
+        struct task *t = &b.tasks[i];
+
+        if (t->error[0]) {
+            printf("FAILED %s: %s\n", t->in_path, t->error);
+            failed++;
+        } else {
+            printf("ok     %s -> %s (%ld -> %ld bytes)\n",
+                   t->in_path, t->out_path, t->in_size, t->out_size);
+            in_total += t->in_size;
+            out_total += t->out_size;
+        }
+        free(t->out_path);
+    }
+
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "%zu files, %zu failed, %.0f -> %.0f bytes in %.3f s with %ld jobs (%.1f MB/s out)\n",
+            b.num_tasks, failed, in_total, out_total, secs, jobs,
+            secs > 0 ? out_total / secs / 1e6 : 0.0);
+
+    free(b.workers);
+    free(b.tasks);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,7 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+//mofdecompress -b ...: decode many files on a pool of worker threads
+int batch_main(int argc, char **argv);
+
+#endif
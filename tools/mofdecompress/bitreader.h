@@ -0,0 +1,112 @@
+#ifndef BITREADER_H
+#define BITREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+/*
+ * LSB-first bit reader for the BMOF bitstream.
+ *
+ * Unread bits live in a 64-bit buffer with the next bit in bit 0, so
+ * peeking at a field is a mask and consuming it is a shift. The buffer
+ * is refilled a whole little-endian word at a time while at least 8
+ * input bytes remain, and a byte at a time over the tail. Bits above
+ * `count` may hold a copy of the next input bits left over from a word
+ * refill; they are never returned and get OR'd over with the same
+ * values on the next refill.
+ */
+struct bitreader {
+    uint64_t buf;        // unread bits, next one in bit 0
+    unsigned int count;  // number of valid bits in buf
+    const uint8_t *ptr;  // next input byte to load into buf
+    const uint8_t *end;  // one past the last input byte
+};
+
+static inline void br_init(struct bitreader *br, const uint8_t *ptr, size_t len)
+{
+    br->buf = 0;
+    br->count = 0;
+    br->ptr = ptr;
+    br->end = ptr + len;
+}
+
+//top the buffer up to at least 56 bits, or as much input as is left
+static inline void br_refill(struct bitreader *br)
+{
+    if (br->end - br->ptr >= 8) {
+        uint64_t word;
+
+        memcpy(&word, br->ptr, 8);
+        br->buf |= le64toh(word) << br->count;
+        br->ptr += (63 - br->count) >> 3;
+        br->count |= 56;
+    } else {
+        while (br->count <= 56 && br->ptr < br->end) {
+            br->buf |= (uint64_t)*br->ptr++ << br->count;
+            br->count += 8;
+        }
+    }
+}
+
+//make sure n bits (n <= 56) are buffered, returns 0 or -1 if out of input
+static inline int br_ensure(struct bitreader *br, unsigned int n)
+{
+    if (__builtin_expect(br->count < n, 0)) {
+        br_refill(br);
+        if (br->count < n)
+            return -1;
+    }
+    return 0;
+}
+
+static inline uint32_t br_peek(const struct bitreader *br, unsigned int n)
+{
+    return (uint32_t)(br->buf & ((UINT64_C(1) << n) - 1));
+}
+
+static inline void br_consume(struct bitreader *br, unsigned int n)
+{
+    br->buf >>= n;
+    br->count -= n;
+}
+
+//read n bits into v, jumping to label if the input runs out
+#define BR_GET(br, v, n, label) do { \
+        if (br_ensure((br), (n))) \
+            goto label; \
+        (v) = br_peek((br), (n)); \
+        br_consume((br), (n)); \
+    } while (0)
+
+/*
+ * Count the zero bits in front of the next one bit and consume them
+ * together with the one bit. Returns the count, max if there are at
+ * least max zero bits (leaving the rest unread), or -1 if the input ends
+ * before a one bit is found.
+ */
+static inline int br_zeros(struct bitreader *br, int max)
+{
+    int zeros = 0;
+
+    for (;;) {
+        unsigned int z;
+
+        if (br_ensure(br, 1))
+            return -1;
+        z = br->buf ? __builtin_ctzll(br->buf) : 64;
+        if (z < br->count) {
+            br_consume(br, z + 1);
+            zeros += z;
+            return zeros < max ? zeros : max;
+        }
+        zeros += br->count;
+        br->buf = 0;
+        br->count = 0;
+        if (zeros >= max)
+            return max;
+    }
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include <string.h>
+#include <endian.h>
+
+#include "bmof.h"
+
+int bmof_read_header(const void *buf, size_t len, struct bmof_header *hdr)
+{
+    uint32_t words[4];
+
+    //DWORD 0 is FOMB = (opposite in hex edit due to little endian) 424d4f46 = 1112362822
+    //DWORD 1 appears to have to be the number 1, probably a version number
+    //DWORD 2 appears to be the size of the data, which is the size of this input file, less 16 bytes for the header
+    //DWORD 3 is little endian expected expanded file size
+    if (len < BMOF_HEADER_SIZE)
+        return BMOF_ERR_TRUNCATED;
+    memcpy(words, buf, sizeof(words));
+    hdr->signature = le32toh(words[0]);
+    hdr->version = le32toh(words[1]);
+    hdr->in_size = le32toh(words[2]);
+    hdr->out_size = le32toh(words[3]);
+
+    if (hdr->signature != BMOF_SIGNATURE || hdr->version != BMOF_VERSION)
+        return BMOF_ERR_HEADER;
+    if (hdr->in_size <= 4)
+        return BMOF_ERR_TRUNCATED;
+    return BMOF_OK;
+}
+
+void bmof_decoder_init(struct bmof_decoder *d, const void *in, size_t in_size)
+{
+    br_init(&d->br, in, in_size);
+    d->out = d->out_pos = d->out_end = NULL;
+    d->out_slack = 0;
+}
+
+#define GET_BITS(v, n) BR_GET(&br, v, n, truncated)
+
+/*
+ * Copy a len byte match from dist bytes back and return the new output
+ * position. room is how much may be written from op on, slack included.
+ * With 32 bytes to spare the copy goes in 8/16/32 byte moves, each never
+ * reaching into bytes it writes itself, and may run up to 31 bytes past
+ * the end of the match; whatever it leaves there is overwritten by the
+ * following tokens, or lands in the caller's slack.
+ */
+static inline uint8_t *copy_match(uint8_t *op, uint32_t dist, uint32_t len, size_t room)
+{
+    //smallest multiple of dist that is at least 8, for dist < 8
+    static const uint8_t pattern_step[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+    const uint8_t *src = op - dist;
+    uint8_t *end = op + len;
+    uint32_t i, step;
+
+    if (room < len + 32) {
+        do {
+            *op++ = *src++;
+        } while (--len);
+        return op;
+    }
+
+    if (dist >= 32) {
+        do {
+            memcpy(op, src, 32);
+            op += 32;
+            src += 32;
+        } while (op < end);
+    } else if (dist >= 16) {
+        do {
+            memcpy(op, src, 16);
+            op += 16;
+            src += 16;
+        } while (op < end);
+    } else if (dist >= 8) {
+        do {
+            memcpy(op, src, 8);
+            op += 8;
+            src += 8;
+        } while (op < end);
+    } else {
+        //short period: repeat it byte by byte until a whole number of
+        //periods covers 8 bytes, then copy 8 bytes at a time from that far back
+        step = pattern_step[dist];
+        for (i = 0; i < step; i++)
+            op[i] = src[i];
+        op += step;
+        src = op - step;
+        while (op < end) {
+            memcpy(op, src, 8);
+            op += 8;
+            src += 8;
+        }
+    }
+    return end;
+}
+
+long bmof_decode(struct bmof_decoder *d, uint8_t *out, size_t out_size)
+{
+    struct bitreader br = d->br; //local copy so it stays in registers
+    uint8_t *op = out, *out_end = out + out_size, *out_limit = out_end + d->out_slack;
+    uint32_t tag, dist, len, v;
+    long ret;
+    int zeros;
+
+    GET_BITS(v, 16);
+    if (v != ('D' | 'S' << 8)) {
+        ret = BMOF_ERR_FORMAT;
+        goto done;
+    }
+    GET_BITS(v, 16); //skip the rest of the 4 byte block header
+
+    while (1) {
+        GET_BITS(tag, 2);
+        if (tag == 1 || tag == 2) { //literal, tag 1 sets the top bit
+            if (op == out_end)
+                goto overflow;
+            GET_BITS(v, 7);
+            *op++ = v | (tag == 1) << 7;
+            continue;
+        }
+
+        if (tag) {
+            GET_BITS(v, 1);
+            if (v) {
+                GET_BITS(dist, 12);
+                dist += 320;
+            } else {
+                GET_BITS(dist, 8);
+                dist += 64;
+            }
+        } else {
+            GET_BITS(dist, 6);
+        }
+        if (dist == BMOF_END_MARKER) {
+            if (op - out >= out_size)
+                break;
+            continue;
+        }
+        if (dist == 0 || dist > op - out) {
+            ret = BMOF_ERR_DISTANCE;
+            goto done;
+        }
+
+        zeros = br_zeros(&br, 32);
+        if (zeros < 0)
+            goto truncated;
+        if (zeros == 32) {
+            ret = BMOF_ERR_LENGTH;
+            goto done;
+        }
+        if (zeros) {
+            GET_BITS(len, zeros);
+            len += (1u << zeros) + 1;
+        } else {
+            len = 2;
+        }
+
+        if (len > out_end - op)
+            goto overflow;
+        op = copy_match(op, dist, len, out_limit - op);
+    }
+    ret = op - out;
+    goto done;
+
+truncated:
+    ret = BMOF_ERR_TRUNCATED;
+    goto done;
+overflow:
+    ret = BMOF_ERR_OVERFLOW;
+done:
+    d->br = br;
+    d->out = out;
+    d->out_pos = op;
+    d->out_end = out_end;
+    return ret;
+}
+
+long bmof_decompress(const void *blob, size_t len, uint8_t *out, size_t out_size)
+{
+    struct bmof_decoder d;
+    struct bmof_header hdr;
+    int err;
+
+    err = bmof_read_header(blob, len, &hdr);
+    if (err)
+        return err;
+    if (len - BMOF_HEADER_SIZE < hdr.in_size)
+        return BMOF_ERR_TRUNCATED;
+    if (out_size < hdr.out_size)
+        return BMOF_ERR_OVERFLOW;
+    bmof_decoder_init(&d, (const uint8_t *)blob + BMOF_HEADER_SIZE, hdr.in_size);
+    d.out_slack = out_size - hdr.out_size;
+    return bmof_decode(&d, out, hdr.out_size);
+}
+
+const char *bmof_strerror(int err)
+{
+    switch (err) {
+    case BMOF_OK:
+        return "Success";
+    case BMOF_ERR_HEADER:
+        return "Input is not a valid binary MOF file";
+    case BMOF_ERR_TRUNCATED:
+        return "Ran out of input to use";
+    case BMOF_ERR_FORMAT:
+        return "Unknown compression format";
+    case BMOF_ERR_LENGTH:
+        return "Invalid match length";
+    case BMOF_ERR_OVERFLOW:
+        return "Data expands past the size given in the header";
+    case BMOF_ERR_WRITE:
+        return "Error writing the output";
+    case BMOF_ERR_NOMEM:
+        return "Out of memory";
+    case BMOF_ERR_DISTANCE:
+        return "Match reaches back before the start of the output";
+    case BMOF_ERR_RECORD:
+        return "Malformed record in the MOF data";
+    }
+    return "Unknown error";
+}
@@ -0,0 +1,154 @@
+#ifndef BMOF_H
+#define BMOF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitreader.h"
+
+/*
+ * libbmof - decoder for compressed binary MOF ("FOMB") blobs, as found in
+ * the WQxx buffers of a DSDT and in the resources of the Clevo hotkey
+ * drivers.
+ *
+ * A blob is a 16 byte header followed by in_size bytes of compressed
+ * data. All state lives in a struct bmof_decoder owned by the caller, so
+ * any number of blobs can be decoded at once from different threads.
+ */
+
+#define BMOF_SIGNATURE   0x424d4f46 //"FOMB" read as little endian
+#define BMOF_VERSION     1
+#define BMOF_HEADER_SIZE 16
+
+//the distance that marks the end of the compressed stream
+#define BMOF_END_MARKER  4415
+
+enum bmof_error {
+    BMOF_OK             =  0,
+    BMOF_ERR_HEADER     = -1, //bad signature or version
+    BMOF_ERR_TRUNCATED  = -2, //ran out of input
+    BMOF_ERR_FORMAT     = -3, //compressed data doesn't start with "DS"
+    BMOF_ERR_LENGTH     = -4, //match length can't be encoded by the format
+    BMOF_ERR_OVERFLOW   = -5, //data expands past the size in the header
+    BMOF_ERR_WRITE      = -6, //the stream write callback failed
+    BMOF_ERR_NOMEM      = -7, //out of memory
+    BMOF_ERR_DISTANCE   = -8, //match reaches back before the start of the output
+    BMOF_ERR_RECORD     = -9, //malformed record in decompressed MOF data
+};
+
+struct bmof_header {
+    uint32_t signature;
+    uint32_t version;
+    uint32_t in_size;  //compressed bytes following the header
+    uint32_t out_size; //expanded size
+};
+
+/*
+ * Scratch bytes past the end of the output worth providing: with at least
+ * this much slack, match copies can use wide moves right up to the end.
+ */
+#define BMOF_OUT_SLACK   32
+
+struct bmof_decoder {
+    struct bitreader br;
+    uint8_t *out;      //start of the output buffer
+    uint8_t *out_pos;  //next byte to write
+    uint8_t *out_end;  //end of the output buffer
+    size_t out_slack;  //writable scratch bytes after out_end, 0 after init
+};
+
+//parse and validate the header at the start of buf
+int bmof_read_header(const void *buf, size_t len, struct bmof_header *hdr);
+
+//set up d to decode the in_size bytes of compressed data at in
+void bmof_decoder_init(struct bmof_decoder *d, const void *in, size_t in_size);
+
+/*
+ * Decode the stream into out, which must hold out_size bytes plus
+ * d->out_slack bytes whose contents don't matter. Returns
+ * the number of bytes expanded (equal to out_size on success), or a
+ * negative enum bmof_error.
+ */
+long bmof_decode(struct bmof_decoder *d, uint8_t *out, size_t out_size);
+
+/*
+ * Convenience wrapper for a whole blob in memory: checks the header and
+ * decodes into out, which must hold at least hdr.out_size bytes. Any
+ * space beyond that is used as slack.
+ */
+long bmof_decompress(const void *blob, size_t len, uint8_t *out, size_t out_size);
+
+/*
+ * Streaming decoder, for input that arrives in pieces (a pipe) and output
+ * that is too big to keep around.
+ *
+ * Back-references reach at most BMOF_END_MARKER - 1 bytes back, so only a
+ * window of recent output is kept; everything older is handed to the
+ * write callback as soon as the window wraps, and whatever is pending at
+ * the end of each bmof_stream_feed() is flushed too. Memory use is fixed
+ * at sizeof(struct bmof_stream), independent of the blob size.
+ */
+#define BMOF_WINDOW_SIZE   16384 //power of two, larger than any distance
+#define BMOF_STREAM_CHUNK  65536 //compressed bytes buffered at most
+
+//should return 0, or non-zero to abort decoding with BMOF_ERR_WRITE
+typedef int (*bmof_write_fn)(void *ctx, const uint8_t *buf, size_t len);
+
+struct bmof_stream {
+    struct bmof_header hdr;
+    struct bitreader br;     //reads from in[]
+    uint32_t in_left;        //compressed bytes still to be fed
+    uint64_t produced;       //bytes decoded so far
+    uint32_t flushed;        //window position written out up to
+    int started;             //block header consumed
+    int done;                //end marker seen
+    bmof_write_fn write;
+    void *ctx;
+    uint8_t in[BMOF_STREAM_CHUNK + 64];
+    uint8_t window[BMOF_WINDOW_SIZE];
+};
+
+//hdr is the already parsed header of the blob whose data will be fed in
+void bmof_stream_init(struct bmof_stream *s, const struct bmof_header *hdr,
+                      bmof_write_fn write, void *ctx);
+
+/*
+ * Feed the next len bytes of compressed data, i.e. what follows the
+ * header. Returns BMOF_OK or a negative enum bmof_error. Input past the
+ * end of the stream is ignored.
+ */
+int bmof_stream_feed(struct bmof_stream *s, const void *buf, size_t len);
+
+/*
+ * Signal the end of the input. Returns the number of bytes expanded, or a
+ * negative enum bmof_error if the stream was cut short.
+ */
+long bmof_stream_finish(struct bmof_stream *s);
+
+/*
+ * Compressor. Output is cut into blocks of BMOF_BLOCK_SIZE expanded bytes,
+ * each closed by an end marker, as in the blobs Windows tools produce.
+ * BMOF_LEVEL_FAST takes the longest match a short hash chain walk finds;
+ * BMOF_LEVEL_BEST searches much further and picks the cheapest parse of
+ * every block.
+ */
+#define BMOF_BLOCK_SIZE  512
+
+enum bmof_level {
+    BMOF_LEVEL_FAST,
+    BMOF_LEVEL_BEST,
+};
+
+//largest blob, header included, that len bytes of input can compress to
+size_t bmof_compress_bound(size_t len);
+
+/*
+ * Compress len bytes from in into a complete blob at out, which must hold
+ * at least bmof_compress_bound(len) bytes. Returns the size of the blob,
+ * or a negative enum bmof_error.
+ */
+long bmof_compress(const void *in, size_t len, uint8_t *out, size_t out_size, int level);
+
+const char *bmof_strerror(int err);
+
+#endif
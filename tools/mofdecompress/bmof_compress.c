@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+
+#include "bmof.h"
+
+/*
+ * Compressor producing the same bitstream bmof_decode() consumes.
+ *
+ * Matches are found with hash chains: head[] holds the latest position
+ * for each hash of 3 bytes and prev[] links every position to the one
+ * before it with the same hash. Positions are stored plus one, so 0 means
+ * none. prev[] is indexed modulo CHAIN_SIZE, which is larger than the
+ * furthest distance, so an entry is never overwritten while a walk can
+ * still reach it. Two byte matches, which the format can still encode
+ * cheaper than two literals, come from a direct table of the last
+ * position of every byte pair.
+ *
+ * Like the streams Windows produces, the data is cut into blocks of
+ * BMOF_BLOCK_SIZE output bytes, each ended by an end marker. No token
+ * spans two blocks, but matches reach back into earlier ones.
+ */
+
+#define MAX_DIST    (BMOF_END_MARKER - 1)
+#define HASH_BITS   15
+#define CHAIN_SIZE  8192 //power of two, larger than MAX_DIST
+#define CHAIN_MASK  (CHAIN_SIZE - 1)
+
+#define LITERAL_BITS 9
+#define INF_BITS     0xffffffffu
+
+//distances are coded in 3 ranges of increasing cost: < 64, < 320, < 4415
+enum { NEAR, MID, FAR, NUM_RANGES };
+
+struct level_params {
+    uint32_t depth;     //chain entries looked at per position
+    uint32_t nice_len;  //stop looking once a match is this long
+};
+
+static const struct level_params levels[] = {
+    [BMOF_LEVEL_FAST] = { 8, 32 },
+    [BMOF_LEVEL_BEST] = { 512, 256 },
+};
+
+struct matcher {
+    const uint8_t *in;
+    uint32_t len;
+    uint32_t inserted; //positions below this are in the tables
+    uint32_t head[1 << HASH_BITS];
+    uint32_t prev[CHAIN_SIZE];
+    uint32_t head2[1 << 16];
+};
+
+//longest match found in each distance range, len 0 if none
+struct candidates {
+    uint32_t len[NUM_RANGES];
+    uint32_t dist[NUM_RANGES];
+};
+
+struct bitwriter {
+    uint8_t *ptr;
+    uint64_t acc;
+    unsigned count;
+};
+
+static inline void bw_put(struct bitwriter *bw, uint32_t v, unsigned n)
+{
+    bw->acc |= (uint64_t)v << bw->count;
+    bw->count += n;
+    while (bw->count >= 8) {
+        *bw->ptr++ = bw->acc;
+        bw->acc >>= 8;
+        bw->count -= 8;
+    }
+}
+
+static inline int dist_range(uint32_t dist)
+{
+    return dist < 64 ? NEAR : dist < 320 ? MID : FAR;
+}
+
+//bits taken by a match; the length is coded as an Elias gamma code of len - 1
+static inline uint32_t match_bits(int range, uint32_t len)
+{
+    static const uint8_t dist_bits[NUM_RANGES] = { 2 + 6, 2 + 1 + 8, 2 + 1 + 12 };
+
+    return dist_bits[range] + 2 * (31 - __builtin_clz(len - 1)) + 1;
+}
+
+static void put_match(struct bitwriter *bw, uint32_t dist, uint32_t len)
+{
+    uint32_t m = len - 1;
+    unsigned k = 31 - __builtin_clz(m);
+
+    if (dist < 64) {
+        bw_put(bw, 0, 2);
+        bw_put(bw, dist, 6);
+    } else if (dist < 320) {
+        bw_put(bw, 3, 2);
+        bw_put(bw, 0, 1);
+        bw_put(bw, dist - 64, 8);
+    } else {
+        bw_put(bw, 3, 2);
+        bw_put(bw, 1, 1);
+        bw_put(bw, dist - 320, 12);
+    }
+    bw_put(bw, 1u << k, k + 1); //k zeros, then a one
+    if (k)
+        bw_put(bw, m - (1u << k), k);
+}
+
+static inline void put_literal(struct bitwriter *bw, uint8_t byte)
+{
+    bw_put(bw, byte & 0x80 ? 1 : 2, 2);
+    bw_put(bw, byte & 0x7f, 7);
+}
+
+static inline void put_end_marker(struct bitwriter *bw)
+{
+    bw_put(bw, 3, 2);
+    bw_put(bw, 1, 1);
+    bw_put(bw, BMOF_END_MARKER - 320, 12);
+}
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+//add every position below pos to the tables
+static void insert_to(struct matcher *m, uint32_t pos)
+{
+    const uint8_t *in = m->in;
+    uint32_t i, h;
+
+    for (i = m->inserted; i < pos; i++) {
+        if (i + 3 <= m->len) {
+            h = hash3(in + i);
+            m->prev[i & CHAIN_MASK] = m->head[h];
+            m->head[h] = i + 1;
+        }
+        if (i + 2 <= m->len)
+            m->head2[in[i] | in[i + 1] << 8] = i + 1;
+    }
+    if (pos > m->inserted)
+        m->inserted = pos;
+}
+
+static inline uint32_t common_len(const uint8_t *a, const uint8_t *b, uint32_t max)
+{
+    uint64_t x, y;
+    uint32_t n = 0;
+
+    while (n + 8 <= max) {
+        memcpy(&x, a + n, 8);
+        memcpy(&y, b + n, 8);
+        if (x != y)
+            return n + (__builtin_ctzll(le64toh(x ^ y)) >> 3);
+        n += 8;
+    }
+    while (n < max && a[n] == b[n])
+        n++;
+    return n;
+}
+
+/*
+ * Find the longest match at pos in each distance range, at most max_len
+ * long. The chain is walked nearest first, so within a range the first
+ * match of a given length is also the cheapest one.
+ */
+static void find_matches(struct matcher *m, uint32_t pos, uint32_t max_len,
+                         const struct level_params *lp, struct candidates *c)
+{
+    const uint8_t *in = m->in, *cur = in + pos;
+    uint32_t depth = lp->depth, nice = lp->nice_len < max_len ? lp->nice_len : max_len;
+    uint32_t cand, dist, len, best = 1;
+    int r;
+
+    memset(c, 0, sizeof(*c));
+    if (max_len < 2)
+        return;
+
+    if (pos + 3 <= m->len) {
+        cand = m->head[hash3(cur)];
+        while (cand && depth--) {
+            cand--;
+            dist = pos - cand;
+            if (dist > MAX_DIST)
+                break;
+            //a longer match than the best so far must also agree on its last byte
+            if (in[cand + best] == cur[best]) {
+                len = common_len(in + cand, cur, max_len);
+                r = dist_range(dist);
+                if (len > c->len[r]) {
+                    c->len[r] = len;
+                    c->dist[r] = dist;
+                }
+                if (len > best) {
+                    best = len;
+                    if (best >= nice)
+                        break;
+                }
+            }
+            if (best >= max_len)
+                break;
+            cand = m->prev[cand & CHAIN_MASK];
+            if (cand > pos - dist) //stale link from a recycled slot
+                break;
+        }
+    }
+
+    //two byte matches are all the hash chains can't provide
+    if (best < 2) {
+        cand = m->head2[cur[0] | cur[1] << 8];
+        if (cand && pos - (cand - 1) <= MAX_DIST) {
+            dist = pos - (cand - 1);
+            r = dist_range(dist);
+            c->len[r] = 2;
+            c->dist[r] = dist;
+        }
+    }
+}
+
+//tokens for the block [start, end), longest match first
+static void block_greedy(struct matcher *m, struct bitwriter *bw, uint32_t start, uint32_t end,
+                         const struct level_params *lp)
+{
+    struct candidates c;
+    uint32_t pos = start, len, dist, saved, best_saved;
+    int r;
+
+    while (pos < end) {
+        insert_to(m, pos);
+        find_matches(m, pos, end - pos, lp, &c);
+
+        //pick the match saving the most bits over literals
+        len = dist = best_saved = 0;
+        for (r = NEAR; r < NUM_RANGES; r++) {
+            if (c.len[r] < 2)
+                continue;
+            saved = c.len[r] * LITERAL_BITS - match_bits(r, c.len[r]);
+            if (saved > best_saved) {
+                best_saved = saved;
+                len = c.len[r];
+                dist = c.dist[r];
+            }
+        }
+
+        if (len) {
+            put_match(bw, dist, len);
+            pos += len;
+        } else {
+            put_literal(bw, m->in[pos]);
+            pos++;
+        }
+    }
+}
+
+/*
+ * Tokens for the block [start, end) with the fewest bits, by shortest
+ * path over the positions of the block. A nearer range is cheaper for
+ * every length, so a farther range only adds the lengths beyond what the
+ * nearer ones reach. Past a match of nice_len or more, positions are not
+ * searched again until its end.
+ */
+static void block_optimal(struct matcher *m, struct bitwriter *bw, uint32_t start, uint32_t end,
+                          const struct level_params *lp)
+{
+    uint32_t cost[BMOF_BLOCK_SIZE + 1];
+    uint16_t from_len[BMOF_BLOCK_SIZE + 1], tokens[BMOF_BLOCK_SIZE];
+    uint16_t from_dist[BMOF_BLOCK_SIZE + 1];
+    uint32_t n = end - start, i, l, lo, bits, skip_to = 0;
+    struct candidates c;
+    int r, num_tokens = 0;
+
+    cost[0] = 0;
+    for (i = 1; i <= n; i++)
+        cost[i] = INF_BITS;
+
+    for (i = 0; i < n; i++) {
+        if (cost[i] + LITERAL_BITS < cost[i + 1]) {
+            cost[i + 1] = cost[i] + LITERAL_BITS;
+            from_len[i + 1] = 1;
+        }
+        if (i < skip_to)
+            continue;
+
+        insert_to(m, start + i);
+        find_matches(m, start + i, n - i, lp, &c);
+        lo = 2;
+        for (r = NEAR; r < NUM_RANGES; r++) {
+            for (l = lo; l <= c.len[r]; l++) {
+                bits = cost[i] + match_bits(r, l);
+                if (bits < cost[i + l]) {
+                    cost[i + l] = bits;
+                    from_len[i + l] = l;
+                    from_dist[i + l] = c.dist[r];
+                }
+            }
+            if (c.len[r] >= lo)
+                lo = c.len[r] + 1;
+            if (c.len[r] >= lp->nice_len)
+                skip_to = i + c.len[r];
+        }
+    }
+
+    //walk back from the end of the block, then emit front to back
+    for (i = n; i > 0; i -= from_len[i])
+        tokens[num_tokens++] = i;
+    while (num_tokens--) {
+        i = tokens[num_tokens];
+        if (from_len[i] == 1)
+            put_literal(bw, m->in[start + i - 1]);
+        else
+            put_match(bw, from_dist[i], from_len[i]);
+    }
+}
+
+size_t bmof_compress_bound(size_t len)
+{
+    //9 bits per literal, a 15 bit end marker per block plus the final one
+    return BMOF_HEADER_SIZE + 4 + len + len / 8 + 2 * (len / BMOF_BLOCK_SIZE + 2) + 1;
+}
+
+long bmof_compress(const void *in, size_t len, uint8_t *out, size_t out_size, int level)
+{
+    const struct level_params *lp;
+    struct bitwriter bw;
+    struct matcher *m;
+    uint32_t start, end, words[4];
+    size_t total;
+
+    if (level != BMOF_LEVEL_FAST)
+        level = BMOF_LEVEL_BEST;
+    lp = &levels[level];
+    if (len > UINT32_MAX || out_size < bmof_compress_bound(len)
+            || bmof_compress_bound(len) > (size_t)UINT32_MAX + BMOF_HEADER_SIZE)
+        return BMOF_ERR_OVERFLOW;
+
+    m = calloc(1, sizeof(*m));
+    if (m == NULL)
+        return BMOF_ERR_NOMEM;
+    m->in = in;
+    m->len = len;
+
+    memcpy(out + BMOF_HEADER_SIZE, "DS\x00\x01", 4);
+    bw.ptr = out + BMOF_HEADER_SIZE + 4;
+    bw.acc = 0;
+    bw.count = 0;
+
+    for (start = 0; start < len; start = end) {
+        end = len - start > BMOF_BLOCK_SIZE ? start + BMOF_BLOCK_SIZE : len;
+        if (level == BMOF_LEVEL_FAST)
+            block_greedy(m, &bw, start, end, lp);
+        else
+            block_optimal(m, &bw, start, end, lp);
+        put_end_marker(&bw);
+    }
+    if (len == 0)
+        put_end_marker(&bw);
+    bw_put(&bw, 0, 7); //flush the last partial byte
+    free(m);
+
+    total = bw.ptr - out;
+    words[0] = htole32(BMOF_SIGNATURE);
+    words[1] = htole32(BMOF_VERSION);
+    words[2] = htole32(total - BMOF_HEADER_SIZE);
+    words[3] = htole32(len);
+    memcpy(out, words, sizeof(words));
+    return total;
+}
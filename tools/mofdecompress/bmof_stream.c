@@ -0,0 +1,192 @@
+#include <string.h>
+
+#include "bmof.h"
+
+/*
+ * Worst case compressed size of one token: 2 tag bits, 13 distance bits,
+ * 31 zeros, the one bit and 31 length bits. Unless the input is complete,
+ * a token is only started when this much is buffered, so running out of
+ * bits always means the stream really is truncated.
+ */
+#define MAX_TOKEN_BYTES 16
+
+#define WINDOW_MASK (BMOF_WINDOW_SIZE - 1)
+
+#define GET_BITS(v, n) BR_GET(&br, v, n, truncated)
+
+void bmof_stream_init(struct bmof_stream *s, const struct bmof_header *hdr,
+                      bmof_write_fn write, void *ctx)
+{
+    s->hdr = *hdr;
+    br_init(&s->br, s->in, 0);
+    s->in_left = hdr->in_size;
+    s->produced = 0;
+    s->flushed = 0;
+    s->started = 0;
+    s->done = 0;
+    s->write = write;
+    s->ctx = ctx;
+    memset(s->window, 0, sizeof(s->window));
+}
+
+//hand window[flushed, pos) to the write callback
+static int flush(struct bmof_stream *s, uint32_t pos)
+{
+    if (pos > s->flushed && s->write(s->ctx, s->window + s->flushed, pos - s->flushed))
+        return BMOF_ERR_WRITE;
+    s->flushed = pos & WINDOW_MASK;
+    return BMOF_OK;
+}
+
+//decode as many tokens as the buffered input allows
+static int run(struct bmof_stream *s, int eof)
+{
+    struct bitreader br = s->br;
+    uint8_t *win = s->window;
+    uint64_t produced = s->produced, out_size = s->hdr.out_size;
+    uint32_t pos = produced & WINDOW_MASK, src, tag, dist, len, n, v;
+    int zeros, ret = BMOF_OK;
+
+    if (!s->started) {
+        if (!eof && br.end - br.ptr < 4)
+            return BMOF_OK;
+        GET_BITS(v, 16);
+        if (v != ('D' | 'S' << 8)) {
+            ret = BMOF_ERR_FORMAT;
+            goto done;
+        }
+        GET_BITS(v, 16); //skip the rest of the 4 byte block header
+        s->started = 1;
+    }
+
+    while (!s->done) {
+        if (!eof && br.end - br.ptr < MAX_TOKEN_BYTES)
+            break;
+
+        GET_BITS(tag, 2);
+        if (tag == 1 || tag == 2) { //literal, tag 1 sets the top bit
+            if (produced == out_size)
+                goto overflow;
+            GET_BITS(v, 7);
+            win[pos++] = v | (tag == 1) << 7;
+            produced++;
+            if (pos == BMOF_WINDOW_SIZE) {
+                if ((ret = flush(s, pos)))
+                    goto done;
+                pos = 0;
+            }
+            continue;
+        }
+
+        if (tag) {
+            GET_BITS(v, 1);
+            if (v) {
+                GET_BITS(dist, 12);
+                dist += 320;
+            } else {
+                GET_BITS(dist, 8);
+                dist += 64;
+            }
+        } else {
+            GET_BITS(dist, 6);
+        }
+        if (dist == BMOF_END_MARKER) {
+            if (produced >= out_size)
+                s->done = 1;
+            continue;
+        }
+        if (dist == 0 || dist > produced) {
+            ret = BMOF_ERR_DISTANCE;
+            goto done;
+        }
+
+        zeros = br_zeros(&br, 32);
+        if (zeros < 0)
+            goto truncated;
+        if (zeros == 32) {
+            ret = BMOF_ERR_LENGTH;
+            goto done;
+        }
+        if (zeros) {
+            GET_BITS(len, zeros);
+            len += (1u << zeros) + 1;
+        } else {
+            len = 2;
+        }
+        if (len > out_size - produced)
+            goto overflow;
+        produced += len;
+
+        /*
+         * Copy in runs that wrap neither the source nor the destination.
+         * The source is at most 4414 bytes back, so once it has wrapped
+         * it lies well ahead of the destination and the two can't meet.
+         */
+        src = (pos - dist) & WINDOW_MASK;
+        while (len) {
+            n = len;
+            if (n > BMOF_WINDOW_SIZE - pos)
+                n = BMOF_WINDOW_SIZE - pos;
+            if (n > BMOF_WINDOW_SIZE - src)
+                n = BMOF_WINDOW_SIZE - src;
+            len -= n;
+            while (n--)
+                win[pos++] = win[src++];
+            src &= WINDOW_MASK;
+            if (pos == BMOF_WINDOW_SIZE) {
+                if ((ret = flush(s, pos)))
+                    goto done;
+                pos = 0;
+            }
+        }
+    }
+    ret = flush(s, pos);
+    goto done;
+
+truncated:
+    ret = BMOF_ERR_TRUNCATED;
+    goto done;
+overflow:
+    ret = BMOF_ERR_OVERFLOW;
+done:
+    s->br = br;
+    s->produced = produced;
+    return ret;
+}
+
+int bmof_stream_feed(struct bmof_stream *s, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    size_t unread, n;
+    int ret;
+
+    if (len > s->in_left)
+        len = s->in_left;
+
+    while (len && !s->done) {
+        //move the unread tail to the front and top the buffer up
+        unread = s->br.end - s->br.ptr;
+        memmove(s->in, s->br.ptr, unread);
+        n = BMOF_STREAM_CHUNK - unread;
+        if (n > len)
+            n = len;
+        memcpy(s->in + unread, p, n);
+        s->br.ptr = s->in;
+        s->br.end = s->in + unread + n;
+        s->in_left -= n;
+        p += n;
+        len -= n;
+
+        ret = run(s, s->in_left == 0);
+        if (ret)
+            return ret;
+    }
+    return BMOF_OK;
+}
+
+long bmof_stream_finish(struct bmof_stream *s)
+{
+    if (!s->done)
+        return BMOF_ERR_TRUNCATED;
+    return s->produced;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//copy_match() is static to the decoder, so build the check with it
+#include "bmof.c"
+
+/*
+ * Check copy_match() against the byte loop it replaced: randomized
+ * streams of literal runs and matches, at distances 1-40 and lengths
+ * from 1 up to a few hundred bytes, are expanded both ways, with the
+ * wide copies given no slack after the output (as at the end of a
+ * buffer) and with BMOF_OUT_SLACK of it. The output has to be the same
+ * byte for byte, each copy has to end where the match does, and nothing
+ * past the slack may be written.
+ */
+
+#define STREAMS    2000
+#define MAX_OUT    (64 << 10)
+#define MAX_DIST   40
+#define GUARD      64
+
+static uint32_t rnd(uint64_t *s) //xorshift64*
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return (*s * UINT64_C(2685821657736338717)) >> 32;
+}
+
+static void copy_bytes(uint8_t *op, uint32_t dist, uint32_t len)
+{
+    const uint8_t *src = op - dist;
+
+    do {
+        *op++ = *src++;
+    } while (--len);
+}
+
+/*
+ * Expand one stream of size bytes from seed into ref with the byte loop
+ * and into out with copy_match(), out having slack bytes after size and a
+ * guard after those. Returns 0, or -1 after saying where they differ.
+ */
+static int check_stream(uint64_t seed, uint32_t size, size_t slack, uint8_t *ref, uint8_t *out)
+{
+    uint64_t s = seed;
+    uint32_t pos = 0, dist, len, i;
+    uint8_t *op;
+
+    memset(out + size, 0xA5, slack + GUARD);
+    while (pos < size) {
+        if (pos == 0 || rnd(&s) % 4 == 0) {
+            len = 1 + rnd(&s) % 16;
+            if (len > size - pos)
+                len = size - pos;
+            for (i = 0; i < len; i++)
+                ref[pos + i] = out[pos + i] = rnd(&s);
+            pos += len;
+            continue;
+        }
+        dist = 1 + rnd(&s) % MAX_DIST;
+        if (dist > pos)
+            dist = pos;
+        //mostly short matches, as in real MOF data, some long ones
+        len = rnd(&s) % 8 ? 1 + rnd(&s) % 48 : 1 + rnd(&s) % 400;
+        if (len > size - pos)
+            len = size - pos;
+        copy_bytes(ref + pos, dist, len);
+        op = copy_match(out + pos, dist, len, size + slack - pos);
+        if (op != out + pos + len) {
+            fprintf(stderr, "seed %#llx, slack %zu: match of %u at distance %u, at %u, ends %td bytes off\n",
+                    (unsigned long long)seed, slack, len, dist, pos, op - (out + pos + len));
+            return -1;
+        }
+        pos += len;
+    }
+
+    if (memcmp(ref, out, size)) {
+        for (i = 0; ref[i] == out[i]; i++)
+            ;
+        fprintf(stderr, "seed %#llx, slack %zu: output differs at byte %u of %u\n",
+                (unsigned long long)seed, slack, i, size);
+        return -1;
+    }
+    for (i = 0; i < GUARD; i++)
+        if (out[size + slack + i] != 0xA5) {
+            fprintf(stderr, "seed %#llx, slack %zu: wrote %u bytes past the slack\n",
+                    (unsigned long long)seed, slack, i + 1);
+            return -1;
+        }
+    return 0;
+}
+
+int main(void)
+{
+    uint8_t *ref = malloc(MAX_OUT), *out = malloc(MAX_OUT + BMOF_OUT_SLACK + GUARD);
+    uint64_t seed, s = 0x9E3779B97F4A7C15ull;
+    unsigned int n, failed = 0;
+    uint32_t size;
+
+    if (ref == NULL || out == NULL) {
+        perror("Error allocating memory");
+        return EXIT_FAILURE;
+    }
+    for (n = 0; n < STREAMS; n++) {
+        seed = s ^ n;
+        size = 1 + rnd(&s) % (n % 4 ? 4096 : MAX_OUT);
+        failed += check_stream(seed, size, 0, ref, out) != 0;
+        failed += check_stream(seed, size, BMOF_OUT_SLACK, ref, out) != 0;
+    }
+    free(ref);
+    free(out);
+    if (failed) {
+        fprintf(stderr, "%u of %u streams expanded differently\n", failed, 2 * STREAMS);
+        return EXIT_FAILURE;
+    }
+    printf("copy_match: %u streams, as the byte loop expands them\n", 2 * STREAMS);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmof.h"
+#include "mof.h"
+
+/*
+ * Fuzz target for libbmof, for libFuzzer (make fuzz) or AFL (make
+ * fuzz-afl, which builds the stdin driver at the bottom).
+ *
+ * Every input is decoded as a blob three ways: into a buffer of exactly
+ * the expanded size, so that the sanitizers catch any access outside it
+ * (including a back-reference before the start of the output), into a
+ * buffer with slack for the wide copies, and through the streaming
+ * decoder fed in odd-sized pieces. All three must agree. What decodes,
+ * and the input itself, is run through the MOF parser and writers. The
+ * input is then also compressed and decoded again, which must give it
+ * back.
+ */
+
+//expanded sizes above this are skipped rather than allocated
+#define MAX_OUT (16 << 20)
+
+struct sink {
+    uint8_t *buf;
+    size_t len, cap;
+};
+
+static int sink_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    struct sink *s = ctx;
+
+    if (len > s->cap - s->len)
+        abort(); //the stream decoder produced more than the header allows
+    memcpy(s->buf + s->len, buf, len);
+    s->len += len;
+    return 0;
+}
+
+static void check_parse(const uint8_t *data, size_t size)
+{
+    static FILE *null_fp;
+    struct mof_file mof;
+
+    if (null_fp == NULL && (null_fp = fopen("/dev/null", "w")) == NULL)
+        abort();
+    if (mof_parse(data, size, &mof))
+        return;
+    mof_write_mof(null_fp, &mof, NULL);
+    mof_write_json(null_fp, &mof, NULL, NULL);
+    mof_write_table(null_fp, &mof, NULL, NULL);
+    if (mof.num_classes && mof.classes[0].name
+            && mof_find_class(&mof, mof.classes[0].name) == NULL)
+        abort();
+    mof_free(&mof);
+}
+
+static void check_decode(const uint8_t *data, size_t size)
+{
+    static struct bmof_stream stream;
+    struct bmof_header hdr;
+    struct sink sink;
+    uint8_t *exact, *slack;
+    size_t off, n;
+    long ret, ret_slack, ret_stream;
+
+    if (bmof_read_header(data, size, &hdr) || hdr.out_size > MAX_OUT)
+        return;
+
+    exact = malloc(hdr.out_size ? hdr.out_size : 1);
+    slack = malloc(hdr.out_size + BMOF_OUT_SLACK);
+    if (exact == NULL || slack == NULL)
+        abort();
+    ret = bmof_decompress(data, size, exact, hdr.out_size);
+    ret_slack = bmof_decompress(data, size, slack, hdr.out_size + BMOF_OUT_SLACK);
+    if (ret != ret_slack || (ret > 0 && memcmp(exact, slack, ret)))
+        abort();
+    if (ret > 0)
+        check_parse(exact, ret);
+
+    //the whole-blob decoder refuses short input up front, the stream can't
+    if (size - BMOF_HEADER_SIZE >= hdr.in_size) {
+        sink.buf = slack;
+        sink.len = 0;
+        sink.cap = hdr.out_size;
+        bmof_stream_init(&stream, &hdr, sink_write, &sink);
+        ret_stream = BMOF_OK;
+        for (off = BMOF_HEADER_SIZE; off < size && ret_stream == BMOF_OK; off += n) {
+            n = 1 + (off * 7919) % 4099;
+            if (n > size - off)
+                n = size - off;
+            ret_stream = bmof_stream_feed(&stream, data + off, n);
+        }
+        if (ret_stream == BMOF_OK)
+            ret_stream = bmof_stream_finish(&stream);
+        if (ret_stream != ret || (ret > 0 && memcmp(exact, slack, ret)))
+            abort();
+    }
+
+    free(exact);
+    free(slack);
+}
+
+static void check_round_trip(const uint8_t *data, size_t size)
+{
+    size_t bound = bmof_compress_bound(size);
+    uint8_t *blob, *back;
+    long len;
+
+    blob = malloc(bound);
+    back = malloc(size + BMOF_OUT_SLACK);
+    if (blob == NULL || back == NULL)
+        abort();
+    len = bmof_compress(data, size, blob, bound, size && data[0] & 1 ? BMOF_LEVEL_BEST : BMOF_LEVEL_FAST);
+    if (len < 0 || (size_t)len > bound)
+        abort();
+    if (bmof_decompress(blob, len, back, size + BMOF_OUT_SLACK) != (long)size
+            || memcmp(back, data, size))
+        abort();
+    free(blob);
+    free(back);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check_decode(data, size);
+    check_parse(data, size);
+    check_round_trip(data, size);
+    return 0;
+}
+
+#ifdef BMOF_FUZZ_MAIN
+int main(void)
+{
+    static uint8_t buf[1 << 20];
+    size_t len = fread(buf, 1, sizeof(buf), stdin);
+
+    return LLVMFuzzerTestOneInput(buf, len);
+}
+#endif
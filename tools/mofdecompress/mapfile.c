@@ -0,0 +1,74 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+
+int map_input(int fd, struct mapping *m)
+{
+    struct stat st;
+    off_t off;
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+        return -1;
+    off = lseek(fd, 0, SEEK_CUR);
+    if (off < 0 || off > st.st_size)
+        return -1;
+    if (st.st_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //map the whole file, the offset need not be page aligned
+    m->base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m->base == MAP_FAILED)
+        return -1;
+    m->map_len = st.st_size;
+    m->data = (uint8_t *)m->base + off;
+    m->len = st.st_size - off;
+    madvise(m->base, m->map_len, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int map_output(int fd, size_t len, size_t extra, struct mapping *m)
+{
+    struct stat st;
+    int flags;
+
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || (flags & O_APPEND) || (flags & O_ACCMODE) != O_RDWR)
+        return -1;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || lseek(fd, 0, SEEK_CUR) != 0)
+        return -1;
+    if (len + extra == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ftruncate(fd, len + extra))
+        return -1;
+    m->base = mmap(NULL, len + extra, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m->base == MAP_FAILED)
+        return -1;
+    m->map_len = len + extra;
+    m->data = m->base;
+    m->len = len;
+    return 0;
+}
+
+void unmap_input(struct mapping *m)
+{
+    munmap(m->base, m->map_len);
+}
+
+int unmap_output(int fd, struct mapping *m, size_t len)
+{
+    int ret;
+
+    ret = munmap(m->base, m->map_len);
+    if (ftruncate(fd, len))
+        ret = -1;
+    return ret;
+}
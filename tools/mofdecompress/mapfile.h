@@ -0,0 +1,37 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Zero-copy file access for regular files. The decoder reads straight
+ * from a read-only mapping of the input and writes straight into a shared
+ * mapping of the output, instead of going through malloc'd buffers and
+ * stdio. Callers fall back to plain reads/writes when these fail, e.g. for
+ * pipes and terminals.
+ */
+struct mapping {
+    uint8_t *data;  //start of the file contents from the fd's offset
+    size_t len;     //bytes from data to the end of the file
+    void *base;     //what to munmap
+    size_t map_len;
+};
+
+//map fd read-only from its current offset to the end of the file
+int map_input(int fd, struct mapping *m);
+
+/*
+ * Size the regular file behind fd to len bytes and map it writable, with
+ * extra bytes of scratch space after them. The fd must be open read-write,
+ * at offset 0 and not in append mode. unmap_output() trims the file to
+ * its final size.
+ */
+int map_output(int fd, size_t len, size_t extra, struct mapping *m);
+
+void unmap_input(struct mapping *m);
+
+//unmap an output mapping and truncate the file to len bytes
+int unmap_output(int fd, struct mapping *m, size_t len);
+
+#endif
@@ -0,0 +1,798 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <endian.h>
+
+#include "bmof.h"
+#include "mof.h"
+
+#define MOF_SIGNATURE    0x424d4f46 //"FOMB", as for the compressed blob
+#define MOF_HEADER_SIZE  20
+#define FLAVOR_SIGNATURE "BMOFQUALFLAVOR11"
+#define MAX_DEPTH        8 //objects embedded in objects
+
+//item headers: length, type, name offset, value offset and for properties qualifier offset
+#define QUAL_HEADER_SIZE 16
+#define PROP_HEADER_SIZE 20
+#define NO_OFFSET        0xffffffff
+
+struct mof_arena {
+    struct mof_arena *next;
+    size_t used, size;
+    uint8_t data[];
+};
+
+#define ARENA_CHUNK (64 << 10)
+
+struct parser {
+    const uint8_t *base; //start of the data, flavor offsets count from here
+    struct mof_arena *arena;
+    uint32_t *flavors;   //offset, flavor pairs sorted by offset
+    uint32_t num_flavors;
+};
+
+//one qualifier, property or method record
+struct item {
+    const uint8_t *rec;
+    const char *name;
+    uint32_t type;
+    const uint8_t *value, *quals; //NULL if absent
+    uint32_t value_len, quals_len;
+};
+
+static void *arena_alloc(struct parser *p, size_t n)
+{
+    struct mof_arena *a = p->arena;
+    size_t size;
+    void *ret;
+
+    n = (n + 7) & ~(size_t)7;
+    if (a == NULL || a->size - a->used < n) {
+        size = n > ARENA_CHUNK ? n : ARENA_CHUNK;
+        a = malloc(sizeof(*a) + size);
+        if (a == NULL)
+            return NULL;
+        a->next = p->arena;
+        a->used = 0;
+        a->size = size;
+        p->arena = a;
+    }
+    ret = a->data + a->used;
+    a->used += n;
+    return ret;
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return le32toh(v);
+}
+
+/*
+ * Convert the NUL terminated UTF-16 string at p, which must end within
+ * len bytes, to UTF-8. Unpaired surrogates become U+FFFD.
+ */
+static const char *read_string(struct parser *p, const uint8_t *s, uint32_t len)
+{
+    uint32_t n, i, c, c2;
+    char *out, *o;
+
+    for (n = 0; n + 1 < len && (s[n] | s[n + 1]); n += 2)
+        ;
+    if (n + 1 >= len)
+        return NULL;
+    out = o = arena_alloc(p, n / 2 * 3 + 1);
+    if (out == NULL)
+        return NULL;
+
+    for (i = 0; i < n; i += 2) {
+        c = s[i] | s[i + 1] << 8;
+        if (c >= 0xd800 && c < 0xdc00 && i + 2 < n) {
+            c2 = s[i + 2] | s[i + 3] << 8;
+            if (c2 >= 0xdc00 && c2 < 0xe000) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+                i += 2;
+            }
+        }
+        if (c >= 0xd800 && c < 0xe000)
+            c = 0xfffd;
+        if (c < 0x80) {
+            *o++ = c;
+        } else if (c < 0x800) {
+            *o++ = 0xc0 | c >> 6;
+            *o++ = 0x80 | (c & 0x3f);
+        } else if (c < 0x10000) {
+            *o++ = 0xe0 | c >> 12;
+            *o++ = 0x80 | (c >> 6 & 0x3f);
+            *o++ = 0x80 | (c & 0x3f);
+        } else {
+            *o++ = 0xf0 | c >> 18;
+            *o++ = 0x80 | (c >> 12 & 0x3f);
+            *o++ = 0x80 | (c >> 6 & 0x3f);
+            *o++ = 0x80 | (c & 0x3f);
+        }
+    }
+    *o = 0;
+    return out;
+}
+
+//bytes taken by an element of a fixed size type, 0 for variable sized ones
+static uint32_t scalar_size(uint32_t type)
+{
+    switch (type) {
+    case MOF_TYPE_SINT8:
+    case MOF_TYPE_UINT8:
+        return 1;
+    case MOF_TYPE_SINT16:
+    case MOF_TYPE_UINT16:
+    case MOF_TYPE_BOOLEAN:
+    case MOF_TYPE_CHAR16:
+        return 2;
+    case MOF_TYPE_SINT32:
+    case MOF_TYPE_UINT32:
+    case MOF_TYPE_REAL32:
+        return 4;
+    case MOF_TYPE_SINT64:
+    case MOF_TYPE_UINT64:
+    case MOF_TYPE_REAL64:
+        return 8;
+    }
+    return 0;
+}
+
+static int parse_object(struct parser *p, const uint8_t *obj, uint32_t len, int depth,
+                        struct mof_class *cls);
+
+static int parse_scalar(struct parser *p, uint32_t type, const uint8_t *v, uint32_t len,
+                        int depth, union mof_scalar *out)
+{
+    uint64_t u = 0;
+    uint32_t size = scalar_size(type), u32;
+    float f;
+    double d;
+    struct mof_class *obj;
+    int err;
+
+    if (size) {
+        if (len < size)
+            return BMOF_ERR_RECORD;
+        memcpy(&u, v, size);
+        u = le64toh(u);
+    }
+
+    switch (type) {
+    case MOF_TYPE_SINT8:
+        out->i = (int8_t)u;
+        break;
+    case MOF_TYPE_SINT16:
+        out->i = (int16_t)u;
+        break;
+    case MOF_TYPE_SINT32:
+        out->i = (int32_t)u;
+        break;
+    case MOF_TYPE_SINT64:
+        out->i = (int64_t)u;
+        break;
+    case MOF_TYPE_BOOLEAN:
+        out->u = u != 0;
+        break;
+    case MOF_TYPE_UINT8:
+    case MOF_TYPE_UINT16:
+    case MOF_TYPE_UINT32:
+    case MOF_TYPE_UINT64:
+    case MOF_TYPE_CHAR16:
+        out->u = u;
+        break;
+    case MOF_TYPE_REAL32:
+        u32 = u;
+        memcpy(&f, &u32, 4);
+        out->d = f;
+        break;
+    case MOF_TYPE_REAL64:
+        memcpy(&d, &u, 8);
+        out->d = d;
+        break;
+    case MOF_TYPE_STRING:
+    case MOF_TYPE_DATETIME:
+    case MOF_TYPE_REFERENCE:
+        out->s = read_string(p, v, len);
+        if (out->s == NULL)
+            return BMOF_ERR_RECORD;
+        break;
+    case MOF_TYPE_OBJECT:
+        obj = arena_alloc(p, sizeof(*obj));
+        if (obj == NULL)
+            return BMOF_ERR_NOMEM;
+        err = parse_object(p, v, len, depth + 1, obj);
+        if (err)
+            return err;
+        out->obj = obj;
+        break;
+    default:
+        return BMOF_ERR_RECORD;
+    }
+    return BMOF_OK;
+}
+
+/*
+ * An array is its total length, the number of dimensions (always 1) and
+ * the element count, followed by the elements. Fixed size elements are
+ * packed, variable sized ones are each preceded by their length.
+ */
+static int parse_value(struct parser *p, uint32_t type, const uint8_t *v, uint32_t len,
+                       int depth, struct mof_value *out)
+{
+    uint32_t base = type & MOF_TYPE_MASK, size = scalar_size(base), i, count, elen;
+    int err;
+
+    out->type = type;
+    out->count = 0;
+    out->v = NULL;
+    if (v == NULL)
+        return BMOF_OK;
+
+    if (!(type & MOF_TYPE_ARRAY)) {
+        out->v = arena_alloc(p, sizeof(*out->v));
+        if (out->v == NULL)
+            return BMOF_ERR_NOMEM;
+        out->count = 1;
+        return parse_scalar(p, base, v, len, depth, out->v);
+    }
+
+    if (len < 12 || rd32(v) < 12 || rd32(v) > len || rd32(v + 4) != 1)
+        return BMOF_ERR_RECORD;
+    count = rd32(v + 8);
+    len = rd32(v) - 12;
+    v += 12;
+    if (count > len)
+        return BMOF_ERR_RECORD;
+    out->v = arena_alloc(p, count * sizeof(*out->v));
+    if (out->v == NULL && count)
+        return BMOF_ERR_NOMEM;
+    out->count = count;
+
+    for (i = 0; i < count; i++) {
+        if (size) {
+            if ((elen = size) > len)
+                return BMOF_ERR_RECORD;
+        } else {
+            if (len < 4 || (elen = rd32(v)) < 4 || elen > len)
+                return BMOF_ERR_RECORD;
+            v += 4;
+            len -= 4;
+            elen -= 4;
+        }
+        err = parse_scalar(p, base, v, elen, depth, &out->v[i]);
+        if (err)
+            return err;
+        v += elen;
+        len -= elen;
+    }
+    return BMOF_OK;
+}
+
+//split a record into its parts; value and qualifiers run up to whichever comes next
+static int parse_item(struct parser *p, const uint8_t *rec, uint32_t len, int is_qual,
+                      struct item *it)
+{
+    uint32_t hdr = is_qual ? QUAL_HEADER_SIZE : PROP_HEADER_SIZE;
+    uint32_t value_off, qual_off, data_len = len - hdr;
+    const uint8_t *data = rec + hdr;
+
+    it->rec = rec;
+    it->type = rd32(rec + 4);
+    value_off = rd32(rec + 12);
+    qual_off = is_qual ? NO_OFFSET : rd32(rec + 16);
+    if ((value_off != NO_OFFSET && value_off >= data_len)
+            || (qual_off != NO_OFFSET && qual_off >= data_len))
+        return BMOF_ERR_RECORD;
+
+    it->name = read_string(p, data, data_len);
+    if (it->name == NULL)
+        return BMOF_ERR_RECORD;
+
+    it->value = it->quals = NULL;
+    if (value_off != NO_OFFSET) {
+        it->value = data + value_off;
+        it->value_len = (qual_off != NO_OFFSET && qual_off > value_off ? qual_off : data_len)
+                        - value_off;
+    }
+    if (qual_off != NO_OFFSET) {
+        it->quals = data + qual_off;
+        it->quals_len = (value_off != NO_OFFSET && value_off > qual_off ? value_off : data_len)
+                        - qual_off;
+    }
+    return BMOF_OK;
+}
+
+/*
+ * Check the block header at blk and hand back its item count. The items
+ * themselves are checked as they are walked with next_item().
+ */
+static int block_count(const uint8_t *blk, uint32_t len, uint32_t hdr_size, uint32_t *count)
+{
+    if (len < 8 || rd32(blk) < 8 || rd32(blk) > len)
+        return BMOF_ERR_RECORD;
+    *count = rd32(blk + 4);
+    if (*count > (rd32(blk) - 8) / hdr_size)
+        return BMOF_ERR_RECORD;
+    return BMOF_OK;
+}
+
+//*pos is the offset of the next item in the block, advanced past it
+static int next_item(struct parser *p, const uint8_t *blk, uint32_t *pos, int is_qual,
+                     struct item *it)
+{
+    uint32_t hdr = is_qual ? QUAL_HEADER_SIZE : PROP_HEADER_SIZE, left, len;
+
+    left = rd32(blk) - *pos;
+    if (left < hdr || (len = rd32(blk + *pos)) < hdr || len > left)
+        return BMOF_ERR_RECORD;
+    *pos += len;
+    return parse_item(p, blk + *pos - len, len, is_qual, it);
+}
+
+static uint32_t find_flavor(const struct parser *p, const uint8_t *rec)
+{
+    uint32_t off = rec - p->base, lo = 0, hi = p->num_flavors, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (p->flavors[2 * mid] == off)
+            return p->flavors[2 * mid + 1];
+        if (p->flavors[2 * mid] < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+static int parse_qualifiers(struct parser *p, const uint8_t *blk, uint32_t len, int depth,
+                            struct mof_qualifier **out, uint32_t *num)
+{
+    uint32_t count, pos = 8, i;
+    struct item it;
+    int err;
+
+    *out = NULL;
+    *num = 0;
+    if (blk == NULL)
+        return BMOF_OK;
+    if ((err = block_count(blk, len, QUAL_HEADER_SIZE, &count)))
+        return err;
+    if (count == 0)
+        return BMOF_OK;
+    *out = arena_alloc(p, count * sizeof(**out));
+    if (*out == NULL)
+        return BMOF_ERR_NOMEM;
+
+    for (i = 0; i < count; i++) {
+        if ((err = next_item(p, blk, &pos, 1, &it)))
+            return err;
+        (*out)[i].name = it.name;
+        (*out)[i].flavor = find_flavor(p, it.rec);
+        err = parse_value(p, it.type, it.value, it.value_len, depth, &(*out)[i].value);
+        if (err)
+            return err;
+    }
+    *num = count;
+    return BMOF_OK;
+}
+
+static const char *string_qualifier(const struct mof_qualifier *q, uint32_t n, const char *name)
+{
+    const struct mof_qualifier *found = mof_find_qualifier(q, n, name);
+
+    if (found == NULL || found->value.type != MOF_TYPE_STRING || found->value.count != 1)
+        return NULL;
+    return found->value.v[0].s;
+}
+
+static int int_qualifier(const struct mof_qualifier *q, uint32_t n, const char *name,
+                         int64_t *val)
+{
+    const struct mof_qualifier *found = mof_find_qualifier(q, n, name);
+
+    if (found == NULL || found->value.count != 1)
+        return 0;
+    switch (found->value.type) {
+    case MOF_TYPE_SINT8:
+    case MOF_TYPE_SINT16:
+    case MOF_TYPE_SINT32:
+    case MOF_TYPE_SINT64:
+        *val = found->value.v[0].i;
+        return 1;
+    case MOF_TYPE_UINT8:
+    case MOF_TYPE_UINT16:
+    case MOF_TYPE_UINT32:
+    case MOF_TYPE_UINT64:
+    case MOF_TYPE_BOOLEAN:
+        *val = found->value.v[0].u;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_property(struct parser *p, const struct item *it, int depth,
+                          struct mof_property *prop)
+{
+    const char *cimtype;
+    int64_t id;
+    int err;
+
+    prop->name = it->name;
+    err = parse_qualifiers(p, it->quals, it->quals_len, depth,
+                           &prop->qualifiers, &prop->num_qualifiers);
+    if (err)
+        return err;
+    err = parse_value(p, it->type, it->value, it->value_len, depth, &prop->value);
+    if (err)
+        return err;
+
+    cimtype = string_qualifier(prop->qualifiers, prop->num_qualifiers, "CIMTYPE");
+    prop->type_name = cimtype ? cimtype : mof_type_name(it->type);
+    prop->param_id = int_qualifier(prop->qualifiers, prop->num_qualifiers, "ID", &id) ? id : -1;
+    prop->param_in = mof_find_qualifier(prop->qualifiers, prop->num_qualifiers, "in") != NULL;
+    prop->param_out = mof_find_qualifier(prop->qualifiers, prop->num_qualifiers, "out") != NULL;
+    return BMOF_OK;
+}
+
+//properties, minus the system ones that name the class and its place
+static int parse_properties(struct parser *p, const uint8_t *blk, uint32_t len, int depth,
+                            struct mof_class *cls)
+{
+    struct mof_property prop;
+    uint32_t count, pos = 8, i;
+    struct item it;
+    int err;
+
+    if ((err = block_count(blk, len, PROP_HEADER_SIZE, &count)))
+        return err;
+    cls->properties = arena_alloc(p, count * sizeof(*cls->properties));
+    if (cls->properties == NULL && count)
+        return BMOF_ERR_NOMEM;
+
+    for (i = 0; i < count; i++) {
+        if ((err = next_item(p, blk, &pos, 0, &it)))
+            return err;
+        if ((err = parse_property(p, &it, depth, &prop)))
+            return err;
+
+        if (!strncmp(prop.name, "__", 2)) {
+            if (prop.value.type != MOF_TYPE_STRING || prop.value.count != 1)
+                continue;
+            if (!strcmp(prop.name, "__CLASS"))
+                cls->name = prop.value.v[0].s;
+            else if (!strcmp(prop.name, "__SUPERCLASS"))
+                cls->superclass = prop.value.v[0].s;
+            else if (!strcmp(prop.name, "__NAMESPACE"))
+                cls->namespace = prop.value.v[0].s;
+            continue;
+        }
+        cls->properties[cls->num_properties++] = prop;
+    }
+    return BMOF_OK;
+}
+
+/*
+ * A method is an array of __PARAMETERS objects whose properties are the
+ * arguments, tagged in and/or out and numbered by their ID qualifiers,
+ * plus ReturnValue giving the return type.
+ */
+static int parse_method(struct parser *p, const struct item *it, int depth,
+                        struct mof_method *m)
+{
+    struct mof_property prop, *params;
+    const struct mof_class *obj;
+    struct mof_value objs;
+    uint32_t i, j, k, n = 0;
+    int64_t id;
+    int err;
+
+    if (it->type != (MOF_TYPE_OBJECT | MOF_TYPE_ARRAY))
+        return BMOF_ERR_RECORD;
+    m->name = it->name;
+    m->return_type = "void";
+    err = parse_qualifiers(p, it->quals, it->quals_len, depth, &m->qualifiers, &m->num_qualifiers);
+    if (err)
+        return err;
+    m->id = int_qualifier(m->qualifiers, m->num_qualifiers, "WmiMethodId", &id) ? id : -1;
+    if ((err = parse_value(p, it->type, it->value, it->value_len, depth, &objs)))
+        return err;
+
+    for (i = 0; i < objs.count; i++)
+        n += objs.v[i].obj->num_properties;
+    params = arena_alloc(p, n * sizeof(*params));
+    if (params == NULL && n)
+        return BMOF_ERR_NOMEM;
+
+    n = 0;
+    for (i = 0; i < objs.count; i++) {
+        obj = objs.v[i].obj;
+        for (j = 0; j < obj->num_properties; j++) {
+            prop = obj->properties[j];
+            if (!strcasecmp(prop.name, "ReturnValue")) {
+                m->return_type = prop.type_name;
+                continue;
+            }
+            //insertion sort by ID, stable for equal or missing IDs
+            for (k = n; k > 0 && (uint32_t)params[k - 1].param_id > (uint32_t)prop.param_id; k--)
+                params[k] = params[k - 1];
+            params[k] = prop;
+            n++;
+        }
+    }
+    m->params = params;
+    m->num_params = n;
+    return BMOF_OK;
+}
+
+static int parse_methods(struct parser *p, const uint8_t *blk, uint32_t len, int depth,
+                         struct mof_class *cls)
+{
+    uint32_t count, pos = 8, i;
+    struct item it;
+    int err;
+
+    if ((err = block_count(blk, len, PROP_HEADER_SIZE, &count)))
+        return err;
+    cls->methods = arena_alloc(p, count * sizeof(*cls->methods));
+    if (cls->methods == NULL && count)
+        return BMOF_ERR_NOMEM;
+    for (i = 0; i < count; i++) {
+        if ((err = next_item(p, blk, &pos, 0, &it)))
+            return err;
+        if ((err = parse_method(p, &it, depth, &cls->methods[i])))
+            return err;
+    }
+    cls->num_methods = count;
+    return BMOF_OK;
+}
+
+/*
+ * An object is its length, a word that is 0 at the top level and ~0 when
+ * embedded, the length of its qualifier block, the length of the
+ * qualifier and property blocks together, and whether it is an instance.
+ * The blocks follow, the qualifier block missing when its length is 0,
+ * then the method block up to the end of the object.
+ */
+static int parse_object(struct parser *p, const uint8_t *obj, uint32_t len, int depth,
+                        struct mof_class *cls)
+{
+    uint32_t qual_len, props_end;
+    int err;
+
+    memset(cls, 0, sizeof(*cls));
+    if (depth > MAX_DEPTH || len < 20 || rd32(obj) < 20 || rd32(obj) > len)
+        return BMOF_ERR_RECORD;
+    len = rd32(obj);
+    qual_len = rd32(obj + 8);
+    props_end = rd32(obj + 12);
+    cls->instance = rd32(obj + 16) != 0;
+    if (qual_len > props_end || props_end > len - 20)
+        return BMOF_ERR_RECORD;
+    obj += 20;
+    len -= 20;
+
+    err = parse_qualifiers(p, qual_len ? obj : NULL, qual_len, depth,
+                           &cls->qualifiers, &cls->num_qualifiers);
+    if (err)
+        return err;
+    cls->guid = string_qualifier(cls->qualifiers, cls->num_qualifiers, "guid");
+    if ((err = parse_properties(p, obj + qual_len, props_end - qual_len, depth, cls)))
+        return err;
+    if (len - props_end >= 8)
+        return parse_methods(p, obj + props_end, len - props_end, depth, cls);
+    return BMOF_OK;
+}
+
+static int cmp_flavor(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int parse_flavors(struct parser *p, const uint8_t *sec, size_t len)
+{
+    uint32_t count, i;
+
+    p->num_flavors = 0;
+    if (len < 20 || memcmp(sec, FLAVOR_SIGNATURE, 16))
+        return BMOF_OK; //optional
+    count = rd32(sec + 16);
+    if (count > (len - 20) / 8)
+        return BMOF_ERR_RECORD;
+    p->flavors = arena_alloc(p, count * 8);
+    if (p->flavors == NULL && count)
+        return BMOF_ERR_NOMEM;
+    for (i = 0; i < 2 * count; i++)
+        p->flavors[i] = rd32(sec + 20 + 4 * i);
+    qsort(p->flavors, count, 8, cmp_flavor);
+    p->num_flavors = count;
+    return BMOF_OK;
+}
+
+static uint32_t hash_name(const char *s)
+{
+    uint32_t h = 2166136261u;
+
+    for (; *s; s++)
+        h = (h ^ (uint8_t)(*s | (*s >= 'A' && *s <= 'Z' ? 0x20 : 0))) * 16777619u;
+    return h;
+}
+
+//the hex digits and dashes of a GUID, lower case; returns 0 if it doesn't look like one
+static int guid_key(const char *guid, char key[37])
+{
+    size_t n = 0;
+
+    if (*guid == '{')
+        guid++;
+    for (; *guid && *guid != '}'; guid++) {
+        if (n == 36)
+            return 0;
+        key[n++] = *guid | (*guid >= 'A' && *guid <= 'Z' ? 0x20 : 0);
+    }
+    key[n] = 0;
+    return n == 36;
+}
+
+static void index_insert(uint32_t *table, uint32_t mask, uint32_t hash, uint32_t value)
+{
+    while (table[hash & mask])
+        hash++;
+    table[hash & mask] = value;
+}
+
+static int build_index(struct parser *p, struct mof_file *file)
+{
+    uint32_t size = 8, i;
+    char key[37];
+
+    while (size < 2 * file->num_classes)
+        size *= 2;
+    file->index_mask = size - 1;
+    file->by_name = arena_alloc(p, size * sizeof(uint32_t));
+    file->by_guid = arena_alloc(p, size * sizeof(uint32_t));
+    if (file->by_name == NULL || file->by_guid == NULL)
+        return BMOF_ERR_NOMEM;
+    memset(file->by_name, 0, size * sizeof(uint32_t));
+    memset(file->by_guid, 0, size * sizeof(uint32_t));
+
+    for (i = 0; i < file->num_classes; i++) {
+        const struct mof_class *cls = &file->classes[i];
+
+        if (cls->name && mof_find_class(file, cls->name) == NULL)
+            index_insert(file->by_name, file->index_mask, hash_name(cls->name), i + 1);
+        if (cls->guid && guid_key(cls->guid, key) && mof_find_guid(file, key) == NULL)
+            index_insert(file->by_guid, file->index_mask, hash_name(key), i + 1);
+    }
+    return BMOF_OK;
+}
+
+int mof_parse(const void *buf, size_t len, struct mof_file *file)
+{
+    const uint8_t *data = buf;
+    struct parser p = { data, NULL, NULL, 0 };
+    uint32_t tree_size, count, pos, i;
+    int err;
+
+    memset(file, 0, sizeof(*file));
+    if (len < MOF_HEADER_SIZE)
+        return BMOF_ERR_TRUNCATED;
+    //the two words after the tree size are 1 in every file seen
+    if (rd32(data) != MOF_SIGNATURE)
+        return BMOF_ERR_HEADER;
+    tree_size = rd32(data + 4);
+    count = rd32(data + 16);
+    if (tree_size < MOF_HEADER_SIZE || tree_size > len)
+        return BMOF_ERR_TRUNCATED;
+    if (count > (tree_size - MOF_HEADER_SIZE) / 20)
+        return BMOF_ERR_RECORD;
+
+    if ((err = parse_flavors(&p, data + tree_size, len - tree_size)))
+        goto fail;
+    file->classes = arena_alloc(&p, count * sizeof(*file->classes));
+    if (file->classes == NULL && count) {
+        err = BMOF_ERR_NOMEM;
+        goto fail;
+    }
+
+    pos = MOF_HEADER_SIZE;
+    for (i = 0; i < count; i++) {
+        err = parse_object(&p, data + pos, tree_size - pos, 0, &file->classes[i]);
+        if (err)
+            goto fail;
+        pos += rd32(data + pos);
+    }
+    file->num_classes = count;
+    if ((err = build_index(&p, file)))
+        goto fail;
+    file->arena = p.arena;
+    return BMOF_OK;
+
+fail:
+    file->arena = p.arena;
+    mof_free(file);
+    return err;
+}
+
+void mof_free(struct mof_file *file)
+{
+    struct mof_arena *a, *next;
+
+    for (a = file->arena; a; a = next) {
+        next = a->next;
+        free(a);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+const struct mof_class *mof_find_class(const struct mof_file *file, const char *name)
+{
+    uint32_t h = hash_name(name), idx;
+
+    if (file->by_name == NULL)
+        return NULL;
+    while ((idx = file->by_name[h & file->index_mask])) {
+        if (!strcasecmp(file->classes[idx - 1].name, name))
+            return &file->classes[idx - 1];
+        h++;
+    }
+    return NULL;
+}
+
+const struct mof_class *mof_find_guid(const struct mof_file *file, const char *guid)
+{
+    char key[37], other[37];
+    uint32_t h, idx;
+
+    if (file->by_guid == NULL || !guid_key(guid, key))
+        return NULL;
+    h = hash_name(key);
+    while ((idx = file->by_guid[h & file->index_mask])) {
+        guid_key(file->classes[idx - 1].guid, other);
+        if (!strcmp(key, other))
+            return &file->classes[idx - 1];
+        h++;
+    }
+    return NULL;
+}
+
+const struct mof_qualifier *mof_find_qualifier(const struct mof_qualifier *q, uint32_t n,
+                                               const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        if (!strcasecmp(q[i].name, name))
+            return &q[i];
+    return NULL;
+}
+
+const char *mof_type_name(uint32_t type)
+{
+    switch (type & MOF_TYPE_MASK) {
+    case MOF_TYPE_SINT8:     return "sint8";
+    case MOF_TYPE_UINT8:     return "uint8";
+    case MOF_TYPE_SINT16:    return "sint16";
+    case MOF_TYPE_UINT16:    return "uint16";
+    case MOF_TYPE_SINT32:    return "sint32";
+    case MOF_TYPE_UINT32:    return "uint32";
+    case MOF_TYPE_SINT64:    return "sint64";
+    case MOF_TYPE_UINT64:    return "uint64";
+    case MOF_TYPE_REAL32:    return "real32";
+    case MOF_TYPE_REAL64:    return "real64";
+    case MOF_TYPE_BOOLEAN:   return "boolean";
+    case MOF_TYPE_STRING:    return "string";
+    case MOF_TYPE_DATETIME:  return "datetime";
+    case MOF_TYPE_REFERENCE: return "ref";
+    case MOF_TYPE_CHAR16:    return "char16";
+    case MOF_TYPE_OBJECT:    return "object";
+    }
+    return "unknown";
+}
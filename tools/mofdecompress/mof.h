@@ -0,0 +1,157 @@
+#ifndef MOF_H
+#define MOF_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Parser for decompressed binary MOF, the data a BMOF blob expands to.
+ *
+ * The data starts with its own "FOMB" header, giving the size of the
+ * object tree and the number of top level objects (classes). Every object
+ * is a short header followed by a block of qualifiers, a block of
+ * properties and a block of methods. Every block is a length and an item
+ * count, and every item a length, a CIM type, the offsets of its value
+ * and (for properties and methods) of its own qualifier block, then its
+ * UTF-16 name. A method is a property holding an array of embedded
+ * objects, the __PARAMETERS classes that list its arguments. After the
+ * tree, a "BMOFQUALFLAVOR11" table gives the flavor of qualifiers by
+ * their offset.
+ *
+ * mof_parse() decodes all of it into a struct mof_file: names and string
+ * values become UTF-8, values are decoded according to their type, and
+ * classes are indexed by name and by GUID. The result doesn't point into
+ * the input, which may be freed once it has been parsed.
+ */
+
+//CIM types
+#define MOF_TYPE_SINT16     2
+#define MOF_TYPE_SINT32     3
+#define MOF_TYPE_REAL32     4
+#define MOF_TYPE_REAL64     5
+#define MOF_TYPE_STRING     8
+#define MOF_TYPE_BOOLEAN    11
+#define MOF_TYPE_OBJECT     13
+#define MOF_TYPE_SINT8      16
+#define MOF_TYPE_UINT8      17
+#define MOF_TYPE_UINT16     18
+#define MOF_TYPE_UINT32     19
+#define MOF_TYPE_SINT64     20
+#define MOF_TYPE_UINT64     21
+#define MOF_TYPE_DATETIME   101
+#define MOF_TYPE_REFERENCE  102
+#define MOF_TYPE_CHAR16     103
+#define MOF_TYPE_ARRAY      0x2000 //flag, combined with the element type
+#define MOF_TYPE_MASK       0x0fff
+
+//qualifier flavors
+#define MOF_FLAVOR_TO_INSTANCE      0x01
+#define MOF_FLAVOR_TO_SUBCLASS      0x02
+#define MOF_FLAVOR_DISABLE_OVERRIDE 0x10
+#define MOF_FLAVOR_AMENDED          0x80
+
+struct mof_class;
+
+union mof_scalar {
+    int64_t i;                   //signed integers
+    uint64_t u;                  //unsigned integers, char16 and booleans (0 or 1)
+    double d;                    //real32 and real64
+    const char *s;               //strings, datetimes and references
+    const struct mof_class *obj; //embedded objects
+};
+
+struct mof_value {
+    uint32_t type;          //CIM type, MOF_TYPE_ARRAY set for arrays
+    uint32_t count;         //number of elements: 1 for a scalar, 0 if no value is given
+    union mof_scalar *v;
+};
+
+struct mof_qualifier {
+    const char *name;
+    uint32_t flavor;
+    struct mof_value value;
+};
+
+struct mof_property {
+    const char *name;
+    const char *type_name;  //as declared, e.g. from a CIMTYPE qualifier
+    struct mof_value value; //value.type is the declared type even without a value
+    struct mof_qualifier *qualifiers;
+    uint32_t num_qualifiers;
+    //only for method parameters:
+    int32_t param_id;       //position, from the ID qualifier, -1 if missing
+    uint8_t param_in, param_out;
+};
+
+struct mof_method {
+    const char *name;
+    int32_t id;              //WmiMethodId, -1 if the method has none
+    const char *return_type; //type of ReturnValue, "void" if there is none
+    struct mof_qualifier *qualifiers;
+    uint32_t num_qualifiers;
+    struct mof_property *params; //sorted by param_id
+    uint32_t num_params;
+};
+
+struct mof_class {
+    const char *name;       //NULL only for a malformed object without __CLASS
+    const char *superclass; //NULL if none
+    const char *namespace;  //NULL if none
+    const char *guid;       //value of the guid qualifier, NULL if none
+    int instance;           //an instance rather than a class declaration
+    struct mof_qualifier *qualifiers;
+    uint32_t num_qualifiers;
+    struct mof_property *properties; //without the __ system properties
+    uint32_t num_properties;
+    struct mof_method *methods;
+    uint32_t num_methods;
+};
+
+struct mof_arena;
+
+struct mof_file {
+    struct mof_class *classes;
+    uint32_t num_classes;
+    //open addressing hash tables of class index + 1, 0 for empty slots
+    uint32_t *by_name, *by_guid;
+    uint32_t index_mask;
+    struct mof_arena *arena; //owns everything above
+};
+
+/*
+ * Parse len bytes of decompressed binary MOF into *file. Returns BMOF_OK
+ * or a negative enum bmof_error; on error nothing is left allocated.
+ */
+int mof_parse(const void *buf, size_t len, struct mof_file *file);
+
+void mof_free(struct mof_file *file);
+
+//look a class up by name, ignoring case as WMI does; the first one wins if it is declared twice
+const struct mof_class *mof_find_class(const struct mof_file *file, const char *name);
+
+//look a class up by GUID, with or without braces, in any case
+const struct mof_class *mof_find_guid(const struct mof_file *file, const char *guid);
+
+//find a qualifier by name, ignoring case
+const struct mof_qualifier *mof_find_qualifier(const struct mof_qualifier *q, uint32_t n,
+                                               const char *name);
+
+//name of a CIM type, without any array suffix
+const char *mof_type_name(uint32_t type);
+
+/*
+ * Writers for a whole file, or only for cls if it isn't NULL. The MOF text
+ * can be fed back to mofcomp. The JSON is one object with a "classes"
+ * array, plus a "source" member if source isn't NULL. The table has one
+ * tab separated line per method: GUID, class, WmiMethodId and name, with
+ * "-" for what is missing, and source as an extra first column if given.
+ * All return 0, or -1 if writing failed.
+ */
+int mof_write_mof(FILE *fp, const struct mof_file *file, const struct mof_class *cls);
+int mof_write_json(FILE *fp, const struct mof_file *file, const struct mof_class *cls,
+                   const char *source);
+int mof_write_table(FILE *fp, const struct mof_file *file, const struct mof_class *cls,
+                    const char *source);
+
+#endif
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "mof.h"
+
+enum syntax { MOF, JSON };
+
+static void write_escaped(FILE *fp, const char *s, enum syntax syn)
+{
+    unsigned char c;
+
+    for (; (c = *s); s++) {
+        switch (c) {
+        case '"':
+            fputs("\\\"", fp);
+            break;
+        case '\\':
+            fputs("\\\\", fp);
+            break;
+        case '\n':
+            fputs("\\n", fp);
+            break;
+        case '\r':
+            fputs("\\r", fp);
+            break;
+        case '\t':
+            fputs("\\t", fp);
+            break;
+        default:
+            if (c < 0x20)
+                fprintf(fp, syn == JSON ? "\\u%04x" : "\\x%02x", c);
+            else
+                putc(c, fp);
+        }
+    }
+}
+
+static void write_string(FILE *fp, const char *s, enum syntax syn)
+{
+    putc('"', fp);
+    write_escaped(fp, s, syn);
+    putc('"', fp);
+}
+
+static void write_scalar(FILE *fp, uint32_t type, const union mof_scalar *v, enum syntax syn)
+{
+    switch (type & MOF_TYPE_MASK) {
+    case MOF_TYPE_SINT8:
+    case MOF_TYPE_SINT16:
+    case MOF_TYPE_SINT32:
+    case MOF_TYPE_SINT64:
+        fprintf(fp, "%lld", (long long)v->i);
+        break;
+    case MOF_TYPE_UINT8:
+    case MOF_TYPE_UINT16:
+    case MOF_TYPE_UINT32:
+    case MOF_TYPE_UINT64:
+    case MOF_TYPE_CHAR16:
+        fprintf(fp, "%llu", (unsigned long long)v->u);
+        break;
+    case MOF_TYPE_REAL32:
+    case MOF_TYPE_REAL64:
+        fprintf(fp, "%.17g", v->d);
+        break;
+    case MOF_TYPE_BOOLEAN:
+        if (syn == JSON)
+            fputs(v->u ? "true" : "false", fp);
+        else
+            fputs(v->u ? "TRUE" : "FALSE", fp);
+        break;
+    case MOF_TYPE_STRING:
+    case MOF_TYPE_DATETIME:
+    case MOF_TYPE_REFERENCE:
+        write_string(fp, v->s, syn);
+        break;
+    default: //embedded objects only occur as method parameters, written out as such
+        fputs(syn == JSON ? "null" : "NULL", fp);
+    }
+}
+
+static void write_value(FILE *fp, const struct mof_value *val, enum syntax syn)
+{
+    uint32_t i;
+
+    if (val->count == 0) {
+        fputs(syn == JSON ? "null" : "NULL", fp);
+        return;
+    }
+    if (!(val->type & MOF_TYPE_ARRAY)) {
+        write_scalar(fp, val->type, &val->v[0], syn);
+        return;
+    }
+    putc(syn == JSON ? '[' : '{', fp);
+    for (i = 0; i < val->count; i++) {
+        if (i)
+            fputs(", ", fp);
+        write_scalar(fp, val->type, &val->v[i], syn);
+    }
+    putc(syn == JSON ? ']' : '}', fp);
+}
+
+//qualifiers implied by the MOF syntax itself are left out of the text
+static int implied_qualifier(const struct mof_qualifier *q, int is_param)
+{
+    return !strcasecmp(q->name, "CIMTYPE") || (is_param && !strcasecmp(q->name, "ID"));
+}
+
+static void write_mof_qualifiers(FILE *fp, const struct mof_qualifier *q, uint32_t n,
+                                 int is_param, const char *after)
+{
+    static const struct { uint32_t flag; const char *name; } flavors[] = {
+        { MOF_FLAVOR_TO_INSTANCE, "ToInstance" },
+        { MOF_FLAVOR_TO_SUBCLASS, "ToSubclass" },
+        { MOF_FLAVOR_DISABLE_OVERRIDE, "DisableOverride" },
+        { MOF_FLAVOR_AMENDED, "Amended" },
+    };
+    uint32_t i, j, written = 0;
+    const char *sep;
+
+    for (i = 0; i < n; i++) {
+        if (implied_qualifier(&q[i], is_param))
+            continue;
+        fputs(written++ ? ", " : "[", fp);
+        fputs(q[i].name, fp);
+        if (q[i].value.type == MOF_TYPE_BOOLEAN && q[i].value.count == 1 && q[i].value.v[0].u) {
+            //a plain name means TRUE
+        } else if (q[i].value.type & MOF_TYPE_ARRAY) {
+            write_value(fp, &q[i].value, MOF);
+        } else {
+            putc('(', fp);
+            write_value(fp, &q[i].value, MOF);
+            putc(')', fp);
+        }
+        sep = " : ";
+        for (j = 0; j < sizeof(flavors) / sizeof(flavors[0]); j++) {
+            if (q[i].flavor & flavors[j].flag) {
+                fprintf(fp, "%s%s", sep, flavors[j].name);
+                sep = " ";
+            }
+        }
+    }
+    if (written)
+        fprintf(fp, "]%s", after);
+}
+
+static void write_mof_class(FILE *fp, const struct mof_class *cls, const char **namespace)
+{
+    const struct mof_property *prop;
+    const struct mof_method *m;
+    uint32_t i, j;
+
+    if (cls->namespace && (*namespace == NULL || strcmp(cls->namespace, *namespace))) {
+        fputs("#pragma namespace(", fp);
+        write_string(fp, cls->namespace, MOF);
+        fputs(")\n\n", fp);
+        *namespace = cls->namespace;
+    }
+
+    write_mof_qualifiers(fp, cls->qualifiers, cls->num_qualifiers, 0, "\n");
+    if (cls->instance)
+        fprintf(fp, "instance of %s\n{\n", cls->name ? cls->name : "");
+    else if (cls->superclass)
+        fprintf(fp, "class %s : %s\n{\n", cls->name ? cls->name : "", cls->superclass);
+    else
+        fprintf(fp, "class %s\n{\n", cls->name ? cls->name : "");
+
+    for (i = 0; i < cls->num_properties; i++) {
+        prop = &cls->properties[i];
+        fputs("  ", fp);
+        write_mof_qualifiers(fp, prop->qualifiers, prop->num_qualifiers, 0, " ");
+        if (cls->instance)
+            fprintf(fp, "%s", prop->name);
+        else
+            fprintf(fp, "%s %s%s", prop->type_name, prop->name,
+                    prop->value.type & MOF_TYPE_ARRAY ? "[]" : "");
+        if (prop->value.count) {
+            fputs(" = ", fp);
+            write_value(fp, &prop->value, MOF);
+        }
+        fputs(";\n", fp);
+    }
+
+    for (i = 0; i < cls->num_methods; i++) {
+        m = &cls->methods[i];
+        fputs(i || cls->num_properties ? "\n  " : "  ", fp);
+        write_mof_qualifiers(fp, m->qualifiers, m->num_qualifiers, 0, " ");
+        fprintf(fp, "%s %s(", m->return_type, m->name);
+        for (j = 0; j < m->num_params; j++) {
+            prop = &m->params[j];
+            if (j)
+                fputs(", ", fp);
+            write_mof_qualifiers(fp, prop->qualifiers, prop->num_qualifiers, 1, " ");
+            fprintf(fp, "%s %s%s", prop->type_name, prop->name,
+                    prop->value.type & MOF_TYPE_ARRAY ? "[]" : "");
+        }
+        fputs(");\n", fp);
+    }
+    fputs("};\n\n", fp);
+}
+
+int mof_write_mof(FILE *fp, const struct mof_file *file, const struct mof_class *cls)
+{
+    const char *namespace = NULL;
+    uint32_t i;
+
+    if (cls)
+        write_mof_class(fp, cls, &namespace);
+    else
+        for (i = 0; i < file->num_classes; i++)
+            write_mof_class(fp, &file->classes[i], &namespace);
+    return ferror(fp) ? -1 : 0;
+}
+
+static void write_json_name(FILE *fp, const char *key, const char *s)
+{
+    fprintf(fp, "\"%s\": ", key);
+    if (s)
+        write_string(fp, s, JSON);
+    else
+        fputs("null", fp);
+}
+
+static void write_json_qualifiers(FILE *fp, const struct mof_qualifier *q, uint32_t n)
+{
+    uint32_t i;
+
+    fputs("\"qualifiers\": {", fp);
+    for (i = 0; i < n; i++) {
+        if (i)
+            fputs(", ", fp);
+        write_string(fp, q[i].name, JSON);
+        fputs(": ", fp);
+        write_value(fp, &q[i].value, JSON);
+    }
+    putc('}', fp);
+}
+
+static void write_json_property(FILE *fp, const struct mof_property *prop, int is_param)
+{
+    putc('{', fp);
+    write_json_name(fp, "name", prop->name);
+    fputs(", \"type\": \"", fp);
+    write_escaped(fp, prop->type_name, JSON);
+    fputs(prop->value.type & MOF_TYPE_ARRAY ? "[]\", " : "\", ", fp);
+    if (is_param) {
+        fprintf(fp, "\"in\": %s, \"out\": %s, ", prop->param_in ? "true" : "false",
+                prop->param_out ? "true" : "false");
+    } else if (prop->value.count) {
+        fputs("\"value\": ", fp);
+        write_value(fp, &prop->value, JSON);
+        fputs(", ", fp);
+    }
+    write_json_qualifiers(fp, prop->qualifiers, prop->num_qualifiers);
+    putc('}', fp);
+}
+
+static void write_json_class(FILE *fp, const struct mof_class *cls)
+{
+    const struct mof_method *m;
+    uint32_t i, j;
+
+    fputs("    {", fp);
+    write_json_name(fp, "name", cls->name);
+    fputs(", ", fp);
+    write_json_name(fp, "superclass", cls->superclass);
+    fputs(", ", fp);
+    write_json_name(fp, "namespace", cls->namespace);
+    fputs(", ", fp);
+    write_json_name(fp, "guid", cls->guid);
+    fprintf(fp, ", \"instance\": %s,\n      ", cls->instance ? "true" : "false");
+    write_json_qualifiers(fp, cls->qualifiers, cls->num_qualifiers);
+
+    fputs(",\n      \"properties\": [", fp);
+    for (i = 0; i < cls->num_properties; i++) {
+        fputs(i ? ",\n        " : "\n        ", fp);
+        write_json_property(fp, &cls->properties[i], 0);
+    }
+    fputs(cls->num_properties ? "\n      ],\n      \"methods\": [" : "],\n      \"methods\": [", fp);
+
+    for (i = 0; i < cls->num_methods; i++) {
+        m = &cls->methods[i];
+        fputs(i ? ",\n        {" : "\n        {", fp);
+        write_json_name(fp, "name", m->name);
+        if (m->id >= 0)
+            fprintf(fp, ", \"id\": %d, ", m->id);
+        else
+            fputs(", \"id\": null, ", fp);
+        write_json_name(fp, "return", m->return_type);
+        fputs(",\n          ", fp);
+        write_json_qualifiers(fp, m->qualifiers, m->num_qualifiers);
+        fputs(",\n          \"parameters\": [", fp);
+        for (j = 0; j < m->num_params; j++) {
+            fputs(j ? ",\n            " : "\n            ", fp);
+            write_json_property(fp, &m->params[j], 1);
+        }
+        fputs(m->num_params ? "\n          ]}" : "]}", fp);
+    }
+    fputs(cls->num_methods ? "\n      ]}" : "]}", fp);
+}
+
+int mof_write_json(FILE *fp, const struct mof_file *file, const struct mof_class *cls,
+                   const char *source)
+{
+    uint32_t i;
+
+    fputs("{", fp);
+    if (source) {
+        write_json_name(fp, "source", source);
+        fputs(",", fp);
+    }
+    fputs("\n  \"classes\": [\n", fp);
+    if (cls) {
+        write_json_class(fp, cls);
+    } else {
+        for (i = 0; i < file->num_classes; i++) {
+            if (i)
+                fputs(",\n", fp);
+            write_json_class(fp, &file->classes[i]);
+        }
+    }
+    fputs("\n  ]\n}\n", fp);
+    return ferror(fp) ? -1 : 0;
+}
+
+static void write_table_class(FILE *fp, const struct mof_class *cls, const char *source)
+{
+    uint32_t i = 0;
+
+    do {
+        if (source)
+            fprintf(fp, "%s\t", source);
+        fprintf(fp, "%s\t%s\t", cls->guid ? cls->guid : "-", cls->name ? cls->name : "-");
+        if (i < cls->num_methods && cls->methods[i].id >= 0)
+            fprintf(fp, "%d\t%s\n", cls->methods[i].id, cls->methods[i].name);
+        else if (i < cls->num_methods)
+            fprintf(fp, "-\t%s\n", cls->methods[i].name);
+        else
+            fputs("-\t-\n", fp);
+    } while (++i < cls->num_methods);
+}
+
+int mof_write_table(FILE *fp, const struct mof_file *file, const struct mof_class *cls,
+                    const char *source)
+{
+    uint32_t i;
+
+    if (cls)
+        write_table_class(fp, cls, source);
+    else
+        for (i = 0; i < file->num_classes; i++)
+            write_table_class(fp, &file->classes[i], source);
+    return ferror(fp) ? -1 : 0;
+}
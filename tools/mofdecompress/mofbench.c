@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <endian.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "bmof.h"
+
+/*
+ * Benchmark for the BMOF decoder over a fixed corpus: the files given on
+ * the command line and synthetic blobs generated from fixed seeds. Each
+ * input is timed warm, decoding the same buffers over and over, and cold,
+ * with the caches flushed by sweeping a large buffer before every run.
+ * Reports the best run as MB/s and ns per output byte, and on x86 as TSC
+ * cycles per token (literal or match).
+ */
+
+//bigger than any last level cache, swept to evict the corpus between cold runs
+#define EVICT_SIZE (128 << 20)
+
+struct bitwriter {
+    uint8_t *buf;
+    size_t len, cap;
+    uint64_t acc;
+    unsigned int count;
+};
+
+static void bw_put(struct bitwriter *bw, uint32_t v, unsigned int n)
+{
+    bw->acc |= (uint64_t)v << bw->count;
+    bw->count += n;
+    while (bw->count >= 8) {
+        if (bw->len == bw->cap) {
+            bw->cap *= 2;
+            bw->buf = realloc(bw->buf, bw->cap);
+            if (bw->buf == NULL) {
+                perror("Error allocating memory for the synthetic input");
+                exit(EXIT_FAILURE);
+            }
+        }
+        bw->buf[bw->len++] = bw->acc;
+        bw->acc >>= 8;
+        bw->count -= 8;
+    }
+}
+
+static uint32_t rnd(uint64_t *s) //xorshift64*
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return (*s * UINT64_C(2685821657736338717)) >> 32;
+}
+
+/*
+ * Build a valid BMOF blob expanding to about out_size bytes, with a
+ * literal/match mix and match lengths roughly like those of real MOF
+ * text, or with long_matches set, mostly long matches at all distances
+ * including short overlapping ones. Returns the whole file, header
+ * included.
+ */
+static uint8_t *synthesize(uint32_t out_size, int long_matches, size_t *file_size)
+{
+    struct bitwriter bw = { malloc(1 << 16), 16, 1 << 16, 0, 0 };
+    uint64_t seed = 0x9E3779B97F4A7C15ull ^ out_size;
+    uint32_t produced = 0, dist, len, m;
+    unsigned int k;
+    uint8_t byte;
+
+    if (bw.buf == NULL) {
+        perror("Error allocating memory for the synthetic input");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(bw.buf + 16, "DS\x00\x01", 4);
+    bw.len = 20;
+
+    while (produced < out_size) {
+        if (produced < 64 || rnd(&seed) % 10 < 3) {
+            byte = rnd(&seed);
+            if (byte & 0x80) {
+                bw_put(&bw, 1, 2);
+                bw_put(&bw, byte & 0x7f, 7);
+            } else {
+                bw_put(&bw, 2, 2);
+                bw_put(&bw, byte, 7);
+            }
+            produced++;
+            continue;
+        }
+
+        dist = 1 + rnd(&seed) % (produced < 4414 ? produced : 4414);
+        len = 2 + (rnd(&seed) % 64 >> (rnd(&seed) % 4));
+        if (long_matches) {
+            if (rnd(&seed) % 4 == 0)
+                dist = 1 + rnd(&seed) % 40;
+            len = 2 + rnd(&seed) % 512;
+        }
+        if (dist < 64) {
+            bw_put(&bw, 0, 2);
+            bw_put(&bw, dist, 6);
+        } else if (dist < 320) {
+            bw_put(&bw, 3, 2);
+            bw_put(&bw, 0, 1);
+            bw_put(&bw, dist - 64, 8);
+        } else {
+            bw_put(&bw, 3, 2);
+            bw_put(&bw, 1, 1);
+            bw_put(&bw, dist - 320, 12);
+        }
+        m = len - 1;
+        k = 31 - __builtin_clz(m);
+        bw_put(&bw, 1u << k, k + 1); //k zeros, then a one
+        if (k)
+            bw_put(&bw, m - (1u << k), k);
+        produced += len;
+    }
+
+    //end marker, then flush the last partial byte
+    bw_put(&bw, 3, 2);
+    bw_put(&bw, 1, 1);
+    bw_put(&bw, 4095, 12);
+    bw_put(&bw, 0, 7);
+
+    ((uint32_t *)bw.buf)[0] = htole32(BMOF_SIGNATURE);
+    ((uint32_t *)bw.buf)[1] = htole32(BMOF_VERSION);
+    ((uint32_t *)bw.buf)[2] = htole32(bw.len - 16);
+    ((uint32_t *)bw.buf)[3] = htole32(produced);
+    *file_size = bw.len;
+    return bw.buf;
+}
+
+static uint8_t *load(const char *path, size_t *file_size)
+{
+    FILE *fp;
+    uint8_t *buf;
+    long size;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL || fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 16) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    rewind(fp);
+    buf = malloc(size);
+    if (buf == NULL || fread(buf, size, 1, fp) != 1) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+    *file_size = size;
+    return buf;
+}
+
+/*
+ * Count the tokens of a valid blob with a bare walk over its bitstream,
+ * outside the timed decode.
+ */
+static uint64_t count_tokens(const uint8_t *file, uint32_t in_size, uint32_t out_size)
+{
+    struct bitreader br;
+    uint64_t tokens = 0, produced = 0;
+    uint32_t tag, dist, len, v;
+    int zeros;
+
+    br_init(&br, file + BMOF_HEADER_SIZE, in_size);
+    BR_GET(&br, v, 32, done); //block header
+    while (1) {
+        BR_GET(&br, tag, 2, done);
+        if (tag == 1 || tag == 2) {
+            BR_GET(&br, v, 7, done);
+            produced++;
+            tokens++;
+            continue;
+        }
+        if (tag) {
+            BR_GET(&br, v, 1, done);
+            BR_GET(&br, dist, v ? 12 : 8, done);
+            dist += v ? 320 : 64;
+        } else {
+            BR_GET(&br, dist, 6, done);
+        }
+        if (dist == BMOF_END_MARKER) {
+            if (produced >= out_size)
+                break;
+            continue;
+        }
+        zeros = br_zeros(&br, 32);
+        if (zeros <= 0) {
+            len = 2;
+        } else {
+            BR_GET(&br, len, zeros, done);
+            len += (1u << zeros) + 1;
+        }
+        produced += len;
+        tokens++;
+    }
+done:
+    return tokens;
+}
+
+static inline uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void evict_caches(void)
+{
+    static uint8_t *junk;
+    static uint8_t pass;
+
+    if (junk == NULL) {
+        junk = malloc(EVICT_SIZE);
+        if (junk == NULL) {
+            perror("Error allocating memory to flush the caches with");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(junk, ++pass, EVICT_SIZE);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct timing {
+    double seconds;  //best run
+    uint64_t cycles; //TSC ticks of the best run
+    long runs;
+};
+
+static long time_decode(const uint8_t *file, uint32_t in_size, uint8_t *out, uint32_t out_size,
+                        int cold, double min_time, struct timing *tm)
+{
+    struct bmof_decoder decoder;
+    double start, t;
+    uint64_t c;
+    long ret;
+
+    tm->seconds = 1e9;
+    tm->runs = 0;
+    start = now();
+    do {
+        if (cold)
+            evict_caches();
+        t = now();
+        c = ticks();
+        bmof_decoder_init(&decoder, file + BMOF_HEADER_SIZE, in_size);
+        decoder.out_slack = BMOF_OUT_SLACK;
+        ret = bmof_decode(&decoder, out, out_size);
+        c = ticks() - c;
+        t = now() - t;
+        if (t < tm->seconds) {
+            tm->seconds = t;
+            tm->cycles = c;
+        }
+        tm->runs++;
+    } while (now() - start < min_time || tm->runs < 3);
+    return ret;
+}
+
+static void report(const char *mode, uint32_t out_size, uint64_t tokens, const struct timing *tm)
+{
+    printf("  %-4s %6ld runs  %8.1f MB/s  %6.3f ns/byte", mode, tm->runs,
+           out_size / tm->seconds / 1e6, tm->seconds * 1e9 / out_size);
+    if (tm->cycles && tokens)
+        printf("  %6.1f cycles/token", (double)tm->cycles / tokens);
+    putchar('\n');
+}
+
+static void run(const char *name, const uint8_t *file, size_t file_size, double min_time)
+{
+    struct bmof_header hdr;
+    struct timing warm, cold;
+    uint64_t tokens;
+    uint8_t *out;
+    long ret;
+
+    ret = bmof_read_header(file, file_size, &hdr);
+    if (ret || hdr.in_size > file_size - BMOF_HEADER_SIZE) {
+        fprintf(stderr, "%s: %s\n", name, bmof_strerror(ret ? ret : BMOF_ERR_TRUNCATED));
+        exit(EXIT_FAILURE);
+    }
+    out = malloc(hdr.out_size + BMOF_OUT_SLACK);
+    if (out == NULL) {
+        perror("Error allocating memory for the output");
+        exit(EXIT_FAILURE);
+    }
+
+    ret = time_decode(file, hdr.in_size, out, hdr.out_size, 0, min_time, &warm);
+    if (ret != hdr.out_size) {
+        fprintf(stderr, "%s: %s\n", name, bmof_strerror(ret));
+        exit(EXIT_FAILURE);
+    }
+    time_decode(file, hdr.in_size, out, hdr.out_size, 1, min_time / 2, &cold);
+    tokens = count_tokens(file, hdr.in_size, hdr.out_size);
+
+    printf("%s: %u -> %u bytes, %llu tokens\n", name, hdr.in_size, hdr.out_size,
+           (unsigned long long)tokens);
+    report("warm", hdr.out_size, tokens, &warm);
+    report("cold", hdr.out_size, tokens, &cold);
+    free(out);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t synth_sizes[] = { 1 << 20, 16 << 20, 64 << 20 };
+    char name[32];
+    uint8_t *file;
+    size_t file_size, i;
+    int arg;
+
+    if (argc > 1 && !strcmp(argv[1], "--help")) {
+        fprintf(stderr, "Usage: %s [file.bmf...]\n"
+                "       %s -g MiB out.bmf\n"
+                "Time the BMOF decoder, warm and cold, on the given files and on\n"
+                "synthetic inputs, or write a synthetic blob expanding to about\n"
+                "MiB megabytes.\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (argc == 4 && !strcmp(argv[1], "-g")) {
+        FILE *fp = fopen(argv[3], "wb");
+
+        file = synthesize(strtoul(argv[2], NULL, 10) << 20, 0, &file_size);
+        if (fp == NULL || fwrite(file, file_size, 1, fp) != 1 || fclose(fp)) {
+            perror(argv[3]);
+            return EXIT_FAILURE;
+        }
+        free(file);
+        return 0;
+    }
+
+    for (arg = 1; arg < argc; arg++) {
+        file = load(argv[arg], &file_size);
+        run(argv[arg], file, file_size, 1.0);
+        free(file);
+    }
+
+    for (i = 0; i < sizeof(synth_sizes) / sizeof(synth_sizes[0]); i++) {
+        file = synthesize(synth_sizes[i], 0, &file_size);
+        snprintf(name, sizeof(name), "synthetic-%uM", synth_sizes[i] >> 20);
+        run(name, file, file_size, 2.0);
+        free(file);
+    }
+
+    //long and short-distance overlapping matches, to load the match copy
+    file = synthesize(64 << 20, 1, &file_size);
+    run("synthetic-long-64M", file, file_size, 2.0);
+    free(file);
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bmof.h"
+#include "mapfile.h"
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-1|-9] [input_file] [output_file]\n", prog_name);
+    fputs("\
+Compress the MOF data in input_file into a Binary MOF file that\n\
+mofdecompress and Windows will accept, written to output_file\n\
+\n\
+\t-1\tcompress quickly\n\
+\t-9\tcompress as small as possible (default)\n\
+\n\
+input_file and output_file default to the standard input/output, which\n\
+can also be given as -. The output is never written to a terminal.\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+//read a file that can't be mapped, such as a pipe
+static uint8_t *read_all(FILE *fp, size_t *len)
+{
+    size_t got = 0, cap = 1 << 16, n;
+    uint8_t *buf = NULL, *tmp;
+
+    while (1) {
+        tmp = realloc(buf, cap);
+        if (tmp == NULL) {
+            perror("Error allocating memory for the input file");
+            exit(EXIT_FAILURE);
+        }
+        buf = tmp;
+        n = fread(buf + got, 1, cap - got, fp);
+        got += n;
+        if (got < cap)
+            break;
+        cap *= 2;
+    }
+    if (ferror(fp)) {
+        perror("Error reading the input file");
+        exit(EXIT_FAILURE);
+    }
+    *len = got;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *inp_fd = stdin, *out_fd = stdout;
+    struct mapping in_mapping;
+    int level = BMOF_LEVEL_BEST, in_mapped, arg = 1;
+    uint8_t *in, *out;
+    size_t in_len, bound;
+    long ret;
+
+    if (arg < argc && (!strcmp(argv[arg], "-1") || !strcmp(argv[arg], "-9"))) {
+        level = argv[arg][1] == '1' ? BMOF_LEVEL_FAST : BMOF_LEVEL_BEST;
+        arg++;
+    }
+    if (argc - arg > 2 || (arg < argc && argv[arg][0] == '-' && argv[arg][1]))
+        print_usage(argv[0]);
+
+    if (arg < argc && strcmp(argv[arg], "-")) {
+        inp_fd = fopen(argv[arg], "rb");
+        if (inp_fd == NULL) {
+            perror("Error opening input file for reading");
+            exit(EXIT_FAILURE);
+        }
+    }
+    arg++;
+    if (arg < argc && strcmp(argv[arg], "-")) {
+        out_fd = fopen(argv[arg], "wb");
+        if (out_fd == NULL) {
+            perror("Error opening output file for writing");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (isatty(fileno(out_fd)))
+        print_usage(argv[0]);
+
+    in_mapped = map_input(fileno(inp_fd), &in_mapping) == 0;
+    if (in_mapped) {
+        in = in_mapping.data;
+        in_len = in_mapping.len;
+    } else
+        in = read_all(inp_fd, &in_len);
+    fprintf(stderr, "Input data size is %zu bytes\n", in_len);
+
+    bound = bmof_compress_bound(in_len);
+    out = (uint8_t*)malloc(bound);
+    if (out == NULL) {
+        perror("Error allocating memory for the output file");
+        exit(EXIT_FAILURE);
+    }
+
+    ret = bmof_compress(in, in_len, out, bound, level);
+    if (ret >= 0) {
+        fprintf(stderr, "Input compressed to %ld bytes!\n", ret);
+        if (fwrite(out, ret, 1, out_fd) != 1) {
+            perror("Error writing the output file");
+            ret = -1;
+        }
+    } else
+        fprintf(stderr, "An error occurred whilst compressing: %s\n", bmof_strerror(ret));
+
+    if (in_mapped)
+        unmap_input(&in_mapping);
+    else
+        free(in);
+    free(out);
+    fclose(inp_fd);
+    if (fclose(out_fd) && ret >= 0) {
+        perror("Error writing the output file");
+        ret = -1;
+    }
+    return ret >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bmof.h"
+#include "mapfile.h"
+#include "mof.h"
+
+enum format { FORMAT_MOF, FORMAT_JSON, FORMAT_TABLE };
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-f mof|json|table] [-c class | -g guid] [file...]\n", prog_name);
+    fputs("\
+Parse binary MOF files, compressed (as they come out of a DSDT or a\n\
+driver) or already decompressed, and print their classes.\n\
+\n\
+\t-f mof\t\tMOF source text (default)\n\
+\t-f json\t\tJSON, one object per file inside an array if there are several\n\
+\t-f table\tone line per method: GUID, class, WmiMethodId and name,\n\
+\t\t\tprefixed with the file name if there are several files\n\
+\t-c class\tonly the class with this name\n\
+\t-g guid\t\tonly the class with this GUID\n\
+\n\
+With no file, or when file is -, read the standard input.\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+//read a file that can't be mapped, such as a pipe
+static uint8_t *read_all(FILE *fp, size_t *len)
+{
+    size_t got = 0, cap = 1 << 16;
+    uint8_t *buf = NULL, *tmp;
+
+    while (1) {
+        tmp = realloc(buf, cap);
+        if (tmp == NULL) {
+            free(buf);
+            return NULL;
+        }
+        buf = tmp;
+        got += fread(buf + got, 1, cap - got, fp);
+        if (got < cap)
+            break;
+        cap *= 2;
+    }
+    if (ferror(fp)) {
+        free(buf);
+        return NULL;
+    }
+    *len = got;
+    return buf;
+}
+
+/*
+ * Parse one file into *mof. A compressed blob has version 1 right after
+ * the signature and "DS" where its data starts; decompressed data has the
+ * size of its object tree there instead.
+ */
+static int load(const char *path, struct mof_file *mof)
+{
+    struct bmof_header hdr;
+    struct mapping in_mapping;
+    FILE *fp = stdin;
+    uint8_t *in, *out = NULL;
+    size_t len;
+    int in_mapped, ret;
+
+    if (strcmp(path, "-")) {
+        fp = fopen(path, "rb");
+        if (fp == NULL) {
+            perror(path);
+            return -1;
+        }
+    }
+    in_mapped = map_input(fileno(fp), &in_mapping) == 0;
+    if (in_mapped) {
+        in = in_mapping.data;
+        len = in_mapping.len;
+    } else if ((in = read_all(fp, &len)) == NULL) {
+        perror(path);
+        if (fp != stdin)
+            fclose(fp);
+        return -1;
+    }
+
+    ret = BMOF_OK;
+    if (bmof_read_header(in, len, &hdr) == BMOF_OK && len >= BMOF_HEADER_SIZE + 2
+            && !memcmp(in + BMOF_HEADER_SIZE, "DS", 2)) {
+        out = malloc(hdr.out_size + BMOF_OUT_SLACK);
+        if (out == NULL)
+            ret = BMOF_ERR_NOMEM;
+        else
+            ret = bmof_decompress(in, len, out, hdr.out_size + BMOF_OUT_SLACK);
+        if (ret >= 0)
+            ret = mof_parse(out, ret, mof);
+    } else {
+        ret = mof_parse(in, len, mof);
+    }
+    if (ret)
+        fprintf(stderr, "%s: %s\n", path, bmof_strerror(ret));
+
+    free(out);
+    if (in_mapped)
+        unmap_input(&in_mapping);
+    else
+        free(in);
+    if (fp != stdin)
+        fclose(fp);
+    return ret ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    static char *stdin_only[] = { "-" };
+    enum format format = FORMAT_MOF;
+    const char *class_name = NULL, *guid = NULL, *source;
+    const struct mof_class *cls;
+    struct mof_file mof;
+    char **files;
+    int opt, num_files, i, written = 0, ret = EXIT_SUCCESS;
+
+    while ((opt = getopt(argc, argv, "f:c:g:")) != -1) {
+        switch (opt) {
+        case 'f':
+            if (!strcmp(optarg, "mof"))
+                format = FORMAT_MOF;
+            else if (!strcmp(optarg, "json"))
+                format = FORMAT_JSON;
+            else if (!strcmp(optarg, "table"))
+                format = FORMAT_TABLE;
+            else
+                print_usage(argv[0]);
+            break;
+        case 'c':
+            class_name = optarg;
+            break;
+        case 'g':
+            guid = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if (class_name && guid)
+        print_usage(argv[0]);
+    files = argv + optind;
+    num_files = argc - optind;
+    if (num_files == 0) {
+        if (isatty(fileno(stdin)))
+            print_usage(argv[0]);
+        files = stdin_only;
+        num_files = 1;
+    }
+
+    if (format == FORMAT_JSON && num_files > 1)
+        fputs("[\n", stdout);
+    for (i = 0; i < num_files; i++) {
+        if (load(files[i], &mof)) {
+            ret = EXIT_FAILURE;
+            continue;
+        }
+
+        cls = NULL;
+        if (class_name || guid) {
+            cls = class_name ? mof_find_class(&mof, class_name) : mof_find_guid(&mof, guid);
+            if (cls == NULL) {
+                fprintf(stderr, "%s: no class %s\n", files[i], class_name ? class_name : guid);
+                mof_free(&mof);
+                ret = EXIT_FAILURE;
+                continue;
+            }
+        }
+
+        source = num_files > 1 ? files[i] : NULL;
+        switch (format) {
+        case FORMAT_MOF:
+            if (source)
+                printf("// %s\n\n", source);
+            mof_write_mof(stdout, &mof, cls);
+            break;
+        case FORMAT_JSON:
+            if (written)
+                fputs(",\n", stdout);
+            mof_write_json(stdout, &mof, cls, source);
+            break;
+        case FORMAT_TABLE:
+            mof_write_table(stdout, &mof, cls, source);
+            break;
+        }
+        written++;
+        mof_free(&mof);
+    }
+    if (format == FORMAT_JSON && num_files > 1)
+        fputs("]\n", stdout);
+
+    if (fflush(stdout) || ferror(stdout)) {
+        perror("Error writing the output");
+        ret = EXIT_FAILURE;
+    }
+    return ret;
+}
@@ -0,0 +1,438 @@
+#include <string.h>
+
+#include "aml.h"
+
+//the opcodes the walker knows; the 0x5B ones are the second byte after ExtOpPrefix
+enum {
+    ZERO_OP = 0x00,
+    ONE_OP = 0x01,
+    ALIAS_OP = 0x06,
+    NAME_OP = 0x08,
+    BYTE_PREFIX = 0x0A,
+    WORD_PREFIX = 0x0B,
+    DWORD_PREFIX = 0x0C,
+    STRING_PREFIX = 0x0D,
+    QWORD_PREFIX = 0x0E,
+    SCOPE_OP = 0x10,
+    BUFFER_OP = 0x11,
+    PACKAGE_OP = 0x12,
+    VAR_PACKAGE_OP = 0x13,
+    METHOD_OP = 0x14,
+    EXTERNAL_OP = 0x15,
+    DUAL_NAME_PREFIX = 0x2E,
+    MULTI_NAME_PREFIX = 0x2F,
+    EXT_OP_PREFIX = 0x5B,
+    ROOT_CHAR = 0x5C,
+    PARENT_PREFIX = 0x5E,
+    LOCAL0_OP = 0x60,
+    ARG6_OP = 0x6E,
+    IF_OP = 0xA0,
+    ELSE_OP = 0xA1,
+    WHILE_OP = 0xA2,
+    NOOP_OP = 0xA3,
+    ONES_OP = 0xFF,
+
+    MUTEX_OP = 0x01,
+    EVENT_OP = 0x02,
+    REVISION_OP = 0x30,
+    REGION_OP = 0x80,
+    FIELD_OP = 0x81,
+    DEVICE_OP = 0x82,
+    PROCESSOR_OP = 0x83,
+    POWER_RES_OP = 0x84,
+    THERMAL_ZONE_OP = 0x85,
+    INDEX_FIELD_OP = 0x86,
+    BANK_FIELD_OP = 0x87,
+};
+
+//deeper than any table nests its scopes
+#define MAX_DEPTH 64
+
+struct walker {
+    const uint8_t *table;
+    aml_buffer_fn fn;
+    void *ctx;
+    struct aml_buffer buf;
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int aml_is_table(const uint8_t *data, size_t len)
+{
+    uint32_t table_len;
+
+    if (len < AML_HEADER_SIZE || (memcmp(data, "DSDT", 4) && memcmp(data, "SSDT", 4)))
+        return 0;
+    table_len = get_le32(data + 4);
+    return table_len >= AML_HEADER_SIZE && table_len <= len;
+}
+
+int aml_checksum_ok(const uint8_t *table)
+{
+    uint32_t i, len = get_le32(table + 4);
+    uint8_t sum = 0;
+
+    for (i = 0; i < len; i++)
+        sum += table[i];
+    return sum == 0;
+}
+
+/*
+ * A PkgLength at *p: sets *pkg_end to the end of the package, which the
+ * length counts from its own first byte, and moves *p past the encoding.
+ */
+static int pkg_length(const uint8_t **p, const uint8_t *end, const uint8_t **pkg_end)
+{
+    const uint8_t *start = *p;
+    uint32_t len;
+    int i, follow;
+
+    if (start == end)
+        return 0;
+    follow = start[0] >> 6;
+    if (end - start <= follow)
+        return 0;
+    if (follow == 0) {
+        len = start[0] & 0x3F;
+    } else {
+        len = start[0] & 0x0F;
+        for (i = 0; i < follow; i++)
+            len |= (uint32_t)start[1 + i] << (4 + 8 * i);
+    }
+    if (len < (uint32_t)follow + 1 || len > (size_t)(end - start))
+        return 0;
+    *pkg_end = start + len;
+    *p = start + 1 + follow;
+    return 1;
+}
+
+static int is_lead_char(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_name_char(uint8_t c)
+{
+    return is_lead_char(c) || (c >= '0' && c <= '9');
+}
+
+/*
+ * A NameString at *p, resolved against the absolute path scope into out.
+ * The root is "\" and every other path is "\SEG.SEG..."; only a name with
+ * no segments (NullName) may resolve to the root.
+ */
+static int name_string(const uint8_t **p, const uint8_t *end, const char *scope, char *out)
+{
+    const uint8_t *q = *p;
+    size_t len;
+    int segs;
+
+    if (q < end && *q == ROOT_CHAR) {
+        strcpy(out, "\\");
+        q++;
+    } else {
+        strcpy(out, scope);
+        for (; q < end && *q == PARENT_PREFIX; q++) {
+            len = strlen(out);
+            if (len > 1)
+                out[len > 5 ? len - 5 : 1] = '\0';
+        }
+    }
+    if (q == end)
+        return 0;
+    if (*q == ZERO_OP) {
+        segs = 0;
+        q++;
+    } else if (*q == DUAL_NAME_PREFIX) {
+        segs = 2;
+        q++;
+    } else if (*q == MULTI_NAME_PREFIX) {
+        if (end - q < 2 || q[1] == 0)
+            return 0;
+        segs = q[1];
+        q += 2;
+    } else {
+        segs = 1;
+    }
+
+    for (; segs > 0; segs--, q += 4) {
+        if (end - q < 4 || !is_lead_char(q[0]) || !is_name_char(q[1]) || !is_name_char(q[2])
+                || !is_name_char(q[3]))
+            return 0;
+        len = strlen(out);
+        if (len + 6 > AML_PATH_MAX)
+            return 0;
+        if (len > 1)
+            out[len++] = '.';
+        memcpy(out + len, q, 4);
+        out[len + 4] = '\0';
+    }
+    *p = q;
+    return 1;
+}
+
+//an integer constant; sets *value unless value is NULL
+static int integer(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    const uint8_t *q = *p;
+    uint64_t v;
+    int i, size;
+
+    if (q == end)
+        return 0;
+    switch (*q) {
+    case ZERO_OP:
+    case ONE_OP:
+        v = *q;
+        size = 0;
+        break;
+    case ONES_OP:
+        v = UINT64_MAX;
+        size = 0;
+        break;
+    case BYTE_PREFIX:
+        size = 1;
+        break;
+    case WORD_PREFIX:
+        size = 2;
+        break;
+    case DWORD_PREFIX:
+        size = 4;
+        break;
+    case QWORD_PREFIX:
+        size = 8;
+        break;
+    default:
+        return 0;
+    }
+    q++;
+    if (size) {
+        if (end - q < size)
+            return 0;
+        for (v = 0, i = size - 1; i >= 0; i--)
+            v = v << 8 | q[i];
+        q += size;
+    }
+    if (value)
+        *value = v;
+    *p = q;
+    return 1;
+}
+
+/*
+ * A term whose extent is known without knowing the namespace: a constant,
+ * a local or argument, or a name. A name could be a method call taking
+ * arguments, but outside of methods a name is all but always an object.
+ */
+static int simple_term(const uint8_t **p, const uint8_t *end)
+{
+    char path[AML_PATH_MAX];
+
+    if (*p == end)
+        return 0;
+    if (**p >= LOCAL0_OP && **p <= ARG6_OP) {
+        (*p)++;
+        return 1;
+    }
+    return integer(p, end, NULL) || name_string(p, end, "\\", path);
+}
+
+//the object a Name is given, other than a buffer
+static int data_object(const uint8_t **p, const uint8_t *end)
+{
+    const uint8_t *q = *p, *pkg_end;
+    char path[AML_PATH_MAX];
+
+    if (q == end)
+        return 0;
+    if (integer(p, end, NULL))
+        return 1;
+    switch (*q) {
+    case STRING_PREFIX:
+        q = memchr(q + 1, '\0', end - q - 1);
+        if (q == NULL)
+            return 0;
+        *p = q + 1;
+        return 1;
+    case BUFFER_OP:
+    case PACKAGE_OP:
+    case VAR_PACKAGE_OP:
+        q++;
+        if (!pkg_length(&q, end, &pkg_end))
+            return 0;
+        *p = pkg_end;
+        return 1;
+    case EXT_OP_PREFIX:
+        if (end - q < 2 || q[1] != REVISION_OP)
+            return 0;
+        *p = q + 2;
+        return 1;
+    }
+    return name_string(p, end, "\\", path);
+}
+
+/*
+ * Name (NAME, Buffer (SIZE) {...}) from the NameOp at *p. Returns 1 and
+ * fills w->buf if that is what is there, and moves *p past it.
+ */
+static int name_buffer(struct walker *w, const uint8_t **p, const uint8_t *end, const char *scope)
+{
+    const uint8_t *q = *p + 1, *size_end, *pkg_end;
+    uint64_t size;
+
+    if (!name_string(&q, end, scope, w->buf.path) || strlen(w->buf.path) < 5 || q == end
+            || *q != BUFFER_OP)
+        return 0;
+    q++;
+    if (!pkg_length(&q, end, &pkg_end))
+        return 0;
+    size_end = q;
+    if (integer(&size_end, pkg_end, &size)) {
+        w->buf.size = size > INT64_MAX ? -1 : (int64_t)size;
+    } else if (simple_term(&size_end, pkg_end)) {
+        w->buf.size = -1;
+    } else {
+        return 0;
+    }
+    w->buf.leaf = w->buf.path + strlen(w->buf.path) - 4;
+    w->buf.data = size_end;
+    w->buf.len = pkg_end - size_end;
+    w->buf.offset = *p - w->table;
+    *p = pkg_end;
+    return 1;
+}
+
+/*
+ * Past an opcode the walker can't size, the rest of the container can only
+ * be searched for the pattern of a named buffer. A match is skipped whole,
+ * so nothing is found inside a buffer's own bytes.
+ */
+static int search(struct walker *w, const uint8_t *p, const uint8_t *end, const char *scope)
+{
+    int ret;
+
+    while ((p = memchr(p, NAME_OP, end - p)) != NULL) {
+        if (name_buffer(w, &p, end, scope)) {
+            if ((ret = w->fn(w->ctx, &w->buf)))
+                return ret;
+        } else {
+            p++;
+        }
+    }
+    return 0;
+}
+
+static int walk(struct walker *w, const uint8_t *p, const uint8_t *end, const char *scope, int depth)
+{
+    char path[AML_PATH_MAX];
+    const uint8_t *start, *pkg_end;
+    int ret, skip;
+
+    while (p < end) {
+        start = p;
+        switch (*p++) {
+        case NAME_OP:
+            p = start;
+            if (name_buffer(w, &p, end, scope)) {
+                if ((ret = w->fn(w->ctx, &w->buf)))
+                    return ret;
+                continue;
+            }
+            p = start + 1;
+            if (name_string(&p, end, scope, path) && data_object(&p, end))
+                continue;
+            break;
+        case SCOPE_OP:
+            if (depth < MAX_DEPTH && pkg_length(&p, end, &pkg_end)
+                    && name_string(&p, pkg_end, scope, path)) {
+                if ((ret = walk(w, p, pkg_end, path, depth + 1)))
+                    return ret;
+                p = pkg_end;
+                continue;
+            }
+            break;
+        case BUFFER_OP:
+        case PACKAGE_OP:
+        case VAR_PACKAGE_OP:
+        case METHOD_OP:
+        case IF_OP:
+        case ELSE_OP:
+        case WHILE_OP:
+            if (pkg_length(&p, end, &pkg_end)) {
+                p = pkg_end;
+                continue;
+            }
+            break;
+        case ALIAS_OP:
+            if (name_string(&p, end, scope, path) && name_string(&p, end, scope, path))
+                continue;
+            break;
+        case EXTERNAL_OP:
+            if (name_string(&p, end, scope, path) && end - p >= 2) {
+                p += 2;
+                continue;
+            }
+            break;
+        case NOOP_OP:
+            continue;
+        case EXT_OP_PREFIX:
+            if (p == end)
+                break;
+            switch (*p++) {
+            case DEVICE_OP:
+            case THERMAL_ZONE_OP:
+            case PROCESSOR_OP:
+            case POWER_RES_OP:
+                //ProcID, PblkAddr and PblkLen, or SystemLevel and ResourceOrder
+                skip = p[-1] == PROCESSOR_OP ? 6 : p[-1] == POWER_RES_OP ? 3 : 0;
+                if (depth < MAX_DEPTH && pkg_length(&p, end, &pkg_end)
+                        && name_string(&p, pkg_end, scope, path) && pkg_end - p >= skip) {
+                    if ((ret = walk(w, p + skip, pkg_end, path, depth + 1)))
+                        return ret;
+                    p = pkg_end;
+                    continue;
+                }
+                break;
+            case FIELD_OP:
+            case INDEX_FIELD_OP:
+            case BANK_FIELD_OP:
+                if (pkg_length(&p, end, &pkg_end)) {
+                    p = pkg_end;
+                    continue;
+                }
+                break;
+            case MUTEX_OP:
+                if (name_string(&p, end, scope, path) && p < end) {
+                    p++;
+                    continue;
+                }
+                break;
+            case EVENT_OP:
+                if (name_string(&p, end, scope, path))
+                    continue;
+                break;
+            case REGION_OP:
+                //RegionSpace, then the offset and length, usually constants
+                if (!name_string(&p, end, scope, path) || p == end)
+                    break;
+                p++;
+                if (simple_term(&p, end) && simple_term(&p, end))
+                    continue;
+                break;
+            }
+            break;
+        }
+        return search(w, start, end, scope);
+    }
+    return 0;
+}
+
+int aml_scan(const uint8_t *table, aml_buffer_fn fn, void *ctx)
+{
+    struct walker w = { .table = table, .fn = fn, .ctx = ctx };
+
+    return walk(&w, table + AML_HEADER_SIZE, table + get_le32(table + 4), "\\", 0);
+}
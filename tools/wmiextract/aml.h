@@ -0,0 +1,46 @@
+#ifndef AML_H
+#define AML_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Finds the buffer objects, Name (X, Buffer (n) {...}), in a raw ACPI
+ * table such as a copy of /sys/firmware/acpi/tables/DSDT, without
+ * disassembling it.
+ *
+ * Only the opcodes that declare the namespace are walked: Scope, Device
+ * and the other containers are entered, and anything with a PkgLength
+ * that can't declare a buffer (methods, fields, packages, If blocks) is
+ * stepped over whole. Should the walker meet an opcode it can't size, it
+ * falls back to looking for the NameOp BufferOp byte pattern in the rest
+ * of the enclosing container, so a buffer is still found after it.
+ *
+ * Buffers point into the table: nothing is copied.
+ */
+
+#define AML_HEADER_SIZE 36
+#define AML_PATH_MAX 256
+
+struct aml_buffer {
+    char path[AML_PATH_MAX];    //absolute, e.g. \_SB_.PCI0.WMI1.WQBA
+    const char *leaf;           //the last NameSeg in path, 4 characters
+    const uint8_t *data;        //the initializer bytes
+    size_t len;
+    int64_t size;               //BufferSize, -1 if it isn't a constant
+    size_t offset;              //of the NameOp from the start of the table
+};
+
+//called for each buffer in order; a non-zero return stops the scan and is passed on
+typedef int (*aml_buffer_fn)(void *ctx, const struct aml_buffer *buf);
+
+//whether data starts with a DSDT or SSDT header that fits in len bytes
+int aml_is_table(const uint8_t *data, size_t len);
+
+//whether the table's bytes add up to 0, as they should
+int aml_checksum_ok(const uint8_t *table);
+
+//scan a table accepted by aml_is_table(); returns 0 or the first non-zero return of fn
+int aml_scan(const uint8_t *table, aml_buffer_fn fn, void *ctx);
+
+#endif
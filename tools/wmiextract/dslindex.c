@@ -0,0 +1,215 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dslindex.h"
+
+#define INDEX_MAGIC "wmixtract index 1"
+
+struct builder {
+    struct dsl_index *idx;
+    const char *text;
+};
+
+static uint32_t hash_key(const char *s)
+{
+    uint32_t h = 2166136261u;
+
+    for (; *s; s++)
+        h = (h ^ (uint8_t)(*s | (*s >= 'A' && *s <= 'Z' ? 0x20 : 0))) * 16777619u;
+    return h;
+}
+
+static int add_entry(void *ctx, const struct dsl_buffer *buf)
+{
+    struct builder *b = ctx;
+    struct dsl_index *idx = b->idx;
+    struct dsl_entry *e, *tmp;
+    const char *leaf;
+    size_t leaf_len;
+
+    //leave room for the occurrence number in the key
+    leaf = dsl_leaf_name(buf, &leaf_len);
+    if (leaf_len == 0 || leaf_len > 8 || buf->name_len > UINT32_MAX || buf->data_len > UINT32_MAX)
+        return 0;
+    if (idx->num_entries == idx->cap_entries) {
+        if (idx->cap_entries >= UINT32_MAX / 4)
+            return -1;
+        idx->cap_entries = idx->cap_entries ? 2 * idx->cap_entries : 64;
+        tmp = realloc(idx->entries, idx->cap_entries * sizeof(*tmp));
+        if (tmp == NULL)
+            return -1;
+        idx->entries = tmp;
+    }
+    e = &idx->entries[idx->num_entries++];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->key, leaf, leaf_len);
+    e->line = buf->line;
+    e->offset = buf->offset;
+    e->name_off = buf->name - b->text;
+    e->name_len = buf->name_len;
+    e->data_off = buf->data - b->text;
+    e->data_len = buf->data_len;
+    e->size = buf->size;
+    return 0;
+}
+
+//the first entry with key, and the given number unless it is -1
+static const struct dsl_entry *lookup(const struct dsl_index *idx, const char *key, int64_t number)
+{
+    uint32_t h, i;
+
+    if (idx->table == NULL)
+        return NULL;
+    for (h = hash_key(key); (i = idx->table[h & idx->table_mask]); h++) {
+        const struct dsl_entry *e = &idx->entries[i - 1];
+
+        if (!strcasecmp(e->key, key) && (number < 0 || e->number == number))
+            return e;
+    }
+    return NULL;
+}
+
+static void insert(struct dsl_index *idx, uint32_t i)
+{
+    uint32_t h = hash_key(idx->entries[i].key);
+
+    while (idx->table[h & idx->table_mask])
+        h++;
+    idx->table[h & idx->table_mask] = i + 1;
+}
+
+static int build_table(struct dsl_index *idx)
+{
+    uint32_t size = 16;
+
+    while (size < 2 * idx->num_entries)
+        size *= 2;
+    idx->table = calloc(size, sizeof(*idx->table));
+    if (idx->table == NULL)
+        return -1;
+    idx->table_mask = size - 1;
+    return 0;
+}
+
+int dsl_index_build(struct dsl_index *idx, const char *text, size_t len)
+{
+    struct builder b = { idx, text };
+    struct dsl_entry *e, *first;
+    uint32_t i;
+
+    memset(idx, 0, sizeof(*idx));
+    if (dsl_scan(text, len, add_entry, &b) || build_table(idx)) {
+        dsl_index_free(idx);
+        return -1;
+    }
+
+    //number repeated names in the order they appear, as wmixtract.py does
+    for (i = 0; i < idx->num_entries; i++) {
+        e = &idx->entries[i];
+        first = (struct dsl_entry *)lookup(idx, e->key, 0);
+        if (first) {
+            e->number = first->count++;
+            snprintf(e->key + strlen(e->key), DSL_KEY_MAX - strlen(e->key), "%" PRIu32, e->number);
+        } else {
+            e->count = 1;
+        }
+        insert(idx, i);
+    }
+    return 0;
+}
+
+void dsl_index_free(struct dsl_index *idx)
+{
+    free(idx->entries);
+    free(idx->table);
+    memset(idx, 0, sizeof(*idx));
+}
+
+const struct dsl_entry *dsl_index_find(const struct dsl_index *idx, const char *key)
+{
+    return lookup(idx, key, -1);
+}
+
+const struct dsl_entry *dsl_index_nth(const struct dsl_index *idx, const struct dsl_entry *e,
+                                      uint32_t n)
+{
+    char key[DSL_KEY_MAX + 10];
+
+    if (n == 0)
+        return e;
+    if (n >= e->count)
+        return NULL;
+    snprintf(key, sizeof(key), "%s%" PRIu32, e->key, n);
+    return lookup(idx, key, n);
+}
+
+void dsl_index_buffer(const struct dsl_entry *e, const char *text, struct dsl_buffer *buf)
+{
+    buf->name = text + e->name_off;
+    buf->name_len = e->name_len;
+    buf->data = text + e->data_off;
+    buf->data_len = e->data_len;
+    buf->offset = e->offset;
+    buf->line = e->line;
+    buf->size = e->size;
+}
+
+int dsl_index_save(const struct dsl_index *idx, FILE *fp, const char *stamp)
+{
+    const struct dsl_entry *e;
+    uint32_t i;
+
+    fprintf(fp, INDEX_MAGIC " %s\n", stamp);
+    for (i = 0; i < idx->num_entries; i++) {
+        e = &idx->entries[i];
+        fprintf(fp, "%s %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu64 " %" PRIu64 " %" PRIu32
+                " %" PRIu64 " %" PRIu32 " %" PRId64 "\n", e->key, e->number, e->count, e->line,
+                e->offset, e->name_off, e->name_len, e->data_off, e->data_len, e->size);
+    }
+    return fflush(fp) || ferror(fp) ? -1 : 0;
+}
+
+int dsl_index_load(struct dsl_index *idx, FILE *fp, const char *stamp, size_t text_len)
+{
+    char line[256], key[DSL_KEY_MAX];
+    struct dsl_entry *e, *tmp;
+    size_t magic_len = strlen(INDEX_MAGIC);
+    uint32_t i;
+
+    memset(idx, 0, sizeof(*idx));
+    if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, INDEX_MAGIC " ", magic_len + 1)
+            || strcspn(line + magic_len + 1, "\n") != strlen(stamp)
+            || strncmp(line + magic_len + 1, stamp, strlen(stamp)))
+        return -1;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (idx->num_entries == idx->cap_entries) {
+            idx->cap_entries = idx->cap_entries ? 2 * idx->cap_entries : 64;
+            tmp = realloc(idx->entries, idx->cap_entries * sizeof(*tmp));
+            if (tmp == NULL)
+                goto bad;
+            idx->entries = tmp;
+        }
+        e = &idx->entries[idx->num_entries];
+        memset(e, 0, sizeof(*e));
+        if (sscanf(line, "%15s %" SCNu32 " %" SCNu32 " %" SCNu32 " %" SCNu64 " %" SCNu64 " %" SCNu32
+                   " %" SCNu64 " %" SCNu32 " %" SCNd64, key, &e->number, &e->count, &e->line,
+                   &e->offset, &e->name_off, &e->name_len, &e->data_off, &e->data_len, &e->size) != 10
+                || e->name_off > text_len || e->name_len > text_len - e->name_off
+                || e->data_off > text_len || e->data_len > text_len - e->data_off)
+            goto bad;
+        strcpy(e->key, key);
+        idx->num_entries++;
+    }
+    if (ferror(fp) || build_table(idx))
+        goto bad;
+    for (i = 0; i < idx->num_entries; i++)
+        insert(idx, i);
+    return 0;
+
+bad:
+    dsl_index_free(idx);
+    return -1;
+}
@@ -0,0 +1,62 @@
+#ifndef DSLINDEX_H
+#define DSLINDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "dslscan.h"
+
+/*
+ * Index of every buffer object in a disassembled table, built with one
+ * dsl_scan() over the text. Buffers are keyed the way wmixtract.py names
+ * them: by the last NameSeg of their name, with the occurrence number
+ * appended from the second one on (WQBA, WQBA1, WQBA2...), and looked up
+ * through a hash table. An entry keeps only offsets into the text, so the
+ * index can be saved and used again with the file mapped, without
+ * scanning it.
+ */
+
+#define DSL_KEY_MAX 16
+
+struct dsl_entry {
+    char key[DSL_KEY_MAX];  //NAME or NAMEn
+    uint32_t number;        //occurrence of the name, from 0
+    uint32_t count;         //occurrences of the name, on the first one only
+    uint32_t line;
+    uint64_t offset, name_off, data_off;
+    uint32_t name_len, data_len;
+    int64_t size;           //declared size, -1 if not a plain integer
+};
+
+struct dsl_index {
+    struct dsl_entry *entries;
+    uint32_t num_entries, cap_entries;
+    uint32_t *table;        //entry index + 1 by hash of the key, 0 for empty slots
+    uint32_t table_mask;
+};
+
+//build the index of len bytes of text; returns 0, or -1 if out of memory
+int dsl_index_build(struct dsl_index *idx, const char *text, size_t len);
+
+void dsl_index_free(struct dsl_index *idx);
+
+//the entry with exactly this key, ignoring case, or NULL
+const struct dsl_entry *dsl_index_find(const struct dsl_index *idx, const char *key);
+
+//the occurrence of the same name numbered n, or NULL; e must be the first one
+const struct dsl_entry *dsl_index_nth(const struct dsl_index *idx, const struct dsl_entry *e,
+                                      uint32_t n);
+
+//the buffer an entry stands for, in the text it was built from
+void dsl_index_buffer(const struct dsl_entry *e, const char *text, struct dsl_buffer *buf);
+
+/*
+ * Save and load the index as text. stamp identifies the version of the
+ * file it was built from (e.g. its size and modification time); load
+ * returns -1 if the saved one differs or the index is malformed, 0 if it
+ * was loaded. text_len bounds the offsets of a loaded index.
+ */
+int dsl_index_save(const struct dsl_index *idx, FILE *fp, const char *stamp);
+int dsl_index_load(struct dsl_index *idx, FILE *fp, const char *stamp, size_t text_len);
+
+#endif
@@ -0,0 +1,290 @@
+#include <string.h>
+
+#include "dslscan.h"
+
+struct cursor {
+    const char *p, *end;
+    unsigned line;
+};
+
+static int is_word_char(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+//skip a comment at c->p, if there is one
+static int skip_comment(struct cursor *c)
+{
+    const char *p = c->p;
+
+    if (p + 1 < c->end && p[0] == '/' && p[1] == '*') {
+        for (p += 2; p < c->end && !(p[0] == '*' && p + 1 < c->end && p[1] == '/'); p++)
+            c->line += *p == '\n';
+        c->p = p + 2 <= c->end ? p + 2 : c->end;
+        return 1;
+    }
+    if (p + 1 < c->end && p[0] == '/' && p[1] == '/') {
+        p = memchr(p, '\n', c->end - p);
+        c->p = p ? p : c->end; //the newline is counted by the caller
+        return 1;
+    }
+    return 0;
+}
+
+//skip a string literal at c->p, if there is one
+static int skip_string(struct cursor *c)
+{
+    const char *p = c->p;
+
+    if (p[0] == '"') {
+        for (p++; p < c->end && *p != '"'; p++) {
+            if (*p == '\\' && p + 1 < c->end)
+                p++;
+            c->line += *p == '\n';
+        }
+        c->p = p < c->end ? p + 1 : c->end;
+        return 1;
+    }
+    return 0;
+}
+
+static void skip_space(struct cursor *c)
+{
+    while (c->p < c->end) {
+        if (*c->p == '\n')
+            c->line++;
+        else if (*c->p != ' ' && *c->p != '\t' && *c->p != '\r' && *c->p != '\f') {
+            if (!skip_comment(c))
+                return;
+            continue;
+        }
+        c->p++;
+    }
+}
+
+static int expect(struct cursor *c, char ch)
+{
+    skip_space(c);
+    if (c->p == c->end || *c->p != ch)
+        return 0;
+    c->p++;
+    return 1;
+}
+
+static int expect_word(struct cursor *c, const char *word)
+{
+    size_t len = strlen(word);
+
+    skip_space(c);
+    if ((size_t)(c->end - c->p) < len || memcmp(c->p, word, len)
+            || (c->p + len < c->end && is_word_char(c->p[len])))
+        return 0;
+    c->p += len;
+    return 1;
+}
+
+//an integer constant: 0x hex, decimal, Zero or One; -1 if there is none
+static long parse_integer(struct cursor *c)
+{
+    const char *p;
+    long value = 0;
+    int d;
+
+    if (expect_word(c, "Zero"))
+        return 0;
+    if (expect_word(c, "One"))
+        return 1;
+    p = c->p;
+    if (p == c->end || *p < '0' || *p > '9')
+        return -1;
+    if (p + 2 < c->end && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hex_value(p[2]) >= 0) {
+        for (p += 2; p < c->end && (d = hex_value(*p)) >= 0; p++) {
+            if (value > (0x7fffffffL - d) / 16)
+                return -1;
+            value = value * 16 + d;
+        }
+    } else {
+        for (; p < c->end && *p >= '0' && *p <= '9'; p++) {
+            if (value > (0x7fffffffL - (*p - '0')) / 10)
+                return -1;
+            value = value * 10 + *p - '0';
+        }
+    }
+    if (p < c->end && is_word_char(*p))
+        return -1;
+    c->p = p;
+    return value;
+}
+
+//a NameString: root or parent prefixes, then NameSegs separated by dots
+static int parse_name(struct cursor *c, struct dsl_buffer *buf)
+{
+    const char *p;
+
+    skip_space(c);
+    p = c->p;
+    while (p < c->end && (*p == '\\' || *p == '^'))
+        p++;
+    while (p < c->end && is_word_char(*p)) {
+        while (p < c->end && is_word_char(*p))
+            p++;
+        if (p + 1 < c->end && *p == '.' && is_word_char(p[1]))
+            p++;
+    }
+    if (p == c->p || !is_word_char(p[-1]))
+        return 0;
+    buf->name = c->p;
+    buf->name_len = p - c->p;
+    c->p = p;
+    return 1;
+}
+
+/*
+ * The rest of Name (NAME, Buffer (SIZE) {...}) after the Name keyword.
+ * The byte list ends at the first brace outside a comment or a string.
+ */
+static int parse_buffer(struct cursor *c, struct dsl_buffer *buf)
+{
+    int depth = 0;
+
+    if (!expect(c, '(') || !parse_name(c, buf) || !expect(c, ',') || !expect_word(c, "Buffer")
+            || !expect(c, '('))
+        return 0;
+    skip_space(c);
+    buf->size = parse_integer(c);
+    skip_space(c);
+    if (c->p < c->end && *c->p != ')')
+        buf->size = -1;
+    //anything else is an expression, whose value only the interpreter knows
+    while (c->p < c->end && (depth || *c->p != ')') && *c->p != '{' && *c->p != '\n') {
+        depth += (*c->p == '(') - (*c->p == ')');
+        c->p++;
+    }
+    if (!expect(c, ')') || !expect(c, '{'))
+        return 0;
+
+    buf->data = c->p;
+    while (c->p < c->end && *c->p != '}') {
+        if (skip_comment(c) || skip_string(c))
+            continue;
+        c->line += *c->p == '\n';
+        c->p++;
+    }
+    if (c->p == c->end)
+        return 0;
+    buf->data_len = c->p - buf->data;
+    c->p++;
+    return expect(c, ')');
+}
+
+int dsl_scan(const char *text, size_t len, dsl_buffer_fn fn, void *ctx)
+{
+    struct cursor c = { text, text + len, 1 }, after;
+    struct dsl_buffer buf;
+    const char *word;
+    int ret;
+
+    while (c.p < c.end) {
+        if (*c.p == '\n') {
+            c.line++;
+            c.p++;
+        } else if (is_word_char(*c.p)) {
+            word = c.p;
+            while (c.p < c.end && is_word_char(*c.p))
+                c.p++;
+            if (c.p - word != 4 || memcmp(word, "Name", 4))
+                continue;
+
+            //on a mismatch, carry on scanning right after the keyword
+            after = c;
+            if (!parse_buffer(&after, &buf))
+                continue;
+            buf.offset = word - text;
+            buf.line = c.line;
+            if ((ret = fn(ctx, &buf)))
+                return ret;
+            c = after;
+        } else if (!skip_comment(&c) && !skip_string(&c)) {
+            c.p++;
+        }
+    }
+    return 0;
+}
+
+const char *dsl_leaf_name(const struct dsl_buffer *buf, size_t *len)
+{
+    const char *p = buf->name + buf->name_len;
+
+    while (p > buf->name && is_word_char(p[-1]))
+        p--;
+    *len = buf->name + buf->name_len - p;
+    return p;
+}
+
+size_t dsl_buffer_bound(const struct dsl_buffer *buf)
+{
+    //every byte takes at least a digit and a separator
+    size_t listed = (buf->data_len + 1) / 2;
+
+    return buf->size > 0 && (size_t)buf->size > listed ? (size_t)buf->size : listed;
+}
+
+long dsl_buffer_decode(const struct dsl_buffer *buf, uint8_t *out)
+{
+    struct cursor c = { buf->data, buf->data + buf->data_len, 0 };
+    long n = 0, value;
+
+    skip_space(&c);
+    while (c.p < c.end) {
+        value = parse_integer(&c);
+        if (value < 0 || value > 0xff)
+            return -1;
+        out[n++] = value;
+        if (!expect(&c, ',')) {
+            skip_space(&c);
+            if (c.p < c.end)
+                return -1;
+        }
+        skip_space(&c);
+    }
+    if (buf->size > n) {
+        memset(out + n, 0, buf->size - n);
+        n = buf->size;
+    }
+    return n;
+}
+
+const char *dsl_buffer_item(const struct dsl_buffer *buf, size_t *pos, size_t *len)
+{
+    struct cursor c = { buf->data + *pos, buf->data + buf->data_len, 0 };
+    const char *item;
+
+    while (1) {
+        skip_space(&c);
+        if (c.p == c.end || *c.p != ',')
+            break;
+        c.p++;
+    }
+    if (c.p == c.end)
+        return NULL;
+    item = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != ' ' && *c.p != '\t' && *c.p != '\n'
+            && *c.p != '\r' && !(*c.p == '/' && c.p + 1 < c.end && (c.p[1] == '*' || c.p[1] == '/'))) {
+        if (!skip_string(&c))
+            c.p++;
+    }
+    *len = c.p - item;
+    *pos = c.p - buf->data;
+    return item;
+}
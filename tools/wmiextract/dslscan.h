@@ -0,0 +1,59 @@
+#ifndef DSLSCAN_H
+#define DSLSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Single pass scanner for the buffer objects in disassembled ACPI tables
+ * (iasl -d output), the blocks that look like:
+ *
+ *     Name (WQBA, Buffer (0x038C)
+ *     {
+ *         0x46, 0x4F, 0x4D, 0x42, 0x01, 0x00, 0x00, 0x00,  // FOMB....
+ *         ...
+ *     })
+ *
+ * with an offset comment in front of each row. Comments and string
+ * literals are skipped, so neither a commented out Name nor a brace in
+ * the ASCII column newer iasl versions print after each row confuses it.
+ * Nothing is copied: the buffers found point into the text.
+ */
+
+struct dsl_buffer {
+    const char *name;   //NameString as written, e.g. WQBA or \_SB.WMI.WQBA, not terminated
+    size_t name_len;
+    const char *data;   //the text between the braces
+    size_t data_len;
+    size_t offset;      //of the Name keyword from the start of the text
+    unsigned line;      //line of the Name keyword, from 1
+    long size;          //declared size, -1 if it isn't a plain integer
+};
+
+//called for each buffer in order; a non-zero return stops the scan and is passed on
+typedef int (*dsl_buffer_fn)(void *ctx, const struct dsl_buffer *buf);
+
+//scan len bytes of text, returns 0 or the first non-zero return of fn
+int dsl_scan(const char *text, size_t len, dsl_buffer_fn fn, void *ctx);
+
+//the last NameSeg of the buffer's name, e.g. WQBA for \_SB.WMI.WQBA
+const char *dsl_leaf_name(const struct dsl_buffer *buf, size_t *len);
+
+//room dsl_buffer_decode() may need for buf
+size_t dsl_buffer_bound(const struct dsl_buffer *buf);
+
+/*
+ * Decode the byte list of buf into out, padded with zeros up to the
+ * declared size as ACPI does. Returns the number of bytes, or -1 if the
+ * initializer isn't a list of byte constants (e.g. a string).
+ */
+long dsl_buffer_decode(const struct dsl_buffer *buf, uint8_t *out);
+
+/*
+ * The initializer's items as written, split at commas and whitespace with
+ * comments dropped, the way wmixtract.py prints them. Start with *pos 0;
+ * returns the next item and its length, or NULL after the last.
+ */
+const char *dsl_buffer_item(const struct dsl_buffer *buf, size_t *pos, size_t *len);
+
+#endif
@@ -0,0 +1,272 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mofcache.h"
+
+#define CACHE_MAGIC "wqdump cache 2"
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return x << r | x >> (64 - r);
+}
+
+static uint64_t get_le64(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t round64(uint64_t acc, uint64_t input)
+{
+    return rotl(acc + input * PRIME2, 31) * PRIME1;
+}
+
+static uint64_t merge(uint64_t acc, uint64_t val)
+{
+    return (acc ^ round64(0, val)) * PRIME1 + PRIME4;
+}
+
+//XXH64, which hashes a blob at several GB/s
+uint64_t mof_cache_hash(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = data, *end = p + len;
+    uint64_t h, v1, v2, v3, v4;
+
+    if (len >= 32) {
+        v1 = seed + PRIME1 + PRIME2;
+        v2 = seed + PRIME2;
+        v3 = seed;
+        v4 = seed - PRIME1;
+        for (; end - p >= 32; p += 32) {
+            v1 = round64(v1, get_le64(p));
+            v2 = round64(v2, get_le64(p + 8));
+            v3 = round64(v3, get_le64(p + 16));
+            v4 = round64(v4, get_le64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += len;
+
+    for (; end - p >= 8; p += 8)
+        h = rotl(h ^ round64(0, get_le64(p)), 27) * PRIME1 + PRIME4;
+    if (end - p >= 4) {
+        h = rotl(h ^ get_le32(p) * PRIME1, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = rotl(h ^ *p * PRIME5, 11) * PRIME1;
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+struct mof_cache_loaded {
+    uint64_t hash;
+    const uint8_t *blob;
+    size_t blob_len;
+    struct mof_cache_entry entry;
+    struct mapping mapping;
+};
+
+int mof_cache_open(struct mof_cache *cache, const char *dir)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->dir = dir;
+    if (mkdir(dir, 0777) && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+void mof_cache_close(struct mof_cache *cache)
+{
+    size_t i;
+
+    for (i = 0; i < cache->num_loaded; i++)
+        unmap_input(&cache->loaded[i].mapping);
+    free(cache->loaded);
+    cache->loaded = NULL;
+    cache->num_loaded = 0;
+}
+
+//the entry's file name: the hash and the length of the blob
+static char *entry_path(const struct mof_cache *cache, uint64_t hash, size_t len,
+                        const char *suffix)
+{
+    size_t size = strlen(cache->dir) + 64;
+    char *path = malloc(size);
+
+    if (path)
+        snprintf(path, size, "%s/%016" PRIx64 "-%zu%s", cache->dir, hash, len, suffix);
+    return path;
+}
+
+/*
+ * Map the entry's file and remember it; returns it, or NULL if it is
+ * missing, malformed or for another blob.
+ */
+static struct mof_cache_loaded *load(struct mof_cache *cache, uint64_t hash,
+                                     const uint8_t *blob, size_t len)
+{
+    struct mof_cache_loaded *l, *tmp;
+    char *path = entry_path(cache, hash, len, ""), *eol;
+    char head[128];
+    size_t blob_len, head_len, rest;
+    int fd, n;
+
+    tmp = realloc(cache->loaded, (cache->num_loaded + 1) * sizeof(*tmp));
+    if (tmp == NULL) {
+        free(path);
+        return NULL;
+    }
+    cache->loaded = tmp;
+    l = &tmp[cache->num_loaded];
+    memset(l, 0, sizeof(*l));
+    fd = path ? open(path, O_RDONLY) : -1;
+    free(path);
+    if (fd < 0)
+        return NULL;
+    n = map_input(fd, &l->mapping);
+    close(fd);
+    if (n)
+        return NULL;
+
+    //the header line, parsed from a terminated copy rather than the mapping
+    eol = memchr(l->mapping.data, '\n', l->mapping.len < sizeof(head) ? l->mapping.len : sizeof(head));
+    if (eol == NULL)
+        goto bad;
+    head_len = eol + 1 - (char *)l->mapping.data;
+    memcpy(head, l->mapping.data, head_len - 1);
+    head[head_len - 1] = '\0';
+    if (sscanf(head, CACHE_MAGIC " %zu %zu %zu %d", &blob_len, &l->entry.mof_len,
+               &l->entry.table_len, &l->entry.parse_error) != 4)
+        goto bad;
+    rest = l->mapping.len - head_len;
+    if (blob_len != len || blob_len > rest || l->entry.mof_len > rest - blob_len
+            || l->entry.table_len != rest - blob_len - l->entry.mof_len)
+        goto bad;
+    l->blob = l->mapping.data + head_len;
+    if (memcmp(l->blob, blob, len))
+        goto bad;
+    l->entry.mof = l->blob + len;
+    if (l->entry.parse_error == 0)
+        l->entry.table = (char *)l->entry.mof + l->entry.mof_len;
+    l->hash = hash;
+    l->blob_len = len;
+    cache->num_loaded++;
+    return l;
+
+bad:
+    unmap_input(&l->mapping);
+    return NULL;
+}
+
+int mof_cache_get(struct mof_cache *cache, const uint8_t *blob, size_t len,
+                  struct mof_cache_entry *entry)
+{
+    uint64_t hash = mof_cache_hash(blob, len, 0);
+    struct mof_cache_loaded *l = NULL;
+    size_t i;
+
+    //a handful of distinct blobs, even over a whole fleet
+    for (i = 0; i < cache->num_loaded && l == NULL; i++)
+        if (cache->loaded[i].hash == hash && cache->loaded[i].blob_len == len
+                && memcmp(cache->loaded[i].blob, blob, len) == 0)
+            l = &cache->loaded[i];
+    if (l == NULL && (l = load(cache, hash, blob, len)) == NULL) {
+        cache->misses++;
+        return 0;
+    }
+    *entry = l->entry;
+    cache->hits++;
+    cache->hit_bytes += entry->mof_len;
+    return 1;
+}
+
+int mof_cache_put(struct mof_cache *cache, const uint8_t *blob, size_t len,
+                  const struct mof_cache_entry *entry)
+{
+    uint64_t hash = mof_cache_hash(blob, len, 0);
+    char *path, *tmp_path;
+    size_t table_len = entry->table ? entry->table_len : 0;
+    FILE *fp = NULL;
+    int ret = -1;
+
+    if (cache->write_failed)
+        return -1;
+    path = entry_path(cache, hash, len, "");
+    tmp_path = entry_path(cache, hash, len, ".new");
+    if (path == NULL || tmp_path == NULL)
+        goto out;
+    //a name of its own, in case another run is storing the same entry
+    snprintf(tmp_path + strlen(tmp_path), 16, ".%ld", (long)getpid());
+
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL)
+        goto out;
+    fprintf(fp, CACHE_MAGIC " %zu %zu %zu %d\n", len, entry->mof_len, table_len,
+            entry->parse_error);
+    fwrite(blob, 1, len, fp);
+    fwrite(entry->mof, 1, entry->mof_len, fp);
+    fwrite(entry->table, 1, table_len, fp);
+    if (ferror(fp) | fclose(fp) || rename(tmp_path, path)) {
+        fp = NULL;
+        unlink(tmp_path);
+        goto out;
+    }
+    fp = NULL;
+    ret = 0;
+    //for the next time the blob comes up in this run
+    load(cache, hash, blob, len);
+
+out:
+    if (ret) {
+        if (fp) {
+            fclose(fp);
+            unlink(tmp_path);
+        }
+        fprintf(stderr, "Warning: not storing anything more in the cache %s: %s\n", cache->dir,
+                strerror(errno));
+        cache->write_failed = 1;
+    }
+    free(path);
+    free(tmp_path);
+    return ret;
+}
+
+void mof_cache_report(const struct mof_cache *cache)
+{
+    unsigned total = cache->hits + cache->misses;
+
+    fprintf(stderr, "Cache: %u hits, %u misses (%.0f%% hits), %" PRIu64 " bytes of MOF reused\n",
+            cache->hits, cache->misses, total ? 100.0 * cache->hits / total : 0.0,
+            cache->hit_bytes);
+}
@@ -0,0 +1,64 @@
+#ifndef MOFCACHE_H
+#define MOFCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapfile.h"
+
+/*
+ * On-disk cache of what a BMOF blob decodes to, for sweeping many dumps
+ * of machines that ship the same firmware. An entry is named by the
+ * XXH64 hash and the length of the compressed blob, and holds the blob
+ * itself, the decompressed MOF and its method table (mof_write_table()
+ * output), so a blob seen before costs a hash, a lookup and a compare
+ * instead of a decompression and a parse. Two blobs that collide share
+ * a file name, and only the one stored last is found. Entries are
+ * written to a temporary file and renamed into place, so several runs
+ * can share a directory. An entry stays mapped once it has been read or
+ * written, so a blob that repeats within a run isn't even looked up on
+ * disk again.
+ */
+
+struct mof_cache_entry {
+    const uint8_t *mof;
+    size_t mof_len;
+    const char *table;      //the method table, NULL if the MOF couldn't be parsed
+    size_t table_len;
+    int parse_error;        //what mof_parse() returned, BMOF_OK or a negative error
+};
+
+struct mof_cache_loaded;
+
+struct mof_cache {
+    const char *dir;
+    unsigned hits, misses;
+    uint64_t hit_bytes;     //MOF bytes served from the cache
+    int write_failed;       //warned already, don't store anything more
+    struct mof_cache_loaded *loaded; //entries mapped so far
+    size_t num_loaded;
+};
+
+uint64_t mof_cache_hash(const void *data, size_t len, uint64_t seed);
+
+//use dir, creating it if it doesn't exist yet; returns 0 or -1 with errno set
+int mof_cache_open(struct mof_cache *cache, const char *dir);
+
+//unmap every entry
+void mof_cache_close(struct mof_cache *cache);
+
+//the entry for blob, valid until mof_cache_close(): 1 on a hit, 0 on a miss
+int mof_cache_get(struct mof_cache *cache, const uint8_t *blob, size_t len,
+                  struct mof_cache_entry *entry);
+
+/*
+ * Store what blob decodes to. A cache that can't be written to is only
+ * reported once, and then left alone; returns 0 or -1.
+ */
+int mof_cache_put(struct mof_cache *cache, const uint8_t *blob, size_t len,
+                  const struct mof_cache_entry *entry);
+
+//print the hit and miss counts to stderr
+void mof_cache_report(const struct mof_cache *cache);
+
+#endif
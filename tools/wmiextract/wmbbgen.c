@@ -0,0 +1,688 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+
+/*
+ * wmbbgen: turn the method dispatch of a WMI method (WMBB on Clevo) in a
+ * disassembled DSDT into a C header, so that a driver knows at build time
+ * which method IDs the firmware handles instead of trying them.
+ *
+ * The method ID is Arg1. iasl writes a Switch on it out as
+ *
+ *     Name (_T_0, Zero)
+ *     Store (Arg1, _T_0)
+ *     If (LEqual (_T_0, One)) {...}
+ *     Else { If (LEqual (_T_0, 0x05)) {...} Else {...} }
+ *
+ * newer versions as Switch (ToInteger (Arg1)) { Case (One) {...} ... },
+ * and both are followed here, as are plain If (Arg1 == ...) sequences.
+ * Each case body is then looked at for what the call does: whether it
+ * uses the input (Arg2), sets the value the method returns, reads or
+ * writes the EC, only does something on some models, or has sub-functions
+ * selected by its input.
+ */
+
+#define CAP_PRESENT     0x01
+#define CAP_NOOP        0x02
+#define CAP_ARG         0x04
+#define CAP_RESULT      0x08
+#define CAP_EC_READ     0x10
+#define CAP_EC_WRITE    0x20
+#define CAP_GATED       0x40
+#define CAP_SUBFUNC     0x80
+
+static const struct {
+    unsigned bit;
+    const char *name, *doc;
+} cap_names[] = {
+    { CAP_PRESENT,  "PRESENT",  "handled by the method" },
+    { CAP_NOOP,     "NOOP",     "handled, but does nothing" },
+    { CAP_ARG,      "ARG",      "uses its input argument" },
+    { CAP_RESULT,   "RESULT",   "sets the value returned" },
+    { CAP_EC_READ,  "EC_READ",  "reads EC registers" },
+    { CAP_EC_WRITE, "EC_WRITE", "writes EC registers" },
+    { CAP_GATED,    "GATED",    "depends on a platform flag" },
+    { CAP_SUBFUNC,  "SUBFUNC",  "has sub-functions of its own" },
+};
+
+//the highest ID in the table, which is indexed by ID
+#define MAX_ID 0xFFFF
+
+struct token {
+    const char *s;
+    uint32_t len, line;
+};
+
+struct method_case {
+    uint32_t id, line;
+    unsigned caps;
+};
+
+struct gen {
+    struct token *t;
+    size_t num_tokens, cap_tokens;
+    const struct token *method, *result; //the method's name, what it returns
+    const struct token *selectors[8];    //Arg1 and what it was copied to
+    int num_selectors;
+    struct method_case *cases;
+    size_t num_cases, cap_cases;
+};
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-m method] [-l] [-o file.h] DSDT.dsl\n", prog_name);
+    fputs("\
+Generate a C header with the method IDs that a WMI method of a\n\
+disassembled DSDT handles, and what each of them does.\n\
+\n\
+\t-m method\tthe method to read (default WMBB)\n\
+\t-l\t\tlist the IDs instead: ID, line, capabilities\n\
+\t-o file.h\twrite the header to file.h (default standard output)\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+static int is_word_char(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+//NameStrings are single tokens, prefixes and dots included
+static int is_name_char(char c)
+{
+    return is_word_char(c) || c == '.' || c == '\\' || c == '^';
+}
+
+static int add_token(struct gen *g, const char *s, size_t len, uint32_t line)
+{
+    struct token *tmp;
+
+    if (g->num_tokens == g->cap_tokens) {
+        g->cap_tokens = g->cap_tokens ? 2 * g->cap_tokens : 4096;
+        tmp = realloc(g->t, g->cap_tokens * sizeof(*tmp));
+        if (tmp == NULL)
+            return -1;
+        g->t = tmp;
+    }
+    g->t[g->num_tokens++] = (struct token){ s, len, line };
+    return 0;
+}
+
+//names, numbers and single punctuation characters; comments are dropped, strings kept whole
+static int tokenize(struct gen *g, const char *p, const char *end)
+{
+    const char *start;
+    uint32_t line = 1;
+
+    while (p < end) {
+        start = p;
+        if (*p == '\n') {
+            line++;
+            p++;
+            continue;
+        } else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\f') {
+            p++;
+            continue;
+        } else if (p + 1 < end && p[0] == '/' && p[1] == '*') {
+            for (p += 2; p < end && !(p[0] == '*' && p + 1 < end && p[1] == '/'); p++)
+                line += *p == '\n';
+            p = p + 2 <= end ? p + 2 : end;
+            continue;
+        } else if (p + 1 < end && p[0] == '/' && p[1] == '/') {
+            p = memchr(p, '\n', end - p);
+            p = p ? p : end;
+            continue;
+        } else if (*p == '"') {
+            for (p++; p < end && *p != '"'; p++) {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+                line += *p == '\n';
+            }
+            p = p < end ? p + 1 : end;
+        } else if (is_name_char(*p)) {
+            while (p < end && is_name_char(*p))
+                p++;
+        } else {
+            p++;
+        }
+        if (add_token(g, start, p - start, line))
+            return -1;
+    }
+    return 0;
+}
+
+static int is(const struct gen *g, size_t i, const char *word)
+{
+    return i < g->num_tokens && g->t[i].len == strlen(word) && !memcmp(g->t[i].s, word, g->t[i].len);
+}
+
+static int same(const struct token *a, const struct token *b)
+{
+    return a->len == b->len && !memcmp(a->s, b->s, a->len);
+}
+
+//the index of the bracket closing the one at i, or 0 if there is none
+static size_t closing(const struct gen *g, size_t i)
+{
+    char open = g->t[i].s[0], close = open == '(' ? ')' : '}';
+    int depth = 0;
+
+    for (; i < g->num_tokens; i++) {
+        if (g->t[i].len != 1)
+            continue;
+        depth += (g->t[i].s[0] == open) - (g->t[i].s[0] == close);
+        if (depth == 0)
+            return i;
+    }
+    return 0;
+}
+
+/*
+ * The token after the statement at i, with its arguments and its block.
+ * A statement in the ASL 2.0 operator syntax, such as Local0 = Arg1, is
+ * taken to end with its line.
+ */
+static size_t next_statement(const struct gen *g, size_t i, size_t end)
+{
+    size_t j = i + 1, c;
+    uint32_t line = g->t[i].line;
+
+    if (is(g, j, "(") && (c = closing(g, j)))
+        j = c + 1;
+    else
+        while (j < end && g->t[j].line == line && !is(g, j, "{"))
+            j = is(g, j, "(") && (c = closing(g, j)) ? c + 1 : j + 1;
+    if (is(g, j, "{") && (c = closing(g, j)))
+        j = c + 1;
+    return j < end ? j : end;
+}
+
+//an integer constant as iasl writes it
+static int number(const struct gen *g, size_t i, uint32_t *value)
+{
+    const struct token *t = &g->t[i];
+    char buf[24], *end;
+    unsigned long v;
+
+    if (is(g, i, "Zero") || is(g, i, "One")) {
+        *value = is(g, i, "One");
+        return 1;
+    }
+    if (t->len >= sizeof(buf) || t->s[0] < '0' || t->s[0] > '9')
+        return 0;
+    memcpy(buf, t->s, t->len);
+    buf[t->len] = '\0';
+    v = strtoul(buf, &end, 0);
+    if (*end || v > UINT32_MAX)
+        return 0;
+    *value = v;
+    return 1;
+}
+
+static int is_selector(const struct gen *g, size_t i)
+{
+    int k;
+
+    for (k = 0; k < g->num_selectors; k++)
+        if (same(&g->t[i], g->selectors[k]))
+            return 1;
+    return 0;
+}
+
+//Arg1 or ToInteger (Arg1) from i to end
+static int is_arg1(const struct gen *g, size_t i, size_t end)
+{
+    if (end == i + 1)
+        return is(g, i, "Arg1");
+    return end == i + 4 && is(g, i, "ToInteger") && is(g, i + 1, "(") && is(g, i + 2, "Arg1")
+           && is(g, i + 3, ")");
+}
+
+//remember Arg1 and what it is copied to between b and e: Store (Arg1, X) or X = Arg1
+static void find_selectors(struct gen *g, size_t arg1, size_t b, size_t e)
+{
+    size_t i, end;
+
+    g->selectors[g->num_selectors++] = &g->t[arg1];
+    for (i = b; i < e; i++) {
+        if (g->num_selectors == sizeof(g->selectors) / sizeof(g->selectors[0]))
+            return;
+        if (is(g, i, "Store") && is(g, i + 1, "(")) {
+            for (end = i + 2; end < e && !is(g, end, ","); end++)
+                ;
+            if (is_arg1(g, i + 2, end) && is(g, end + 2, ")"))
+                g->selectors[g->num_selectors++] = &g->t[end + 1];
+        } else if (is(g, i, "=") && i > b && !is(g, i - 1, "=") && !is(g, i + 1, "=")) {
+            for (end = i + 1; end < e && g->t[end].line == g->t[i].line; end++)
+                ;
+            if (is_arg1(g, i + 1, end))
+                g->selectors[g->num_selectors++] = &g->t[i - 1];
+        }
+    }
+}
+
+//LEqual (SEL, N), (SEL == N) and the like between b and e; sets *id
+static int selector_test(const struct gen *g, size_t b, size_t e, uint32_t *id)
+{
+    while (e - b > 2 && is(g, b, "(") && closing(g, b) == e - 1) {
+        b++;
+        e--;
+    }
+    if (e - b == 6 && is(g, b, "LEqual") && is(g, b + 1, "(") && is(g, b + 3, ",")
+            && is(g, b + 5, ")"))
+        return is_selector(g, b + 2) && number(g, b + 4, id);
+    if (e - b == 4 && is(g, b + 1, "=") && is(g, b + 2, "="))
+        return is_selector(g, b) && number(g, b + 3, id);
+    return 0;
+}
+
+static int is_ec_name(const struct token *t)
+{
+    const char *p = t->s, *end = t->s + t->len, *seg;
+    size_t len;
+
+    //any segment but the last called EC, EC0 or H_EC
+    while ((seg = memchr(p, '.', end - p)) != NULL) {
+        while (p < seg && (*p == '\\' || *p == '^'))
+            p++;
+        len = seg - p;
+        if ((len == 2 && !memcmp(p, "EC", 2)) || (len == 3 && !memcmp(p, "EC0", 3))
+                || (len == 4 && !memcmp(p, "H_EC", 4)))
+            return 1;
+        p = seg + 1;
+    }
+    return 0;
+}
+
+//operators whose last argument is where they store their result
+static int stores_last(const struct gen *g, size_t i, int *num_args)
+{
+    static const char *const two[] = { "Store", "Not", "FindSetLeftBit", "FindSetRightBit",
+                                       "ToInteger", "ToBuffer", "ToBCD", "FromBCD", NULL };
+    static const char *const three[] = { "Add", "Subtract", "Multiply", "Divide", "Mod", "And",
+                                         "Or", "XOr", "NAnd", "NOr", "ShiftLeft", "ShiftRight",
+                                         NULL };
+    int k;
+
+    for (k = 0; two[k]; k++)
+        if (is(g, i, two[k])) {
+            *num_args = 2;
+            return 1;
+        }
+    for (k = 0; three[k]; k++)
+        if (is(g, i, three[k])) {
+            *num_args = 3;
+            return 1;
+        }
+    return 0;
+}
+
+//what the case body from b to e does
+static unsigned analyse(const struct gen *g, size_t b, size_t e)
+{
+    unsigned caps = CAP_PRESENT;
+    size_t i, j, c, last, after;
+    int num_args, n, ec_names = 0, ec_written = 0;
+
+    if (b == e)
+        return caps | CAP_NOOP;
+
+    for (i = b; i < e; i++) {
+        if (is(g, i, "Arg2"))
+            caps |= CAP_ARG;
+        if (g->result && same(&g->t[i], g->result))
+            caps |= CAP_RESULT;
+        if (is(g, i, "Switch") || (g->t[i].len == 4 && !memcmp(g->t[i].s, "_T_", 3)))
+            caps |= CAP_SUBFUNC;
+        if (is_ec_name(&g->t[i])) {
+            ec_names++;
+            //EC.FOO = ..., in the ASL 2.0 syntax
+            ec_written += is(g, i + 1, "=") && !is(g, i + 2, "=");
+        }
+
+        //Store (..., EC.FOO) and the like: the result goes to the last argument
+        if (!stores_last(g, i, &num_args) || !is(g, i + 1, "(") || !(c = closing(g, i + 1)))
+            continue;
+        for (j = i + 2, n = 1, last = i + 2; j < c; j++) {
+            if (is(g, j, "(") && closing(g, j))
+                j = closing(g, j);
+            else if (is(g, j, ","))
+                n++, last = j + 1;
+        }
+        ec_written += n == num_args && c == last + 1 && is_ec_name(&g->t[last]);
+    }
+    if (ec_written)
+        caps |= CAP_EC_WRITE;
+    if (ec_names > ec_written)
+        caps |= CAP_EC_READ;
+
+    //all of it in one If on something other than the arguments and locals
+    if (is(g, b, "If") && is(g, b + 1, "(") && (c = closing(g, b + 1))) {
+        after = next_statement(g, b, e);
+        if (is(g, after, "Else"))
+            after = next_statement(g, after, e);
+        for (i = b + 2; after == e && i < c; i++)
+            if ((g->t[i].len == 4 && !memcmp(g->t[i].s, "Arg", 3))
+                    || (g->t[i].len == 6 && !memcmp(g->t[i].s, "Local", 5)))
+                break;
+        if (after == e && i == c)
+            caps |= CAP_GATED;
+    }
+    return caps;
+}
+
+static int add_case(struct gen *g, uint32_t id, size_t at, size_t b, size_t e)
+{
+    struct method_case *tmp;
+    size_t k;
+
+    if (id > MAX_ID) {
+        fprintf(stderr, "Line %u: method ID 0x%X is too large\n", g->t[at].line, id);
+        return -1;
+    }
+    //the firmware runs the first case that matches
+    for (k = 0; k < g->num_cases; k++)
+        if (g->cases[k].id == id) {
+            fprintf(stderr, "Warning: line %u: method ID 0x%X already handled on line %u\n",
+                    g->t[at].line, id, g->cases[k].line);
+            return 0;
+        }
+    if (g->num_cases == g->cap_cases) {
+        g->cap_cases = g->cap_cases ? 2 * g->cap_cases : 64;
+        tmp = realloc(g->cases, g->cap_cases * sizeof(*tmp));
+        if (tmp == NULL) {
+            perror("Error allocating memory");
+            return -1;
+        }
+        g->cases = tmp;
+    }
+    g->cases[g->num_cases++] = (struct method_case){ id, g->t[at].line, analyse(g, b, e) };
+    return 0;
+}
+
+//the block of the statement at i, if it has one
+static int block(const struct gen *g, size_t i, size_t end, size_t *b, size_t *e)
+{
+    size_t j = next_statement(g, i, end), c;
+
+    if (j == 0 || !is(g, j - 1, "}"))
+        return 0;
+    for (c = i + 1; c < j && !is(g, c, "{"); c++)
+        if (is(g, c, "(") && closing(g, c))
+            c = closing(g, c);
+    *b = c + 1;
+    *e = j - 1;
+    return 1;
+}
+
+//Case (N) and Case (Package () {N, M}) in the body of a Switch
+static int walk_switch(struct gen *g, size_t b, size_t e)
+{
+    size_t i, k, c, cb, ce;
+    uint32_t id;
+
+    for (i = b; i < e; i = next_statement(g, i, e)) {
+        if (!is(g, i, "Case") || !is(g, i + 1, "(") || !(c = closing(g, i + 1))
+                || !block(g, i, e, &cb, &ce))
+            continue;
+        if (c == i + 3 && number(g, i + 2, &id)) {
+            if (add_case(g, id, i, cb, ce))
+                return -1;
+        } else if (is(g, i + 2, "Package")) {
+            for (k = i + 3; k < c && !is(g, k, "{"); k++)
+                ;
+            for (; k < c; k++)
+                if (number(g, k, &id) && add_case(g, id, k, cb, ce))
+                    return -1;
+        }
+    }
+    return 0;
+}
+
+//the tests on the method ID in a block, following Else blocks
+static int walk_chain(struct gen *g, size_t b, size_t e)
+{
+    size_t i, c, cb, ce;
+    uint32_t id;
+
+    for (i = b; i < e; i = next_statement(g, i, e)) {
+        if (is(g, i, "Switch") && is(g, i + 1, "(") && (c = closing(g, i + 1))
+                && (is_arg1(g, i + 2, c) || (c == i + 3 && is_selector(g, i + 2)))) {
+            if (block(g, i, e, &cb, &ce) && walk_switch(g, cb, ce))
+                return -1;
+            continue;
+        }
+        if (!(is(g, i, "If") || is(g, i, "ElseIf")) || !is(g, i + 1, "(") || !(c = closing(g, i + 1))
+                || !selector_test(g, i + 2, c, &id) || !block(g, i, e, &cb, &ce))
+            continue;
+        if (add_case(g, id, i, cb, ce))
+            return -1;
+        //the rest of the chain is in the Else
+        c = next_statement(g, i, e);
+        if (is(g, c, "Else") && block(g, c, e, &cb, &ce) && walk_chain(g, cb, ce))
+            return -1;
+    }
+    return 0;
+}
+
+static int find_method(struct gen *g, const char *name, size_t *b, size_t *e)
+{
+    size_t i, j;
+
+    for (i = 0; i + 3 < g->num_tokens; i++) {
+        if (!is(g, i, "Method") || !is(g, i + 1, "(") || !is(g, i + 2, name))
+            continue;
+        if (!block(g, i, g->num_tokens, b, e))
+            return 0;
+        g->method = &g->t[i + 2];
+
+        //what it returns last, if a name
+        for (j = *e; j-- > *b;)
+            if (is(g, j, "Return") && is(g, j + 1, "(") && is(g, j + 3, ")")) {
+                if (g->t[j + 2].len && is_word_char(g->t[j + 2].s[0])
+                        && !(g->t[j + 2].s[0] >= '0' && g->t[j + 2].s[0] <= '9'))
+                    g->result = &g->t[j + 2];
+                break;
+            }
+        return 1;
+    }
+    return 0;
+}
+
+static int compare_cases(const void *a, const void *b)
+{
+    const struct method_case *x = a, *y = b;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static void write_caps(FILE *fp, unsigned caps)
+{
+    const char *sep = "";
+    size_t k;
+
+    for (k = 0; k < sizeof(cap_names) / sizeof(cap_names[0]); k++)
+        if (caps & cap_names[k].bit) {
+            fprintf(fp, "%sWMBB_CAP_%s", sep, cap_names[k].name);
+            sep = " | ";
+        }
+}
+
+//tabs from column to the next multiple of 8 that is at least to
+static void pad(FILE *fp, int column, int to)
+{
+    do {
+        fputc('\t', fp);
+        column = (column / 8 + 1) * 8;
+    } while (column < to);
+}
+
+//the capabilities as a macro body, wrapped at 80 columns
+static void write_caps_macro(FILE *fp, uint32_t id, unsigned caps)
+{
+    const char *sep = "(";
+    int column = 32;
+    size_t k, len;
+
+    fprintf(fp, "#define WMBB_CAPS_%02X", id);
+    pad(fp, 20, column);
+    for (k = 0; k < sizeof(cap_names) / sizeof(cap_names[0]); k++) {
+        if (!(caps & cap_names[k].bit))
+            continue;
+        len = strlen(sep) + 9 + strlen(cap_names[k].name);
+        if (column + len + 2 > 80) {
+            fputs(" | \\\n\t\t\t\t ", fp);
+            column = 33;
+            sep = "";
+            len -= 3;
+        }
+        fprintf(fp, "%sWMBB_CAP_%s", sep, cap_names[k].name);
+        column += len;
+        sep = " | ";
+    }
+    fputs(")\n", fp);
+}
+
+//kernel style, as it is included by the driver
+static void write_header(FILE *fp, const struct gen *g, const char *source)
+{
+    const char *base = strrchr(source, '/');
+    uint32_t max_id = g->cases[g->num_cases - 1].id;
+    size_t k;
+
+    fprintf(fp, "\
+/*\n\
+ * Method IDs handled by %.*s in %s, line %u.\n\
+ * Generated by tools/wmiextract/wmbbgen; do not edit.\n\
+ */\n\
+\n\
+#ifndef CLEVO_WMBB_H\n\
+#define CLEVO_WMBB_H\n\
+\n", (int)g->method->len, g->method->s, base ? base + 1 : source, g->method->line);
+
+    for (k = 0; k < sizeof(cap_names) / sizeof(cap_names[0]); k++) {
+        fprintf(fp, "#define WMBB_CAP_%s", cap_names[k].name);
+        pad(fp, 17 + strlen(cap_names[k].name), 32);
+        fprintf(fp, "0x%02X\t/* %s */\n", cap_names[k].bit, cap_names[k].doc);
+    }
+
+    fprintf(fp, "\n#define WMBB_NUM_IDS\t\t%zu\n#define WMBB_MAX_ID\t\t0x%02X\n\n", g->num_cases,
+            max_id);
+    fputs("/* capabilities of each ID handled, for #if */\n", fp);
+    for (k = 0; k < g->num_cases; k++)
+        write_caps_macro(fp, g->cases[k].id, g->cases[k].caps);
+
+    fputs("\n/* the IDs handled, in order */\n"
+          "static const unsigned short wmbb_ids[WMBB_NUM_IDS] = {", fp);
+    for (k = 0; k < g->num_cases; k++)
+        fprintf(fp, "%s0x%02X,", k % 8 ? " " : "\n\t", g->cases[k].id);
+    fputs("\n};\n\n/* capabilities by ID, 0 for an ID that isn't handled */\n"
+          "static const unsigned char wmbb_caps[WMBB_MAX_ID + 1] = {\n", fp);
+    for (k = 0; k < g->num_cases; k++)
+        fprintf(fp, "\t[0x%02X] = WMBB_CAPS_%02X,\t/* line %u */\n", g->cases[k].id,
+                g->cases[k].id, g->cases[k].line);
+    fputs("};\n\n#define wmbb_has(id)\t((unsigned int)(id) <= WMBB_MAX_ID && wmbb_caps[id])\n\n"
+          "#endif\n", fp);
+}
+
+//find the method and the cases of its dispatch on the method ID
+static int parse(struct gen *g, const char *text, size_t len, const char *source,
+                 const char *method)
+{
+    size_t b, e, i;
+
+    if (tokenize(g, text, text + len)) {
+        perror("Error allocating memory");
+        return -1;
+    }
+    if (!find_method(g, method, &b, &e)) {
+        fprintf(stderr, "%s: no method %s\n", source, method);
+        return -1;
+    }
+    for (i = b; i < e && !is(g, i, "Arg1"); i++)
+        ;
+    if (i == e) {
+        fprintf(stderr, "%s: %s doesn't use Arg1, the method ID\n", source, method);
+        return -1;
+    }
+    find_selectors(g, i, b, e);
+    if (walk_chain(g, b, e))
+        return -1;
+    if (g->num_cases == 0) {
+        fprintf(stderr, "%s: no tests on the method ID in %s\n", source, method);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct gen g;
+    struct mapping mapping;
+    const char *method = "WMBB", *out_path = NULL, *source;
+    FILE *fp, *out = stdout;
+    size_t i;
+    int opt, list = 0, ret = EXIT_SUCCESS;
+
+    while ((opt = getopt(argc, argv, "m:lo:")) != -1) {
+        switch (opt) {
+        case 'm':
+            method = optarg;
+            break;
+        case 'l':
+            list = 1;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1)
+        print_usage(argv[0]);
+    source = argv[optind];
+
+    fp = fopen(source, "rb");
+    if (fp == NULL || map_input(fileno(fp), &mapping)) {
+        perror(source);
+        return EXIT_FAILURE;
+    }
+    memset(&g, 0, sizeof(g));
+    if (parse(&g, (char *)mapping.data, mapping.len, source, method)) {
+        ret = EXIT_FAILURE;
+        goto out;
+    }
+    qsort(g.cases, g.num_cases, sizeof(*g.cases), compare_cases);
+
+    if (out_path && (out = fopen(out_path, "w")) == NULL) {
+        perror(out_path);
+        ret = EXIT_FAILURE;
+        goto out;
+    }
+    if (list) {
+        for (i = 0; i < g.num_cases; i++) {
+            fprintf(out, "0x%02X\t%u\t", g.cases[i].id, g.cases[i].line);
+            write_caps(out, g.cases[i].caps & ~CAP_PRESENT);
+            fputc('\n', out);
+        }
+    } else {
+        write_header(out, &g, source);
+    }
+    if (fflush(out) || ferror(out) || (out != stdout && fclose(out))) {
+        perror(out_path ? out_path : "Error writing the output");
+        ret = EXIT_FAILURE;
+    }
+
+out:
+    free(g.t);
+    free(g.cases);
+    unmap_input(&mapping);
+    fclose(fp);
+    return ret;
+}
@@ -0,0 +1,220 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dslindex.h"
+#include "mapfile.h"
+
+/*
+ * Native wmixtract.py: print the bytes of named buffers in a disassembled
+ * DSDT. The file is scanned once into an index of all its buffers, and
+ * every name asked for is then a hash lookup; with -x the index is kept
+ * next to the file and later runs don't scan it at all while it stays
+ * unchanged.
+ */
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-x] NAME... DSDT.dsl\n\
+       %s [-x] -l DSDT.dsl\n", prog_name, prog_name);
+    fputs("\
+Print the contents of the buffers called NAME in a disassembled DSDT,\n\
+one line of comma separated bytes per buffer, as wmixtract.py does.\n\
+A name that occurs more than once is numbered from its second occurrence\n\
+on: WQBA1 is the second WQBA. A bare name prints every occurrence.\n\
+\n\
+\t-l\tlist every buffer: name, line, byte offset and declared size\n\
+\t-x\tkeep the index in DSDT.dsl.idx and use it while the file is unchanged\n\
+\n\
+With a single NAME and no file, read the standard input.\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+//read a file that can't be mapped, such as a pipe
+static char *read_all(FILE *fp, size_t *len)
+{
+    size_t got = 0, cap = 1 << 20;
+    char *buf = NULL, *tmp;
+
+    while (1) {
+        tmp = realloc(buf, cap);
+        if (tmp == NULL) {
+            free(buf);
+            return NULL;
+        }
+        buf = tmp;
+        got += fread(buf + got, 1, cap - got, fp);
+        if (got < cap)
+            break;
+        cap *= 2;
+    }
+    if (ferror(fp)) {
+        free(buf);
+        return NULL;
+    }
+    *len = got;
+    return buf;
+}
+
+static void print_buffer(const struct dsl_entry *e, const char *text)
+{
+    struct dsl_buffer buf;
+    const char *item;
+    size_t pos = 0, len;
+    int first = 1;
+
+    dsl_index_buffer(e, text, &buf);
+    while ((item = dsl_buffer_item(&buf, &pos, &len)) != NULL) {
+        printf("%s%.*s", first ? "" : ",", (int)len, item);
+        first = 0;
+    }
+    putchar('\n');
+}
+
+//use the saved index if it is for this version of the file, else build one and maybe save it
+static int get_index(struct dsl_index *idx, const char *path, int fd, const char *text,
+                     size_t len, int keep)
+{
+    char stamp[64], *idx_path = NULL, *tmp_path = NULL;
+    struct stat st;
+    FILE *fp;
+    int ret;
+
+    if (keep && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        snprintf(stamp, sizeof(stamp), "%" PRIu64 " %" PRId64 ".%09ld", (uint64_t)st.st_size,
+                 (int64_t)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+        idx_path = malloc(strlen(path) + 9);
+        tmp_path = malloc(strlen(path) + 9);
+        if (idx_path == NULL || tmp_path == NULL) {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        sprintf(idx_path, "%s.idx", path);
+        sprintf(tmp_path, "%s.idx.new", path);
+        if ((fp = fopen(idx_path, "r")) != NULL) {
+            ret = dsl_index_load(idx, fp, stamp, len);
+            fclose(fp);
+            if (ret == 0) {
+                free(idx_path);
+                free(tmp_path);
+                return 0;
+            }
+        }
+    }
+
+    if (dsl_index_build(idx, text, len)) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    //an index that can't be saved only costs a scan next time
+    if (idx_path) {
+        fp = fopen(tmp_path, "w");
+        if (fp == NULL || dsl_index_save(idx, fp, stamp) || fclose(fp) || rename(tmp_path, idx_path)) {
+            fprintf(stderr, "Warning: couldn't save the index as %s: %s\n", idx_path,
+                    strerror(errno));
+            unlink(tmp_path);
+        }
+    }
+    free(idx_path);
+    free(tmp_path);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct dsl_index idx;
+    struct mapping mapping;
+    const struct dsl_entry *e, *first;
+    const char *path = "-";
+    FILE *fp = stdin;
+    char *text;
+    size_t len;
+    uint32_t i, n;
+    int opt, list = 0, keep = 0, num_names, mapped, ret = EXIT_SUCCESS;
+
+    if (argc == 2 && !strcmp(argv[1], "--help"))
+        print_usage(argv[0]);
+    while ((opt = getopt(argc, argv, "lx")) != -1) {
+        switch (opt) {
+        case 'l':
+            list = 1;
+            break;
+        case 'x':
+            keep = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    num_names = argc - optind;
+    if (list ? num_names > 1 : num_names < 1)
+        print_usage(argv[0]);
+    //the file comes last, and is only optional after a single name
+    if (list ? num_names == 1 : num_names > 1) {
+        path = argv[argc - 1];
+        num_names--;
+    }
+
+    if (strcmp(path, "-")) {
+        fp = fopen(path, "rb");
+        if (fp == NULL) {
+            perror(path);
+            return EXIT_FAILURE;
+        }
+    }
+    mapped = map_input(fileno(fp), &mapping) == 0;
+    if (mapped) {
+        text = (char *)mapping.data;
+        len = mapping.len;
+    } else if ((text = read_all(fp, &len)) == NULL) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    get_index(&idx, path, fileno(fp), text, len, keep && mapped);
+
+    if (list) {
+        for (i = 0; i < idx.num_entries; i++) {
+            e = &idx.entries[i];
+            printf("%s\t%" PRIu32 "\t%" PRIu64 "\t", e->key, e->line, e->offset);
+            if (e->size < 0)
+                printf("-\n");
+            else
+                printf("%" PRId64 "\n", e->size);
+        }
+    }
+    for (i = 0; i < (uint32_t)num_names; i++) {
+        const char *name = argv[optind + i];
+
+        e = dsl_index_find(&idx, name);
+        if (e == NULL) {
+            fprintf(stderr, "No buffer %s\n", name);
+            ret = EXIT_FAILURE;
+        } else if (e->number) {
+            print_buffer(e, text);
+        } else {
+            for (n = 0, first = e; (e = dsl_index_nth(&idx, first, n)) != NULL; n++)
+                print_buffer(e, text);
+        }
+    }
+
+    if (fflush(stdout) || ferror(stdout)) {
+        perror("Error writing the output");
+        ret = EXIT_FAILURE;
+    }
+    dsl_index_free(&idx);
+    if (mapped)
+        unmap_input(&mapping);
+    else
+        free(text);
+    if (fp != stdin)
+        fclose(fp);
+    return ret;
+}
@@ -0,0 +1,469 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "aml.h"
+#include "bmof.h"
+#include "dslscan.h"
+#include "mapfile.h"
+#include "mof.h"
+#include "mofcache.h"
+
+/*
+ * wqdump: the wmixtract.py | hexxer | mofdecompress pipeline in one pass.
+ * Each input is mapped and scanned once; every WQxx buffer found is
+ * decoded from its hex straight into memory, decompressed, and written
+ * out as NAME.mof, numbered like wmixtract.py does when a name repeats
+ * (WQBA.mof, WQBA1.mof, ...).
+ *
+ * An input can also be the raw table itself, e.g. a copy of
+ * /sys/firmware/acpi/tables/DSDT, which needs no iasl at all: its buffers
+ * are found by walking the AML, and decompressed from where they lie in
+ * the mapped file.
+ */
+
+struct seen {
+    char name[8];
+    unsigned count;
+};
+
+struct options {
+    const char *out_dir; //NULL to write everything to the standard output
+    int list, keep_blob, write_table;
+    char **names;        //only these buffers, rather than every WQxx
+    int num_names;
+};
+
+struct state {
+    const struct options *opt;
+    const char *path;
+    struct mof_cache *cache; //NULL without -c
+    struct seen *seen;
+    size_t num_seen;
+    uint8_t *blob, *out;
+    size_t blob_cap, out_cap;
+    char *table;
+    unsigned found, failed;
+};
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-l] [-b] [-t] [-c cache] [-o dir|-] [-n name]... [file...]\n", prog_name);
+    fputs("\
+Find the WQxx buffers in ACPI tables and decompress the Binary MOF in each\n\
+of them, in a single pass. A file is either a disassembled table (iasl -d\n\
+output) or the DSDT or an SSDT itself, as in /sys/firmware/acpi/tables.\n\
+\n\
+\t-o dir\twrite NAME.mof for each buffer into dir (default .), created\n\
+\t\tif need be, or all of them to the standard output for -o -\n\
+\t-b\talso write the compressed blob, as NAME.bmf\n\
+\t-t\talso write the method table (GUID, class, WmiMethodId and name),\n\
+\t\tas NAME.tbl\n\
+\t-c cache\tkeep what each distinct blob decodes to in the directory\n\
+\t\tcache, and use it instead of decoding a blob seen before\n\
+\t-l\tonly list the buffers: file, line (byte offset in a table), name,\n\
+\t\tsize, expanded size\n\
+\t-n name\tonly the buffers with this name, which needn't start with WQ\n\
+\n\
+A name that occurs again is numbered: WQBA, WQBA1, WQBA2...\n\
+With no file, or when file is -, read the standard input.\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+//read a file that can't be mapped, such as a pipe
+static char *read_all(FILE *fp, size_t *len)
+{
+    size_t got = 0, cap = 1 << 20;
+    char *buf = NULL, *tmp;
+
+    while (1) {
+        tmp = realloc(buf, cap);
+        if (tmp == NULL) {
+            free(buf);
+            return NULL;
+        }
+        buf = tmp;
+        got += fread(buf + got, 1, cap - got, fp);
+        if (got < cap)
+            break;
+        cap *= 2;
+    }
+    if (ferror(fp)) {
+        free(buf);
+        return NULL;
+    }
+    *len = got;
+    return buf;
+}
+
+static int grow(uint8_t **buf, size_t *cap, size_t len)
+{
+    uint8_t *tmp;
+
+    if (len <= *cap)
+        return 0;
+    tmp = realloc(*buf, len);
+    if (tmp == NULL)
+        return -1;
+    *buf = tmp;
+    *cap = len;
+    return 0;
+}
+
+static int wanted(const struct options *opt, const char *leaf, size_t len)
+{
+    int i;
+
+    if (opt->num_names == 0)
+        return len == 4 && leaf[0] == 'W' && leaf[1] == 'Q';
+    for (i = 0; i < opt->num_names; i++)
+        if (strlen(opt->names[i]) == len && !strncasecmp(opt->names[i], leaf, len))
+            return 1;
+    return 0;
+}
+
+//how many times this name was seen before, as the suffix for its files
+static long number(struct state *st, const char *leaf, size_t len)
+{
+    struct seen *tmp;
+    size_t i;
+
+    for (i = 0; i < st->num_seen; i++)
+        if (!strncmp(st->seen[i].name, leaf, len) && st->seen[i].name[len] == '\0')
+            return st->seen[i].count++;
+    tmp = realloc(st->seen, (st->num_seen + 1) * sizeof(*tmp));
+    if (tmp == NULL)
+        return -1;
+    st->seen = tmp;
+    memcpy(tmp[i].name, leaf, len);
+    tmp[i].name[len] = '\0';
+    tmp[i].count = 1;
+    st->num_seen++;
+    return 0;
+}
+
+static int write_file(const char *path, const uint8_t *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL || fwrite(data, 1, len, fp) != len || fclose(fp)) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * What a blob decodes to: from the cache if it is there, else decompressed
+ * into st->out and, if the method table is wanted or is to be cached,
+ * parsed. Returns BMOF_OK or a negative error.
+ */
+static long decode(struct state *st, const uint8_t *blob, long len, const struct bmof_header *hdr,
+                   struct mof_cache_entry *entry)
+{
+    struct mof_file mof;
+    FILE *fp;
+    long ret;
+
+    memset(entry, 0, sizeof(*entry));
+    if (st->cache && mof_cache_get(st->cache, blob, len, entry))
+        return BMOF_OK;
+    if (grow(&st->out, &st->out_cap, (size_t)hdr->out_size + BMOF_OUT_SLACK))
+        return BMOF_ERR_NOMEM;
+    ret = bmof_decompress(blob, len, st->out, (size_t)hdr->out_size + BMOF_OUT_SLACK);
+    if (ret < 0)
+        return ret;
+    entry->mof = st->out;
+    entry->mof_len = ret;
+    if (!st->opt->write_table && st->cache == NULL)
+        return BMOF_OK;
+
+    entry->parse_error = mof_parse(st->out, ret, &mof);
+    if (entry->parse_error == BMOF_OK) {
+        free(st->table);
+        st->table = NULL;
+        fp = open_memstream(&st->table, &entry->table_len);
+        ret = fp ? mof_write_table(fp, &mof, NULL, NULL) : -1;
+        mof_free(&mof);
+        if (fp == NULL || fclose(fp) || ret)
+            return BMOF_ERR_NOMEM;
+        entry->table = st->table;
+    }
+    if (st->cache)
+        mof_cache_put(st->cache, blob, len, entry);
+    return BMOF_OK;
+}
+
+/*
+ * Number, decompress and write out one wanted buffer. where locates it in
+ * messages: its line in a .dsl file, its offset in a table. len is -1 for
+ * a buffer that isn't a list of bytes.
+ */
+static int extract(struct state *st, const char *leaf, size_t leaf_len, const char *where,
+                   const uint8_t *blob, long len)
+{
+    const struct options *opt = st->opt;
+    struct bmof_header hdr;
+    struct mof_cache_entry entry;
+    char name[32], path[PATH_MAX];
+    const char *err = NULL;
+    long n, ret = BMOF_OK;
+
+    st->found++;
+    if ((n = number(st, leaf, leaf_len)) < 0) {
+        perror("Error allocating memory");
+        return -1;
+    }
+    if (n)
+        snprintf(name, sizeof(name), "%.*s%ld", (int)leaf_len, leaf, n);
+    else
+        snprintf(name, sizeof(name), "%.*s", (int)leaf_len, leaf);
+
+    if (len < 0)
+        err = "not a list of bytes";
+    else if (bmof_read_header(blob, len, &hdr))
+        err = "not a Binary MOF blob";
+    if (opt->list) {
+        printf("%s\t%s\t%s\t%ld\t", st->path, where, name, len);
+        if (err)
+            printf("-\n");
+        else
+            printf("%lu\n", (unsigned long)hdr.out_size);
+        return 0;
+    }
+
+    if (opt->keep_blob && len >= 0) {
+        snprintf(path, sizeof(path), "%s/%s.bmf", opt->out_dir, name);
+        if (write_file(path, blob, len))
+            return -1;
+    }
+    if (err == NULL && (ret = decode(st, blob, len, &hdr, &entry)) < 0)
+        err = bmof_strerror(ret);
+    if (err) {
+        fprintf(stderr, "%s:%s: %s: %s\n", st->path, where, name, err);
+        st->failed++;
+        return 0;
+    }
+
+    if (opt->out_dir == NULL) {
+        ret = fwrite(entry.mof, 1, entry.mof_len, stdout) != entry.mof_len ? -1 : 0;
+    } else {
+        snprintf(path, sizeof(path), "%s/%s.mof", opt->out_dir, name);
+        ret = write_file(path, entry.mof, entry.mof_len);
+    }
+    if (ret == 0 && opt->write_table) {
+        if (entry.table) {
+            snprintf(path, sizeof(path), "%s/%s.tbl", opt->out_dir, name);
+            ret = write_file(path, (const uint8_t *)entry.table, entry.table_len);
+        } else {
+            fprintf(stderr, "%s:%s: %s: no method table: %s\n", st->path, where, name,
+                    bmof_strerror(entry.parse_error));
+            st->failed++;
+        }
+    }
+    return ret;
+}
+
+static int on_buffer(void *ctx, const struct dsl_buffer *buf)
+{
+    struct state *st = ctx;
+    char where[16];
+    const char *leaf;
+    size_t leaf_len;
+
+    leaf = dsl_leaf_name(buf, &leaf_len);
+    if (leaf_len > 4 || !wanted(st->opt, leaf, leaf_len))
+        return 0;
+    if (grow(&st->blob, &st->blob_cap, dsl_buffer_bound(buf))) {
+        perror("Error allocating memory");
+        return -1;
+    }
+    snprintf(where, sizeof(where), "%u", buf->line);
+    return extract(st, leaf, leaf_len, where, st->blob, dsl_buffer_decode(buf, st->blob));
+}
+
+//a buffer in a table, whose bytes are used where they are mapped
+static int on_table_buffer(void *ctx, const struct aml_buffer *buf)
+{
+    struct state *st = ctx;
+    char where[24];
+
+    if (!wanted(st->opt, buf->leaf, 4) || buf->len > LONG_MAX)
+        return 0;
+    snprintf(where, sizeof(where), "0x%zx", buf->offset);
+    return extract(st, buf->leaf, 4, where, buf->data, buf->len);
+}
+
+static int scan_file(struct state *st, const char *path)
+{
+    struct mapping mapping;
+    FILE *fp = stdin;
+    char *text;
+    size_t len;
+    int mapped, ret;
+
+    if (strcmp(path, "-")) {
+        fp = fopen(path, "rb");
+        if (fp == NULL) {
+            perror(path);
+            return -1;
+        }
+    }
+    mapped = map_input(fileno(fp), &mapping) == 0;
+    if (mapped) {
+        text = (char *)mapping.data;
+        len = mapping.len;
+    } else if ((text = read_all(fp, &len)) == NULL) {
+        perror(path);
+        if (fp != stdin)
+            fclose(fp);
+        return -1;
+    }
+
+    st->path = path;
+    if (aml_is_table((uint8_t *)text, len)) {
+        if (!aml_checksum_ok((uint8_t *)text))
+            fprintf(stderr, "%s: Warning: the table's checksum is wrong\n", path);
+        ret = aml_scan((uint8_t *)text, on_table_buffer, st);
+    } else {
+        ret = dsl_scan(text, len, on_buffer, st);
+    }
+
+    if (mapped)
+        unmap_input(&mapping);
+    else
+        free(text);
+    if (fp != stdin)
+        fclose(fp);
+    return ret;
+}
+
+//create path and its parents, as mkdir -p does; returns 0 or -1 with errno set
+static int make_dirs(const char *path)
+{
+    char dir[PATH_MAX], *p;
+
+    if (snprintf(dir, sizeof(dir), "%s", path) >= (int)sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    for (p = dir + 1; ; p++) {
+        if (*p != '/' && *p != '\0')
+            continue;
+        if (p[-1] != '/') {
+            char c = *p;
+
+            *p = '\0';
+            if (mkdir(dir, 0777) && errno != EEXIST)
+                return -1;
+            *p = c;
+        }
+        if (*p == '\0')
+            return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static char *stdin_only[] = { "-" };
+    struct options opt = { ".", 0, 0, 0, NULL, 0 };
+    struct mof_cache cache;
+    const char *cache_dir = NULL;
+    struct state st;
+    char **files;
+    int c, num_files, i, ret = EXIT_SUCCESS;
+
+    opt.names = calloc(argc, sizeof(*opt.names));
+    if (opt.names == NULL) {
+        perror("Error allocating memory");
+        return EXIT_FAILURE;
+    }
+    while ((c = getopt(argc, argv, "o:bltc:n:")) != -1) {
+        switch (c) {
+        case 'o':
+            opt.out_dir = strcmp(optarg, "-") ? optarg : NULL;
+            break;
+        case 'b':
+            opt.keep_blob = 1;
+            break;
+        case 'l':
+            opt.list = 1;
+            break;
+        case 't':
+            opt.write_table = 1;
+            break;
+        case 'c':
+            cache_dir = optarg;
+            break;
+        case 'n':
+            opt.names[opt.num_names++] = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if ((opt.keep_blob || opt.write_table) && opt.out_dir == NULL)
+        print_usage(argv[0]);
+    files = argv + optind;
+    num_files = argc - optind;
+    if (num_files == 0) {
+        if (isatty(fileno(stdin)))
+            print_usage(argv[0]);
+        files = stdin_only;
+        num_files = 1;
+    }
+    if (opt.out_dir == NULL && !opt.list && isatty(fileno(stdout))) {
+        fputs("Not writing Binary MOF data to a terminal\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    if (opt.out_dir && !opt.list && make_dirs(opt.out_dir)) {
+        perror(opt.out_dir);
+        free(opt.names);
+        return EXIT_FAILURE;
+    }
+
+    memset(&st, 0, sizeof(st));
+    st.opt = &opt;
+    if (cache_dir && !opt.list) {
+        if (make_dirs(cache_dir) || mof_cache_open(&cache, cache_dir)) {
+            perror(cache_dir);
+            free(opt.names);
+            return EXIT_FAILURE;
+        }
+        st.cache = &cache;
+    }
+    for (i = 0; i < num_files; i++)
+        if (scan_file(&st, files[i]))
+            ret = EXIT_FAILURE;
+    if (st.found == 0) {
+        fputs(opt.num_names ? "No buffer with that name found\n" : "No WQxx buffer found\n", stderr);
+        ret = EXIT_FAILURE;
+    } else if (st.failed) {
+        ret = EXIT_FAILURE;
+    }
+
+    if (st.cache) {
+        mof_cache_report(st.cache);
+        mof_cache_close(st.cache);
+    }
+
+    if (fflush(stdout) || ferror(stdout)) {
+        perror("Error writing the output");
+        ret = EXIT_FAILURE;
+    }
+    free(st.seen);
+    free(st.blob);
+    free(st.out);
+    free(st.table);
+    free(opt.names);
+    return ret;
+}
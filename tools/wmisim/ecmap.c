@@ -0,0 +1,153 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "ecmap.h"
+
+static char *read_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    char *text = NULL;
+    long size;
+
+    if (fp == NULL)
+        return NULL;
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0
+            && (text = malloc(size + 1)) != NULL) {
+        if (fread(text, 1, size, fp) == (size_t)size) {
+            text[size] = '\0';
+        } else {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(fp);
+    return text;
+}
+
+static char *skip_space(char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        s++;
+    return s;
+}
+
+//one "NAME, width, // byte 0xNN bit B comment" line; 1 if it is a field, 0 if not, -1 if malformed
+static int parse_line(char *line, struct ec_field *f)
+{
+    char *s = skip_space(line), *end;
+    size_t len = 0;
+
+    if (*s == '\0' || strncmp(s, "Offset", 6) == 0 || strncmp(s, "//", 2) == 0)
+        return 0;
+    while (isalnum((unsigned char)s[len]) || s[len] == '_')
+        len++;
+    if (len > 4)
+        return -1;
+    memcpy(f->name, s, len);
+    f->name[len] = '\0';
+    s = skip_space(s + len);
+    if (*s++ != ',')
+        return -1;
+    f->width = strtoul(s, &end, 0);
+    if (end == s || f->width == 0)
+        return -1;
+    s = skip_space(end);
+    if (*s++ != ',')
+        return -1;
+    s = skip_space(s);
+    if (strncmp(s, "//", 2))
+        return -1;
+    s = skip_space(s + 2);
+    if (strncmp(s, "byte", 4))
+        return -1;
+    f->offset = strtoul(s + 4, &end, 0);
+    s = skip_space(end);
+    if (strncmp(s, "bit", 3))
+        return -1;
+    f->bit = strtoul(s + 3, &end, 0);
+    if (f->offset > 0xFF || f->bit > 7 || f->offset * 8 + f->bit + f->width > 256 * 8)
+        return -1;
+    s = skip_space(end);
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    f->comment = s;
+    //the padding fields have no name
+    return len > 0;
+}
+
+int ec_map_load(struct ec_map *map, const char *path)
+{
+    char *line, *next;
+    size_t size = 0;
+    unsigned line_no = 0;
+    struct ec_field f, *tmp;
+    int n;
+
+    memset(map, 0, sizeof(*map));
+    map->text = read_file(path);
+    if (map->text == NULL) {
+        perror(path);
+        return -1;
+    }
+    for (line = map->text; line; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        line_no++;
+        n = parse_line(line, &f);
+        if (n < 0) {
+            fprintf(stderr, "%s:%u: not a field of the EC RAM\n", path, line_no);
+            ec_map_free(map);
+            return -1;
+        }
+        if (n == 0)
+            continue;
+        if (map->num == size) {
+            size = size ? 2 * size : 64;
+            tmp = realloc(map->fields, size * sizeof(*tmp));
+            if (tmp == NULL) {
+                perror("Error allocating memory");
+                ec_map_free(map);
+                return -1;
+            }
+            map->fields = tmp;
+        }
+        map->fields[map->num++] = f;
+    }
+    return 0;
+}
+
+void ec_map_free(struct ec_map *map)
+{
+    free(map->fields);
+    free(map->text);
+    memset(map, 0, sizeof(*map));
+}
+
+const struct ec_field *ec_map_find(const struct ec_map *map, const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < map->num; i++)
+        if (strcasecmp(map->fields[i].name, name) == 0)
+            return &map->fields[i];
+    return NULL;
+}
+
+const struct ec_field *ec_map_at(const struct ec_map *map, unsigned offset, unsigned bit)
+{
+    unsigned pos = offset * 8 + bit;
+    size_t i;
+
+    for (i = 0; i < map->num; i++) {
+        const struct ec_field *f = &map->fields[i];
+
+        if (pos >= f->offset * 8 + f->bit && pos < f->offset * 8 + f->bit + f->width)
+            return f;
+    }
+    return NULL;
+}
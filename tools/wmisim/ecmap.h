@@ -0,0 +1,40 @@
+#ifndef ECMAP_H
+#define ECMAP_H
+
+#include <stddef.h>
+
+/*
+ * The EC RAM layout, as written down in
+ * code-dump/clevo-wmi/Clevo_B7130-EC_RAM.txt: one field per line,
+ *
+ *     LIDS,    1,    // byte 0x03  bit 0  lid status, 0 = closed, 1 = open
+ *
+ * with the Offset () lines and the unnamed padding fields left out.
+ */
+
+struct ec_field {
+    char name[5];
+    unsigned offset;            //of the first byte
+    unsigned bit;               //of the first bit in that byte
+    unsigned width;             //in bits
+    const char *comment;        //"" if there is none
+};
+
+struct ec_map {
+    struct ec_field *fields;    //in the order of the file
+    size_t num;
+    char *text;                 //the file, which the comments point into
+};
+
+//returns 0, or -1 after printing what is wrong with the file
+int ec_map_load(struct ec_map *map, const char *path);
+
+void ec_map_free(struct ec_map *map);
+
+//the field called name, NULL if there is none
+const struct ec_field *ec_map_find(const struct ec_map *map, const char *name);
+
+//the field that bit (0-7) of the byte at offset belongs to, NULL if none
+const struct ec_field *ec_map_at(const struct ec_map *map, unsigned offset, unsigned bit);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef ACPI_BUTTON_H
+#define ACPI_BUTTON_H
+
+#include <linux/notifier.h>
+
+/* called with 1 when the lid opens, 0 when it closes (lid open|close) */
+int acpi_lid_notifier_register(struct notifier_block *nb);
+int acpi_lid_notifier_unregister(struct notifier_block *nb);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _LINUX_ACPI_H
+#define _LINUX_ACPI_H
+
+#include <linux/kernel.h>
+
+typedef u32 acpi_status;
+typedef u64 acpi_size;
+
+#define AE_OK		0x0000
+#define AE_ERROR	0x0001
+#define AE_NOT_FOUND	0x0005
+#define AE_NO_MEMORY	0x0004
+#define AE_ALREADY_ACQUIRED 0x0013
+
+#define ACPI_SUCCESS(s)	((s) == AE_OK)
+#define ACPI_FAILURE(s)	((s) != AE_OK)
+
+#define ACPI_ALLOCATE_BUFFER	((acpi_size)-1)
+
+#define ACPI_TYPE_INTEGER	0x01
+#define ACPI_TYPE_BUFFER	0x03
+
+struct acpi_buffer {
+	acpi_size length;
+	void *pointer;
+};
+
+union acpi_object {
+	u32 type;
+	struct {
+		u32 type;
+		u64 value;
+	} integer;
+};
+
+/* round trips to the firmware */
+int ec_read(u8 addr, u8 *val);
+int ec_write(u8 addr, u8 val);
+
+typedef void (*wmi_notify_handler)(u32 value, void *context);
+
+acpi_status wmi_evaluate_method(const char *guid, u8 instance, u32 method_id,
+				const struct acpi_buffer *in,
+				struct acpi_buffer *out);
+acpi_status wmi_install_notify_handler(const char *guid,
+				       wmi_notify_handler handler, void *data);
+acpi_status wmi_remove_notify_handler(const char *guid);
+bool wmi_has_guid(const char *guid);
+
+#endif
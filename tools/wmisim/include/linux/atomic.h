@@ -0,0 +1,42 @@
+#ifndef _LINUX_ATOMIC_H
+#define _LINUX_ATOMIC_H
+
+#include <linux/kernel.h>
+
+/* one thread, so plain integers will do */
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	long counter;
+} atomic_long_t;
+
+typedef struct {
+	s64 counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(i)		{ (i) }
+
+#define atomic_read(v)		((v)->counter)
+#define atomic_set(v, i)	((v)->counter = (i))
+#define atomic_inc(v)		((v)->counter++)
+#define atomic_dec(v)		((v)->counter--)
+#define atomic_add(i, v)	((v)->counter += (i))
+#define atomic_inc_return(v)	(++(v)->counter)
+#define atomic_xchg(v, i)	({ int __old = (v)->counter; (v)->counter = (i); __old; })
+#define atomic_cmpxchg(v, o, n) \
+	({ int __old = (v)->counter; if (__old == (o)) (v)->counter = (n); __old; })
+#define atomic_read_acquire(v)	atomic_read(v)
+#define atomic_set_release(v, i) atomic_set(v, i)
+
+#define atomic_long_read(v)	((v)->counter)
+#define atomic_long_set(v, i)	((v)->counter = (i))
+#define atomic_long_inc(v)	((v)->counter++)
+#define atomic_long_add(i, v)	((v)->counter += (i))
+
+#define atomic64_read(v)	((v)->counter)
+#define atomic64_set(v, i)	((v)->counter = (i))
+#define atomic64_add(i, v)	((v)->counter += (i))
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _LINUX_DELAY_H
+#define _LINUX_DELAY_H
+
+#include <linux/kernel.h>
+
+/* nothing else runs meanwhile, so there is nothing to wait for */
+static inline void msleep(unsigned int ms)
+{
+}
+
+static inline unsigned long msleep_interruptible(unsigned int ms)
+{
+	return 0;
+}
+
+static inline void udelay(unsigned long us)
+{
+}
+
+static inline void mdelay(unsigned long ms)
+{
+}
+
+#endif
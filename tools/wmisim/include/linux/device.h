@@ -0,0 +1,19 @@
+#ifndef _LINUX_DEVICE_H
+#define _LINUX_DEVICE_H
+
+#include <linux/kernel.h>
+
+struct device {
+	struct device *parent;
+	const char *init_name;
+};
+
+struct dev_pm_ops;
+
+struct device_driver {
+	const char *name;
+	struct module *owner;
+	const struct dev_pm_ops *pm;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _LINUX_DMI_H
+#define _LINUX_DMI_H
+
+#include <linux/kernel.h>
+
+enum dmi_field {
+	DMI_NONE,
+	DMI_SYS_VENDOR,
+	DMI_PRODUCT_NAME,
+	DMI_BOARD_VENDOR,
+	DMI_BOARD_NAME,
+};
+
+struct dmi_strmatch {
+	unsigned char slot;
+	char substr[79];
+};
+
+struct dmi_system_id {
+	int (*callback)(const struct dmi_system_id *);
+	const char *ident;
+	struct dmi_strmatch matches[4];
+	void *driver_data;
+};
+
+#define DMI_MATCH(a, b)	{ .slot = a, .substr = b }
+
+/* the simulated machine matches no table */
+static inline int dmi_check_system(const struct dmi_system_id *list)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _LINUX_FS_H
+#define _LINUX_FS_H
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <linux/kernel.h>
+
+typedef unsigned short umode_t;
+
+struct inode {
+	void *i_private;
+};
+
+struct file {
+	void *private_data;
+};
+
+struct file_operations {
+	struct module *owner;
+	int (*open)(struct inode *, struct file *);
+	ssize_t (*read)(struct file *, char *, size_t, loff_t *);
+	ssize_t (*write)(struct file *, const char *, size_t, loff_t *);
+	loff_t (*llseek)(struct file *, loff_t, int);
+	int (*release)(struct inode *, struct file *);
+};
+
+#endif
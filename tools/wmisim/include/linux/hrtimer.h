@@ -0,0 +1,46 @@
+#ifndef _LINUX_HRTIMER_H
+#define _LINUX_HRTIMER_H
+
+#include <linux/ktime.h>
+
+/*
+ * Like timer.h: hrtimers fire when a script waits past their expiry, at
+ * the soonest time they may, without the slack they were given.
+ */
+
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS = 0x00,
+	HRTIMER_MODE_REL = 0x01,
+};
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+#define CLOCK_MONOTONIC	1
+
+struct hrtimer {
+	ktime_t expires;
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+	bool armed;
+	struct hrtimer *sim_next;
+};
+
+void hrtimer_init(struct hrtimer *timer, int clock_id, enum hrtimer_mode mode);
+void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim, u64 range_ns,
+			    const enum hrtimer_mode mode);
+int hrtimer_cancel(struct hrtimer *timer);
+
+static inline void hrtimer_start(struct hrtimer *timer, ktime_t tim,
+				 const enum hrtimer_mode mode)
+{
+	hrtimer_start_range_ns(timer, tim, 0, mode);
+}
+
+static inline bool hrtimer_active(const struct hrtimer *timer)
+{
+	return timer->armed;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef _LINUX_INPUT_H
+#define _LINUX_INPUT_H
+
+#include <linux/device.h>
+#include <linux/bitops.h>
+
+#define EV_SYN		0x00
+#define EV_KEY		0x01
+#define EV_MSC		0x04
+#define EV_MAX		0x1f
+#define EV_CNT		(EV_MAX + 1)
+
+#define SYN_REPORT	0
+#define MSC_SCAN	0x04
+
+#define KEY_RESERVED	0
+#define KEY_MUTE	113
+#define KEY_CAMERA	212
+#define KEY_KBDILLUMTOGGLE 228
+#define KEY_KBDILLUMDOWN 229
+#define KEY_KBDILLUMUP	230
+#define KEY_BLUETOOTH	237
+#define KEY_WLAN	238
+#define KEY_WWAN	246
+#define KEY_RFKILL	247
+#define KEY_TOUCHPAD_ON	0x213
+#define KEY_TOUCHPAD_OFF 0x214
+#define KEY_MAX		0x2ff
+#define KEY_CNT		(KEY_MAX + 1)
+
+#define BUS_HOST	0x19
+
+struct input_id {
+	u16 bustype;
+	u16 vendor;
+	u16 product;
+	u16 version;
+};
+
+#define INPUT_KEYMAP_BY_INDEX	(1 << 0)
+
+struct input_keymap_entry {
+	u8 flags;
+	u8 len;
+	u16 index;
+	u32 keycode;
+	u8 scancode[32];
+};
+
+struct input_dev {
+	const char *name;
+	const char *phys;
+	struct input_id id;
+	unsigned long evbit[BITS_TO_LONGS(EV_CNT)];
+	unsigned long keybit[BITS_TO_LONGS(KEY_CNT)];
+	unsigned long mscbit[BITS_TO_LONGS(8)];
+	unsigned int keycodemax;
+	unsigned int keycodesize;
+	void *keycode;
+	int (*setkeycode)(struct input_dev *dev,
+			  const struct input_keymap_entry *ke,
+			  unsigned int *old_keycode);
+	int (*getkeycode)(struct input_dev *dev,
+			  struct input_keymap_entry *ke);
+	int (*open)(struct input_dev *dev);
+	void (*close)(struct input_dev *dev);
+	struct device dev;
+	unsigned int users;
+};
+
+struct input_dev *input_allocate_device(void);
+void input_free_device(struct input_dev *dev);
+int input_register_device(struct input_dev *dev);
+void input_unregister_device(struct input_dev *dev);
+void input_event(struct input_dev *dev, unsigned int type,
+		 unsigned int code, int value);
+
+static inline void input_report_key(struct input_dev *dev,
+				    unsigned int code, int value)
+{
+	input_event(dev, EV_KEY, code, !!value);
+}
+
+int input_scancode_to_scalar(const struct input_keymap_entry *ke,
+			     unsigned int *scancode);
+
+static inline void input_sync(struct input_dev *dev)
+{
+	input_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+#endif
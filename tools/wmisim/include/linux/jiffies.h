@@ -0,0 +1,22 @@
+#ifndef _LINUX_JIFFIES_H
+#define _LINUX_JIFFIES_H
+
+#include <linux/kernel.h>
+
+/*
+ * Time is the simulator's: it moves on by the latency of each round trip
+ * and by what a script waits, so a jiffy is a millisecond of that.
+ */
+#define HZ		1000
+
+unsigned long shim_jiffies(void);
+#define jiffies		shim_jiffies()
+
+#define msecs_to_jiffies(m)	((unsigned long)(m))
+#define usecs_to_jiffies(u)	((unsigned long)(((u) + 999) / 1000))
+#define jiffies_to_msecs(j)	((unsigned int)(j))
+
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+
+#endif
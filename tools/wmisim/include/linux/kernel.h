@@ -0,0 +1,107 @@
+#ifndef _LINUX_KERNEL_H
+#define _LINUX_KERNEL_H
+
+/*
+ * Just enough of the kernel's headers for src/clevo-wmi.c to build as
+ * part of wmisim. Everything runs on the one thread of the simulator.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <linux/slab.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define __init
+#define __exit
+#define __initdata
+#define __initconst
+#define __always_unused __attribute__((unused))
+
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+/* as the kernel's, they warn about arguments of different types */
+#define min(a, b) ({					\
+	typeof(a) _min1 = (a);				\
+	typeof(b) _min2 = (b);				\
+	(void) (&_min1 == &_min2);			\
+	_min1 < _min2 ? _min1 : _min2; })
+#define max(a, b) ({					\
+	typeof(a) _max1 = (a);				\
+	typeof(b) _max2 = (b);				\
+	(void) (&_max1 == &_max2);			\
+	_max1 > _max2 ? _max1 : _max2; })
+#define min_t(t, a, b)	min((t)(a), (t)(b))
+#define max_t(t, a, b)	max((t)(a), (t)(b))
+#define clamp_t(t, v, lo, hi) min_t(t, max_t(t, v, lo), hi)
+
+#define BIT(n)		(1UL << (n))
+
+#define READ_ONCE(x)		(*(volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, v)	(*(volatile typeof(x) *)&(x) = (v))
+
+#define MAX_ERRNO	4095
+#define IS_ERR_VALUE(x)	((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return IS_ERR_VALUE(ptr);
+}
+
+static inline bool IS_ERR_OR_NULL(const void *ptr)
+{
+	return !ptr || IS_ERR_VALUE(ptr);
+}
+
+static inline int PTR_RET(const void *ptr)
+{
+	return IS_ERR(ptr) ? PTR_ERR(ptr) : 0;
+}
+
+#define PTR_ERR_OR_ZERO PTR_RET
+
+#ifndef pr_fmt
+#define pr_fmt(fmt) fmt
+#endif
+
+#define printk(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_warn(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_notice(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_info(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_debug(fmt, ...)	do { if (0) printk(pr_fmt(fmt), ##__VA_ARGS__); } while (0)
+
+#include <linux/bitops.h>
+
+#define BUG()		__builtin_trap()
+#define BUG_ON(c)	do { if (c) BUG(); } while (0)
+#define WARN_ON(c)	({ bool __c = !!(c); if (__c) printk("WARNING at %s:%d\n", __FILE__, __LINE__); __c; })
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _LINUX_KTHREAD_H
+#define _LINUX_KTHREAD_H
+
+#include <linux/kernel.h>
+
+struct task_struct {
+	int pid;
+};
+
+/* there are no threads to run one on */
+#define kthread_run(fn, data, namefmt, ...) \
+	((struct task_struct *)ERR_PTR(-ENOSYS))
+
+static inline bool kthread_should_stop(void)
+{
+	return true;
+}
+
+static inline int kthread_stop(struct task_struct *k)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _LINUX_KTIME_H
+#define _LINUX_KTIME_H
+
+#include <linux/kernel.h>
+
+typedef s64 ktime_t;
+
+#define NSEC_PER_USEC	1000L
+#define NSEC_PER_MSEC	1000000L
+#define NSEC_PER_SEC	1000000000L
+
+/* the simulator's clock, see jiffies.h */
+ktime_t ktime_get(void);
+
+#define ktime_sub(a, b)		((a) - (b))
+#define ktime_add(a, b)		((a) + (b))
+#define ktime_add_ns(k, ns)	((k) + (ns))
+#define ktime_to_ns(k)		((s64)(k))
+#define ktime_to_us(k)		((s64)(k) / 1000)
+#define ktime_to_ms(k)		((s64)(k) / NSEC_PER_MSEC)
+#define ns_to_ktime(ns)		((ktime_t)(ns))
+#define ms_to_ktime(ms)		((ktime_t)(ms) * NSEC_PER_MSEC)
+
+#endif
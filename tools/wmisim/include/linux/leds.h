@@ -0,0 +1,26 @@
+#ifndef _LINUX_LEDS_H
+#define _LINUX_LEDS_H
+
+#include <linux/device.h>
+
+enum led_brightness {
+	LED_OFF		= 0,
+	LED_HALF	= 127,
+	LED_FULL	= 255,
+};
+
+struct led_classdev {
+	const char *name;
+	enum led_brightness brightness;
+	enum led_brightness max_brightness;
+	void (*brightness_set)(struct led_classdev *led_cdev,
+			       enum led_brightness brightness);
+	enum led_brightness (*brightness_get)(struct led_classdev *led_cdev);
+	struct device *dev;
+	struct led_classdev *sim_next;
+};
+
+int led_classdev_register(struct device *parent, struct led_classdev *led_cdev);
+void led_classdev_unregister(struct led_classdev *led_cdev);
+
+#endif
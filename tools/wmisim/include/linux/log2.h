@@ -0,0 +1,9 @@
+#ifndef _LINUX_LOG2_H
+#define _LINUX_LOG2_H
+
+#include <linux/kernel.h>
+
+/* for n > 0, as the kernel's */
+#define ilog2(n)	(63 - __builtin_clzll((unsigned long long)(n)))
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _LINUX_MODULE_H
+#define _LINUX_MODULE_H
+
+#include <linux/kernel.h>
+
+struct module;
+
+#define THIS_MODULE	((struct module *)NULL)
+
+/* the simulator loads the module by calling these */
+#define module_init(fn)	int (*const sim_module_init)(void) = fn
+#define module_exit(fn)	void (*const sim_module_exit)(void) = fn
+
+#define MODULE_AUTHOR(s)		extern int sim_modinfo
+#define MODULE_DESCRIPTION(s)		extern int sim_modinfo
+#define MODULE_LICENSE(s)		extern int sim_modinfo
+#define MODULE_VERSION(s)		extern int sim_modinfo
+#define MODULE_ALIAS(s)			extern int sim_modinfo
+#define MODULE_PARM_DESC(p, s)		extern int sim_modinfo
+#define MODULE_DEVICE_TABLE(t, n)	extern int sim_modinfo
+
+/* parameters keep their defaults */
+#define module_param(name, type, perm)	extern int sim_modinfo
+#define module_param_named(name, value, type, perm) extern int sim_modinfo
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _LINUX_MUTEX_H
+#define _LINUX_MUTEX_H
+
+#include <linux/kernel.h>
+
+/* one thread: a mutex only has to catch being taken twice */
+struct mutex {
+	bool locked;
+};
+
+#define __MUTEX_INITIALIZER(m)	{ false }
+#define DEFINE_MUTEX(m)	struct mutex m = __MUTEX_INITIALIZER(m)
+#define mutex_init(m)	((m)->locked = false)
+
+static inline void mutex_lock(struct mutex *m)
+{
+	BUG_ON(m->locked);
+	m->locked = true;
+}
+
+static inline void mutex_unlock(struct mutex *m)
+{
+	BUG_ON(!m->locked);
+	m->locked = false;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _LINUX_NOTIFIER_H
+#define _LINUX_NOTIFIER_H
+
+#include <linux/kernel.h>
+
+struct notifier_block;
+
+typedef int (*notifier_fn_t)(struct notifier_block *nb, unsigned long action,
+			     void *data);
+
+struct notifier_block {
+	notifier_fn_t notifier_call;
+	struct notifier_block *next;
+	int priority;
+};
+
+#define NOTIFY_DONE	0x0000
+#define NOTIFY_OK	0x0001
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _LINUX_PLATFORM_DEVICE_H
+#define _LINUX_PLATFORM_DEVICE_H
+
+#include <linux/device.h>
+
+typedef struct pm_message {
+	int event;
+} pm_message_t;
+
+struct resource;
+
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+};
+
+struct platform_driver {
+	int (*probe)(struct platform_device *);
+	int (*remove)(struct platform_device *);
+	void (*shutdown)(struct platform_device *);
+	int (*suspend)(struct platform_device *, pm_message_t state);
+	int (*resume)(struct platform_device *);
+	struct device_driver driver;
+};
+
+/* the device is created and probed there and then */
+struct platform_device *platform_create_bundle(struct platform_driver *driver,
+		int (*probe)(struct platform_device *),
+		struct resource *res, unsigned int n_res,
+		const void *data, size_t size);
+void platform_device_unregister(struct platform_device *pdev);
+void platform_driver_unregister(struct platform_driver *drv);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef _LINUX_SEQ_FILE_H
+#define _LINUX_SEQ_FILE_H
+
+#include <linux/fs.h>
+
+/* what is shown goes to the simulator's standard output */
+struct seq_file {
+	FILE *out;
+	void *private;
+	int (*show)(struct seq_file *m, void *v);
+};
+
+#define seq_printf(m, fmt, ...)	fprintf((m)->out, fmt, ##__VA_ARGS__)
+#define seq_puts(m, s)		fputs(s, (m)->out)
+#define seq_putc(m, c)		fputc(c, (m)->out)
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char *buf, size_t size, loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+
+#endif
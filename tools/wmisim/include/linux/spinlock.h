@@ -0,0 +1,32 @@
+#ifndef _LINUX_SPINLOCK_H
+#define _LINUX_SPINLOCK_H
+
+#include <linux/kernel.h>
+
+/* one thread, no interrupts: a spinlock only has to catch being taken twice */
+typedef struct {
+	bool locked;
+} spinlock_t;
+
+#define __SPIN_LOCK_UNLOCKED(l)	{ false }
+#define DEFINE_SPINLOCK(l)	spinlock_t l = __SPIN_LOCK_UNLOCKED(l)
+#define spin_lock_init(l)	((l)->locked = false)
+
+static inline void spin_lock(spinlock_t *l)
+{
+	BUG_ON(l->locked);
+	l->locked = true;
+}
+
+static inline void spin_unlock(spinlock_t *l)
+{
+	BUG_ON(!l->locked);
+	l->locked = false;
+}
+
+#define spin_lock_irqsave(l, flags) \
+	do { (flags) = 0; spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, flags) \
+	do { (void)(flags); spin_unlock(l); } while (0)
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _LINUX_TIMER_H
+#define _LINUX_TIMER_H
+
+#include <linux/jiffies.h>
+
+/*
+ * Timers fire when a script waits past their expiry (shim_advance()),
+ * each firing counted as a wakeup.
+ */
+
+struct timer_list {
+	unsigned long expires;
+	void (*function)(struct timer_list *timer);
+	bool armed;
+	struct timer_list *sim_next;
+};
+
+#define timer_setup(t, fn, flags) \
+	do { (t)->function = (fn); (t)->armed = false; (t)->sim_next = NULL; } while (0)
+
+#define from_timer(var, t, field) container_of(t, typeof(*var), field)
+
+void add_timer(struct timer_list *timer);
+int mod_timer(struct timer_list *timer, unsigned long expires);
+int del_timer(struct timer_list *timer);
+#define del_timer_sync(t)	del_timer(t)
+
+static inline int timer_pending(const struct timer_list *timer)
+{
+	return timer->armed;
+}
+
+#endif
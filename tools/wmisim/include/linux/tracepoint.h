@@ -0,0 +1,48 @@
+#ifndef _LINUX_TRACEPOINT_H
+#define _LINUX_TRACEPOINT_H
+
+#include <linux/kernel.h>
+
+/*
+ * TRACE_EVENT() makes trace_<event>(), which fills in the event's entry
+ * and prints it with TP_printk(), when wmisim -t asks for the driver's
+ * trace events.
+ */
+bool shim_tracing(void);
+void shim_trace(const char *event, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#define PARAMS(args...)			args
+#define TP_PROTO(args...)		args
+#define TP_ARGS(args...)		args
+#define TP_STRUCT__entry(args...)	args
+#define TP_fast_assign(args...)		args
+#define TP_printk(fmt, args...)		fmt, args
+
+#define __field(type, item)		type item;
+
+#define DECLARE_EVENT_CLASS(name, proto, args, tstruct, assign, print)	\
+	struct trace_event_raw_##name { tstruct };			\
+	static inline void trace_event_##name(const char *event, proto)	\
+	{								\
+		struct trace_event_raw_##name __e, *__entry = &__e;	\
+									\
+		if (!shim_tracing())					\
+			return;						\
+		assign							\
+		shim_trace(event, print);				\
+	}
+
+#define DEFINE_EVENT(template, name, proto, args)			\
+	static inline void trace_##name(proto)				\
+	{								\
+		trace_event_##template(#name, args);			\
+	}
+
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)		\
+	DECLARE_EVENT_CLASS(name, PARAMS(proto), PARAMS(args),		\
+	                    PARAMS(tstruct), PARAMS(assign),		\
+	                    PARAMS(print))				\
+	DEFINE_EVENT(name, name, PARAMS(proto), PARAMS(args))
+
+#endif
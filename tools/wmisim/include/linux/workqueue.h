@@ -0,0 +1,64 @@
+#ifndef _LINUX_WORKQUEUE_H
+#define _LINUX_WORKQUEUE_H
+
+#include <linux/kernel.h>
+#include <linux/timer.h>
+
+/*
+ * Work is queued, and run when the simulator drains the queues after
+ * each action, as a worker thread would get round to it: work queued
+ * again while it is still pending runs once.
+ */
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+	struct work_struct *next;
+	bool pending;
+};
+
+struct workqueue_struct;
+
+#define INIT_WORK(w, f) \
+	do { (w)->func = (f); (w)->next = NULL; (w)->pending = false; } while (0)
+
+/* delayed work is queued by a timer, see timer.h */
+struct delayed_work {
+	struct work_struct work;
+	struct timer_list timer;
+	struct workqueue_struct *wq;
+};
+
+void delayed_work_timer_fn(struct timer_list *timer);
+
+#define INIT_DELAYED_WORK(dw, f) \
+	do { \
+		INIT_WORK(&(dw)->work, f); \
+		timer_setup(&(dw)->timer, delayed_work_timer_fn, 0); \
+		(dw)->wq = NULL; \
+	} while (0)
+
+static inline struct delayed_work *to_delayed_work(struct work_struct *work)
+{
+	return container_of(work, struct delayed_work, work);
+}
+
+struct workqueue_struct *create_singlethread_workqueue(const char *name);
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags,
+					 int max_active, ...);
+void destroy_workqueue(struct workqueue_struct *wq);
+void flush_workqueue(struct workqueue_struct *wq);
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool schedule_work(struct work_struct *work);
+bool cancel_work_sync(struct work_struct *work);
+bool flush_work(struct work_struct *work);
+bool queue_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+			unsigned long delay);
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+		      unsigned long delay);
+bool cancel_delayed_work(struct delayed_work *dwork);
+bool cancel_delayed_work_sync(struct delayed_work *dwork);
+
+#endif
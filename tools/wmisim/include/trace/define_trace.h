@@ -0,0 +1,4 @@
+/*
+ * The kernel includes the trace header again here to define its events;
+ * the simulator's are all in <linux/tracepoint.h>.
+ */
@@ -0,0 +1,985 @@
+#include <dlfcn.h>
+#include <libgen.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <acpi/button.h>
+#include <linux/acpi.h>
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/input.h>
+#include <linux/input/sparse-keymap.h>
+#include <linux/ktime.h>
+#include <linux/leds.h>
+#include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/timer.h>
+#include <linux/tracepoint.h>
+#include <linux/workqueue.h>
+
+#include "shim.h"
+#include "sim.h"
+
+//the GUIDs of the Clevo WMI device
+#define EVENT_GUID "ABBC0F6B-8EA1-11D1-00A0-C90629100000"
+#define EMAIL_GUID "ABBC0F6C-8EA1-11D1-00A0-C90629100000"
+#define GET_GUID   "ABBC0F6D-8EA1-11D1-00A0-C90629100000"
+
+//the driver, built as a shared object next to wmisim
+#define MODULE_FILE "clevo-wmi.so"
+
+struct workqueue_struct {
+    const char *name;
+    struct work_struct *head, **tail;
+    struct workqueue_struct *next;
+};
+
+struct dentry {
+    char name[64];
+    struct dentry *parent;
+    const struct file_operations *fops;     //NULL for a directory
+    void *data;
+    struct dentry *next;
+};
+
+struct shim_counts shim_counts;
+
+static struct workqueue_struct system_wq = { "events", NULL, &system_wq.head, NULL };
+static struct workqueue_struct *workqueues = &system_wq;
+static struct led_classdev *leds;
+static struct input_dev *inputs[8];
+static struct platform_device *pdev;
+static struct platform_driver *pdrv;
+static wmi_notify_handler notify_handler;
+static void *notify_data;
+static struct dentry *dentries;
+static struct timer_list *timers;
+static struct hrtimer *hrtimers;
+static struct notifier_block *lid_notifiers;
+static void *module;
+
+/*
+ * The driver is loaded afresh each time, as insmod would, so that none of
+ * its static variables are left over from the last time.
+ */
+int shim_load(void)
+{
+    int (*const *init)(void);
+    char path[4096];
+    ssize_t len;
+    int err;
+
+    if (module)
+        return -EEXIST;
+    len = readlink("/proc/self/exe", path, sizeof(path) - sizeof(MODULE_FILE) - 1);
+    if (len < 0)
+        return -errno;
+    path[len] = '\0';
+    snprintf(path + strlen(dirname(path)), sizeof(MODULE_FILE) + 1, "/" MODULE_FILE);
+    module = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (module == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return -ENOENT;
+    }
+    //defined by module_init() in the driver
+    init = dlsym(module, "sim_module_init");
+    err = init ? (*init)() : -ENOEXEC;
+    if (err) {
+        dlclose(module);
+        module = NULL;
+    }
+    return err;
+}
+
+void shim_unload(void)
+{
+    void (*const *exit)(void);
+
+    if (module == NULL)
+        return;
+    exit = dlsym(module, "sim_module_exit");
+    if (exit)
+        (*exit)();
+    shim_run_work();
+    dlclose(module);
+    module = NULL;
+}
+
+//ec_read() and ec_write() as in drivers/acpi/ec.c
+
+int ec_read(u8 addr, u8 *val)
+{
+    return sim_ec_read(addr, val);
+}
+
+int ec_write(u8 addr, u8 val)
+{
+    return sim_ec_write(addr, val);
+}
+
+//WMI
+
+bool wmi_has_guid(const char *guid)
+{
+    return strcasecmp(guid, EVENT_GUID) == 0 || strcasecmp(guid, EMAIL_GUID) == 0
+        || strcasecmp(guid, GET_GUID) == 0;
+}
+
+acpi_status wmi_evaluate_method(const char *guid, u8 instance, u32 method_id,
+                                const struct acpi_buffer *in, struct acpi_buffer *out)
+{
+    union acpi_object *obj;
+    u32 arg = 0, result;
+
+    if (strcasecmp(guid, GET_GUID))
+        return AE_NOT_FOUND;
+    if (in && in->pointer)
+        memcpy(&arg, in->pointer, in->length < sizeof(arg) ? in->length : sizeof(arg));
+    if (sim_wmbb(method_id, arg, &result))
+        return AE_ERROR;
+    if (out == NULL)
+        return AE_OK;
+    if (out->length != ACPI_ALLOCATE_BUFFER)
+        return AE_ERROR;
+    obj = malloc(sizeof(*obj));
+    if (obj == NULL)
+        return AE_NO_MEMORY;
+    obj->integer.type = ACPI_TYPE_INTEGER;
+    obj->integer.value = result;
+    out->pointer = obj;
+    out->length = sizeof(*obj);
+    return AE_OK;
+}
+
+acpi_status wmi_install_notify_handler(const char *guid, wmi_notify_handler handler, void *data)
+{
+    if (strcasecmp(guid, EVENT_GUID))
+        return AE_NOT_FOUND;
+    if (notify_handler)
+        return AE_ALREADY_ACQUIRED;
+    notify_handler = handler;
+    notify_data = data;
+    return AE_OK;
+}
+
+acpi_status wmi_remove_notify_handler(const char *guid)
+{
+    if (strcasecmp(guid, EVENT_GUID) || notify_handler == NULL)
+        return AE_NOT_FOUND;
+    notify_handler = NULL;
+    return AE_OK;
+}
+
+void shim_notify(unsigned value)
+{
+    //as the WMI core does, drop an event nobody listens to
+    if (notify_handler)
+        notify_handler(value, notify_data);
+    else if (sim.verbose)
+        fprintf(stderr, "  notify    0x%02X: no handler\n", value);
+}
+
+//trace events
+
+bool shim_tracing(void)
+{
+    return sim.trace;
+}
+
+void shim_trace(const char *event, const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "  trace     %s: ", event);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+//workqueues
+
+static struct workqueue_struct *new_workqueue(const char *name)
+{
+    struct workqueue_struct *wq = calloc(1, sizeof(*wq));
+
+    if (wq == NULL)
+        return NULL;
+    wq->name = name;
+    wq->tail = &wq->head;
+    wq->next = workqueues;
+    workqueues = wq;
+    return wq;
+}
+
+struct workqueue_struct *create_singlethread_workqueue(const char *name)
+{
+    return new_workqueue(name);
+}
+
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags, int max_active, ...)
+{
+    return new_workqueue(fmt);
+}
+
+//run wq's work, including any queued while it runs; returns how many ran
+static unsigned run_queue(struct workqueue_struct *wq)
+{
+    struct work_struct *work;
+    unsigned n = 0;
+
+    while ((work = wq->head) != NULL) {
+        wq->head = work->next;
+        if (wq->head == NULL)
+            wq->tail = &wq->head;
+        work->next = NULL;
+        work->pending = false;
+        work->func(work);
+        n++;
+    }
+    return n;
+}
+
+void shim_run_work(void)
+{
+    struct workqueue_struct *wq;
+    unsigned n;
+
+    do {
+        n = 0;
+        for (wq = workqueues; wq; wq = wq->next)
+            n += run_queue(wq);
+    } while (n);
+}
+
+void flush_workqueue(struct workqueue_struct *wq)
+{
+    run_queue(wq);
+}
+
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+    struct workqueue_struct **p;
+
+    run_queue(wq);
+    for (p = &workqueues; *p; p = &(*p)->next) {
+        if (*p == wq) {
+            *p = wq->next;
+            break;
+        }
+    }
+    free(wq);
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+    if (work->pending)
+        return false;
+    work->pending = true;
+    work->next = NULL;
+    *wq->tail = work;
+    wq->tail = &work->next;
+    return true;
+}
+
+bool schedule_work(struct work_struct *work)
+{
+    return queue_work(&system_wq, work);
+}
+
+//take work off whichever queue it is on; whether it was there
+static bool unqueue(struct work_struct *work)
+{
+    struct workqueue_struct *wq;
+    struct work_struct **p;
+
+    if (!work->pending)
+        return false;
+    for (wq = workqueues; wq; wq = wq->next) {
+        for (p = &wq->head; *p; p = &(*p)->next) {
+            if (*p != work)
+                continue;
+            *p = work->next;
+            if (wq->tail == &work->next)
+                wq->tail = p;
+            work->next = NULL;
+            work->pending = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+    return unqueue(work);
+}
+
+bool flush_work(struct work_struct *work)
+{
+    if (!unqueue(work))
+        return false;
+    work->func(work);
+    return true;
+}
+
+void delayed_work_timer_fn(struct timer_list *timer)
+{
+    struct delayed_work *dwork = container_of(timer, struct delayed_work, timer);
+
+    queue_work(dwork->wq, &dwork->work);
+}
+
+bool queue_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+                        unsigned long delay)
+{
+    if (dwork->work.pending || timer_pending(&dwork->timer))
+        return false;
+    dwork->wq = wq;
+    if (delay == 0)
+        return queue_work(wq, &dwork->work);
+    mod_timer(&dwork->timer, jiffies + delay);
+    return true;
+}
+
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+                      unsigned long delay)
+{
+    bool pending = cancel_delayed_work(dwork);
+
+    queue_delayed_work(wq, dwork, delay);
+    return pending;
+}
+
+bool cancel_delayed_work(struct delayed_work *dwork)
+{
+    bool timer = del_timer(&dwork->timer);
+
+    return unqueue(&dwork->work) || timer;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+    return cancel_delayed_work(dwork);
+}
+
+//time and timers
+
+ktime_t ktime_get(void)
+{
+    return sim.clock_ns;
+}
+
+unsigned long shim_jiffies(void)
+{
+    return sim.clock_ns / (1000000000 / HZ);
+}
+
+void add_timer(struct timer_list *timer)
+{
+    mod_timer(timer, timer->expires);
+}
+
+int mod_timer(struct timer_list *timer, unsigned long expires)
+{
+    int pending = del_timer(timer);
+
+    timer->expires = expires;
+    timer->armed = true;
+    timer->sim_next = timers;
+    timers = timer;
+    return pending;
+}
+
+int del_timer(struct timer_list *timer)
+{
+    struct timer_list **p;
+
+    if (!timer->armed)
+        return 0;
+    for (p = &timers; *p; p = &(*p)->sim_next) {
+        if (*p == timer) {
+            *p = timer->sim_next;
+            break;
+        }
+    }
+    timer->armed = false;
+    timer->sim_next = NULL;
+    return 1;
+}
+
+void hrtimer_init(struct hrtimer *timer, int clock_id, enum hrtimer_mode mode)
+{
+    memset(timer, 0, sizeof(*timer));
+}
+
+void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim, u64 range_ns,
+                            const enum hrtimer_mode mode)
+{
+    hrtimer_cancel(timer);
+    timer->expires = mode == HRTIMER_MODE_REL ? ktime_add(ktime_get(), tim) : tim;
+    timer->armed = true;
+    timer->sim_next = hrtimers;
+    hrtimers = timer;
+}
+
+int hrtimer_cancel(struct hrtimer *timer)
+{
+    struct hrtimer **p;
+
+    if (!timer->armed)
+        return 0;
+    for (p = &hrtimers; *p; p = &(*p)->sim_next) {
+        if (*p == timer) {
+            *p = timer->sim_next;
+            break;
+        }
+    }
+    timer->armed = false;
+    timer->sim_next = NULL;
+    return 1;
+}
+
+//the armed timer that expires first, and when, in ns; NULLs if there is none
+static void next_timer(struct timer_list **timer, struct hrtimer **hrtimer, uint64_t *when)
+{
+    struct timer_list *t;
+    struct hrtimer *h;
+    uint64_t ns;
+
+    *timer = NULL;
+    *hrtimer = NULL;
+    *when = UINT64_MAX;
+    for (t = timers; t; t = t->sim_next) {
+        ns = (uint64_t)t->expires * (1000000000 / HZ);
+        if (ns < *when) {
+            *timer = t;
+            *when = ns;
+        }
+    }
+    for (h = hrtimers; h; h = h->sim_next) {
+        if ((uint64_t)h->expires < *when) {
+            *timer = NULL;
+            *hrtimer = h;
+            *when = h->expires;
+        }
+    }
+}
+
+void shim_advance(unsigned ms)
+{
+    uint64_t end = sim.clock_ns + ms * 1000000ULL, when;
+    struct timer_list *t;
+    struct hrtimer *h;
+
+    shim_run_work();
+    for (;;) {
+        next_timer(&t, &h, &when);
+        if ((t == NULL && h == NULL) || when > end)
+            break;
+        if (when > sim.clock_ns)
+            sim.clock_ns = when;
+        shim_counts.wakeups++;
+        if (sim.verbose)
+            fprintf(stderr, "  timer     %llu.%03llu ms\n", (unsigned long long)when / 1000000,
+                    (unsigned long long)when / 1000 % 1000);
+        if (t) {
+            del_timer(t);
+            t->function(t);
+        } else {
+            hrtimer_cancel(h);
+            if (h->function(h) == HRTIMER_RESTART)
+                hrtimer_start(h, h->expires, HRTIMER_MODE_ABS);
+        }
+        shim_run_work();
+    }
+    if (end > sim.clock_ns)
+        sim.clock_ns = end;
+}
+
+//the lid, as drivers/acpi/button.c reports it
+
+int acpi_lid_notifier_register(struct notifier_block *nb)
+{
+    nb->next = lid_notifiers;
+    lid_notifiers = nb;
+    return 0;
+}
+
+int acpi_lid_notifier_unregister(struct notifier_block *nb)
+{
+    struct notifier_block **p;
+
+    for (p = &lid_notifiers; *p; p = &(*p)->next) {
+        if (*p == nb) {
+            *p = nb->next;
+            return 0;
+        }
+    }
+    return -ENOENT;
+}
+
+void shim_lid(bool open)
+{
+    struct notifier_block *nb;
+
+    for (nb = lid_notifiers; nb; nb = nb->next)
+        nb->notifier_call(nb, open, NULL);
+}
+
+//LEDs
+
+static struct device led_dev;
+
+int led_classdev_register(struct device *parent, struct led_classdev *led_cdev)
+{
+    led_cdev->dev = &led_dev;
+    led_cdev->sim_next = leds;
+    leds = led_cdev;
+    return 0;
+}
+
+void led_classdev_unregister(struct led_classdev *led_cdev)
+{
+    struct led_classdev **p;
+
+    for (p = &leds; *p; p = &(*p)->sim_next) {
+        if (*p == led_cdev) {
+            *p = led_cdev->sim_next;
+            break;
+        }
+    }
+    led_cdev->dev = NULL;
+}
+
+static struct led_classdev *find_led(const char *name)
+{
+    struct led_classdev *led;
+
+    for (led = leds; led; led = led->sim_next)
+        if (strcmp(led->name, name) == 0)
+            return led;
+    return NULL;
+}
+
+int shim_led_set(const char *name, int value)
+{
+    struct led_classdev *led = find_led(name);
+
+    if (led == NULL)
+        return -ENODEV;
+    if (value > (int)led->max_brightness)
+        value = led->max_brightness;
+    led->brightness = value;
+    led->brightness_set(led, value);
+    return 0;
+}
+
+int shim_led_get(const char *name, int *value)
+{
+    struct led_classdev *led = find_led(name);
+
+    if (led == NULL)
+        return -ENODEV;
+    if (led->brightness_get)
+        led->brightness = led->brightness_get(led);
+    *value = led->brightness;
+    return 0;
+}
+
+//input devices
+
+struct input_dev *input_allocate_device(void)
+{
+    return calloc(1, sizeof(struct input_dev));
+}
+
+void input_free_device(struct input_dev *dev)
+{
+    if (dev)
+        free(dev->keycode);
+    free(dev);
+}
+
+int input_register_device(struct input_dev *dev)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(inputs); i++) {
+        if (inputs[i] == NULL) {
+            inputs[i] = dev;
+            return 0;
+        }
+    }
+    return -ENOMEM;
+}
+
+void input_unregister_device(struct input_dev *dev)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(inputs); i++) {
+        if (inputs[i] == dev) {
+            if (dev->users && dev->close)
+                dev->close(dev);
+            inputs[i] = NULL;
+        }
+    }
+    input_free_device(dev);
+}
+
+void input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value)
+{
+    if (type == EV_KEY && value)
+        shim_counts.keys++;
+    else if (type == EV_SYN && code == SYN_REPORT)
+        shim_counts.syncs++;
+    if (sim.verbose && (type == EV_KEY || type == EV_SYN))
+        fprintf(stderr, "  input     %s %u %d\n", type == EV_KEY ? "key" : "sync", code, value);
+}
+
+int input_scancode_to_scalar(const struct input_keymap_entry *ke, unsigned int *scancode)
+{
+    switch (ke->len) {
+    case 1:
+        *scancode = *(const u8 *)ke->scancode;
+        break;
+    case 2:
+        *scancode = *(const u16 *)ke->scancode;
+        break;
+    case 4:
+        *scancode = *(const u32 *)ke->scancode;
+        break;
+    default:
+        return -EINVAL;
+    }
+    return 0;
+}
+
+//as EVIOCSKEYCODE would
+int shim_setkeycode(unsigned scancode, unsigned keycode)
+{
+    struct input_keymap_entry ke = { .len = sizeof(u32), .keycode = keycode };
+    unsigned int old;
+    size_t i;
+    int err = -ENODEV;
+
+    memcpy(ke.scancode, &scancode, sizeof(u32));
+    for (i = 0; i < ARRAY_SIZE(inputs); i++) {
+        if (inputs[i] == NULL || inputs[i]->setkeycode == NULL)
+            continue;
+        err = inputs[i]->setkeycode(inputs[i], &ke, &old);
+        if (err)
+            return err;
+        if (sim.verbose)
+            fprintf(stderr, "  keymap    0x%02X: %u -> %u\n", scancode, old, keycode);
+    }
+    return err;
+}
+
+//sparse keymaps, as in drivers/input/sparse-keymap.c
+
+struct key_entry *sparse_keymap_entry_from_scancode(struct input_dev *dev, unsigned int code)
+{
+    struct key_entry *key;
+
+    for (key = dev->keycode; key->type != KE_END; key++)
+        if (code == key->code)
+            return key;
+    return NULL;
+}
+
+struct key_entry *sparse_keymap_entry_from_keycode(struct input_dev *dev, unsigned int keycode)
+{
+    struct key_entry *key;
+
+    for (key = dev->keycode; key->type != KE_END; key++)
+        if (key->type == KE_KEY && keycode == key->keycode)
+            return key;
+    return NULL;
+}
+
+static struct key_entry *sparse_keymap_locate(struct input_dev *dev,
+                                              const struct input_keymap_entry *ke)
+{
+    unsigned int scancode;
+
+    if (ke->flags & INPUT_KEYMAP_BY_INDEX)
+        return ke->index < dev->keycodemax ? (struct key_entry *)dev->keycode + ke->index : NULL;
+    if (input_scancode_to_scalar(ke, &scancode))
+        return NULL;
+    return sparse_keymap_entry_from_scancode(dev, scancode);
+}
+
+static int sparse_keymap_getkeycode(struct input_dev *dev, struct input_keymap_entry *ke)
+{
+    const struct key_entry *key = sparse_keymap_locate(dev, ke);
+
+    if (key == NULL || key->type != KE_KEY)
+        return -EINVAL;
+    ke->keycode = key->keycode;
+    return 0;
+}
+
+static int sparse_keymap_setkeycode(struct input_dev *dev, const struct input_keymap_entry *ke,
+                                    unsigned int *old_keycode)
+{
+    struct key_entry *key = sparse_keymap_locate(dev, ke);
+
+    if (key == NULL || key->type != KE_KEY || ke->keycode > KEY_MAX)
+        return -EINVAL;
+    *old_keycode = key->keycode;
+    key->keycode = ke->keycode;
+    set_bit(ke->keycode, dev->keybit);
+    if (!sparse_keymap_entry_from_keycode(dev, *old_keycode))
+        clear_bit(*old_keycode, dev->keybit);
+    return 0;
+}
+
+int sparse_keymap_setup(struct input_dev *dev, const struct key_entry *keymap,
+                        int (*setup)(struct input_dev *, struct key_entry *))
+{
+    struct key_entry *map;
+    size_t n = 0, i;
+    int err;
+
+    while (keymap[n].type != KE_END)
+        n++;
+    map = calloc(n + 1, sizeof(*map));
+    if (map == NULL)
+        return -ENOMEM;
+    memcpy(map, keymap, (n + 1) * sizeof(*map));
+    for (i = 0; i < n; i++) {
+        if (setup && (err = setup(dev, &map[i])) != 0) {
+            free(map);
+            return err;
+        }
+        if (map[i].type == KE_KEY) {
+            set_bit(EV_KEY, dev->evbit);
+            set_bit(map[i].keycode, dev->keybit);
+        }
+    }
+    set_bit(EV_MSC, dev->evbit);
+    set_bit(MSC_SCAN, dev->mscbit);
+    dev->keycode = map;
+    dev->keycodemax = n;
+    dev->keycodesize = sizeof(*map);
+    dev->getkeycode = sparse_keymap_getkeycode;
+    dev->setkeycode = sparse_keymap_setkeycode;
+    return 0;
+}
+
+int shim_input_open(void)
+{
+    size_t i;
+    int err;
+
+    for (i = 0; i < ARRAY_SIZE(inputs); i++) {
+        if (inputs[i] == NULL || inputs[i]->users++)
+            continue;
+        if (inputs[i]->open && (err = inputs[i]->open(inputs[i])) != 0) {
+            inputs[i]->users = 0;
+            return err;
+        }
+    }
+    return 0;
+}
+
+void shim_input_close(void)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(inputs); i++)
+        if (inputs[i] && inputs[i]->users && --inputs[i]->users == 0 && inputs[i]->close)
+            inputs[i]->close(inputs[i]);
+}
+
+//the platform device
+
+struct platform_device *platform_create_bundle(struct platform_driver *driver,
+        int (*probe)(struct platform_device *), struct resource *res, unsigned int n_res,
+        const void *data, size_t size)
+{
+    struct platform_device *dev = calloc(1, sizeof(*dev));
+    int err;
+
+    if (dev == NULL)
+        return ERR_PTR(-ENOMEM);
+    dev->name = driver->driver.name;
+    dev->id = -1;
+    err = probe(dev);
+    if (err) {
+        free(dev);
+        return ERR_PTR(err);
+    }
+    pdev = dev;
+    pdrv = driver;
+    return dev;
+}
+
+void platform_device_unregister(struct platform_device *dev)
+{
+    if (dev == NULL || dev != pdev)
+        return;
+    if (pdrv && pdrv->remove)
+        pdrv->remove(dev);
+    free(dev);
+    pdev = NULL;
+}
+
+void platform_driver_unregister(struct platform_driver *drv)
+{
+    if (drv == pdrv)
+        pdrv = NULL;
+}
+
+int shim_suspend(void)
+{
+    pm_message_t state = { 0 };
+
+    if (pdev == NULL || pdrv == NULL)
+        return -ENODEV;
+    return pdrv->suspend ? pdrv->suspend(pdev, state) : 0;
+}
+
+int shim_resume(void)
+{
+    if (pdev == NULL || pdrv == NULL)
+        return -ENODEV;
+    return pdrv->resume ? pdrv->resume(pdev) : 0;
+}
+
+//debugfs
+
+static struct dentry *new_dentry(const char *name, struct dentry *parent,
+                                 const struct file_operations *fops, void *data)
+{
+    struct dentry *d = calloc(1, sizeof(*d));
+
+    if (d == NULL)
+        return ERR_PTR(-ENOMEM);
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    d->parent = parent;
+    d->fops = fops;
+    d->data = data;
+    d->next = dentries;
+    dentries = d;
+    return d;
+}
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+    return new_dentry(name, parent, NULL, NULL);
+}
+
+struct dentry *debugfs_create_file(const char *name, umode_t mode, struct dentry *parent,
+                                   void *data, const struct file_operations *fops)
+{
+    return new_dentry(name, parent, fops, data);
+}
+
+static bool below(const struct dentry *d, const struct dentry *dir)
+{
+    for (; d; d = d->parent)
+        if (d == dir)
+            return true;
+    return false;
+}
+
+void debugfs_remove_recursive(struct dentry *dentry)
+{
+    struct dentry **p = &dentries, *d;
+
+    if (IS_ERR_OR_NULL(dentry))
+        return;
+    //children come before their parents in the list
+    while ((d = *p) != NULL) {
+        if (below(d, dentry)) {
+            *p = d->next;
+            free(d);
+        } else {
+            p = &d->next;
+        }
+    }
+}
+
+//"dir/file", as it would be under /sys/kernel/debug
+static void dentry_path(const struct dentry *d, char *buf, size_t size)
+{
+    size_t len;
+
+    buf[0] = '\0';
+    if (d->parent) {
+        dentry_path(d->parent, buf, size);
+        len = strlen(buf);
+        snprintf(buf + len, size - len, "/");
+    }
+    len = strlen(buf);
+    snprintf(buf + len, size - len, "%s", d->name);
+}
+
+static struct dentry *lookup(const char *path)
+{
+    struct dentry *d;
+    char buf[256];
+
+    for (d = dentries; d; d = d->next) {
+        dentry_path(d, buf, sizeof(buf));
+        if (strcmp(buf, path) == 0)
+            return d;
+    }
+    return NULL;
+}
+
+int shim_debugfs_read(const char *path)
+{
+    struct dentry *d = lookup(path);
+    struct inode inode;
+    struct file file = { NULL };
+    struct seq_file *m;
+    int err;
+
+    if (d == NULL || d->fops == NULL || d->fops->open == NULL)
+        return -ENOENT;
+    inode.i_private = d->data;
+    err = d->fops->open(&inode, &file);
+    if (err)
+        return err;
+    m = file.private_data;
+    err = m->show(m, NULL);
+    if (d->fops->release)
+        d->fops->release(&inode, &file);
+    return err;
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data)
+{
+    struct seq_file *m = calloc(1, sizeof(*m));
+
+    if (m == NULL)
+        return -ENOMEM;
+    m->out = stdout;
+    m->private = data;
+    m->show = show;
+    file->private_data = m;
+    return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+    free(file->private_data);
+    file->private_data = NULL;
+    return 0;
+}
+
+//the simulator calls show() itself, see shim_debugfs_read()
+ssize_t seq_read(struct file *file, char *buf, size_t size, loff_t *ppos)
+{
+    return -EINVAL;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+    return -EINVAL;
+}
@@ -0,0 +1,57 @@
+#ifndef SHIM_H
+#define SHIM_H
+
+#include <stdbool.h>
+
+/*
+ * The kernel side of wmisim (kernel.c) as the simulator drives it: the
+ * driver is loaded and unloaded, and the user's actions come in through
+ * what it registered, the way sysfs, evdev or the PM core would call it.
+ */
+
+//what the driver reported on its input devices
+struct shim_counts {
+    unsigned long keys;             //key presses
+    unsigned long syncs;            //input_sync() calls
+    unsigned long wakeups;          //timers fired
+};
+
+extern struct shim_counts shim_counts;
+
+//call the module's init function; returns what it returned
+int shim_load(void);
+
+//call its exit function
+void shim_unload(void);
+
+//run every pending work item, including ones queued meanwhile
+void shim_run_work(void);
+
+//let ms of simulated time pass, firing the timers that expire meanwhile
+void shim_advance(unsigned ms);
+
+//open or close the lid, calling the lid notifiers
+void shim_lid(bool open);
+
+//write and read an LED's brightness as sysfs would; -ENODEV if no such LED
+int shim_led_set(const char *name, int value);
+int shim_led_get(const char *name, int *value);
+
+//open or close every input device the driver registered, as evdev would
+int shim_input_open(void);
+void shim_input_close(void);
+
+//remap a scancode on every input device that has a keymap, as EVIOCSKEYCODE would
+int shim_setkeycode(unsigned scancode, unsigned keycode);
+
+//suspend or resume the platform device; returns what the driver returned
+int shim_suspend(void);
+int shim_resume(void);
+
+//deliver a WMI event to the handler for the event GUID, if there is one
+void shim_notify(unsigned value);
+
+//print a debugfs file, "clevo_wmi/stats" say, to standard output
+int shim_debugfs_read(const char *path);
+
+#endif
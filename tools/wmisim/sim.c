@@ -0,0 +1,250 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "clevo-wmbb.h"
+#include "sim.h"
+
+struct sim sim;
+
+int sim_init(const char *ec_map_path)
+{
+    unsigned i;
+
+    memset(&sim, 0, sizeof(sim));
+    if (ec_map_load(&sim.map, ec_map_path))
+        return -1;
+    for (i = 0; i < WMBB_NUM_IDS; i++)
+        sim.wmbb[wmbb_ids[i]].action = WMBB_CONST;
+    return 0;
+}
+
+void sim_exit(void)
+{
+    ec_map_free(&sim.map);
+}
+
+//busy wait rather than sleep: the latencies are a few microseconds
+static void wait_us(unsigned us)
+{
+    struct timespec start, now;
+
+    sim.firmware_us += us;
+    sim.clock_ns += us * 1000ULL;
+    if (us == 0)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000 < us);
+}
+
+static const char *field_name(unsigned offset)
+{
+    const struct ec_field *f = ec_map_at(&sim.map, offset, 0);
+
+    return f ? f->name : "";
+}
+
+static uint32_t field_get(const struct ec_field *f)
+{
+    unsigned pos = f->offset * 8 + f->bit, i;
+    uint32_t v = 0;
+
+    for (i = 0; i < f->width && i < 32; i++, pos++)
+        v |= (uint32_t)(sim.ec[pos / 8] >> pos % 8 & 1) << i;
+    return v;
+}
+
+static void field_set(const struct ec_field *f, uint32_t v)
+{
+    unsigned pos = f->offset * 8 + f->bit, i;
+
+    for (i = 0; i < f->width; i++, pos++) {
+        sim.ec[pos / 8] &= ~(1 << pos % 8);
+        if (i < 32 && v >> i & 1)
+            sim.ec[pos / 8] |= 1 << pos % 8;
+    }
+}
+
+int sim_ec_poke(const char *field, uint32_t value)
+{
+    const struct ec_field *f = ec_map_find(&sim.map, field);
+    char *end;
+    unsigned long offset;
+
+    if (f) {
+        field_set(f, value);
+        return 0;
+    }
+    offset = strtoul(field, &end, 0);
+    if (end == field || *end || offset > 0xFF || value > 0xFF)
+        return -1;
+    sim.ec[offset] = value;
+    return 0;
+}
+
+void sim_latch_event(uint32_t event)
+{
+    sim.evnt = event;
+}
+
+int sim_ec_read(uint8_t addr, uint8_t *val)
+{
+    sim.counts.ec_reads++;
+    wait_us(sim.ec_latency_us);
+    if (sim.ec_failures) {
+        sim.ec_failures--;
+        sim.counts.ec_failed++;
+        if (sim.verbose)
+            fprintf(stderr, "  ec_read   0x%02X %-4s failed\n", addr, field_name(addr));
+        return -EIO;
+    }
+    *val = sim.ec[addr];
+    if (sim.verbose)
+        fprintf(stderr, "  ec_read   0x%02X %-4s -> 0x%02X\n", addr, field_name(addr), *val);
+    return 0;
+}
+
+int sim_ec_write(uint8_t addr, uint8_t val)
+{
+    sim.counts.ec_writes++;
+    wait_us(sim.ec_latency_us);
+    if (sim.ec_failures) {
+        sim.ec_failures--;
+        sim.counts.ec_failed++;
+        if (sim.verbose)
+            fprintf(stderr, "  ec_write  0x%02X %-4s failed\n", addr, field_name(addr));
+        return -EIO;
+    }
+    sim.ec[addr] = val;
+    if (sim.verbose)
+        fprintf(stderr, "  ec_write  0x%02X %-4s <- 0x%02X\n", addr, field_name(addr), val);
+    return 0;
+}
+
+int sim_wmbb(uint32_t id, uint32_t arg, uint32_t *result)
+{
+    struct wmbb_behaviour *b = id < SIM_NUM_IDS ? &sim.wmbb[id] : NULL;
+    enum wmbb_action action = b ? b->action : WMBB_FAIL;
+
+    sim.counts.wmbb_calls++;
+    wait_us(sim.wmbb_latency_us);
+    *result = 0;
+    if (sim.wmbb_failures) {
+        sim.wmbb_failures--;
+        action = WMBB_FAIL;
+    }
+    switch (action) {
+    case WMBB_FAIL:
+        sim.counts.wmbb_failed++;
+        break;
+    case WMBB_CONST:
+        *result = b->value;
+        break;
+    case WMBB_EVENT:
+        //as WMBB's Return (EVNT): reading it doesn't clear it
+        *result = sim.evnt;
+        break;
+    case WMBB_EC_GET:
+        *result = field_get(b->field);
+        break;
+    case WMBB_EC_SET:
+        field_set(b->field, arg);
+        break;
+    case WMBB_STORE:
+        b->value = arg;
+        break;
+    }
+    if (sim.verbose)
+        fprintf(stderr, "  wmbb      0x%02X 0x%08X -> %s0x%X\n", id, arg,
+                action == WMBB_FAIL ? "failed " : "", *result);
+    return action == WMBB_FAIL ? -EIO : 0;
+}
+
+static const char *const action_names[] = {
+    [WMBB_FAIL] = "fail",
+    [WMBB_CONST] = "const",
+    [WMBB_EVENT] = "event",
+    [WMBB_EC_GET] = "ec-get",
+    [WMBB_EC_SET] = "ec-set",
+    [WMBB_STORE] = "store",
+};
+
+//"ID BEHAVIOUR [ARG]": 0, or -1 if malformed
+static int parse_behaviour(char *line, const char *path, unsigned line_no)
+{
+    char *words[3], *end;
+    struct wmbb_behaviour b = { 0 };
+    unsigned long id, n = 0, i;
+
+    for (line = strtok(line, " \t"); line && n < 3; line = strtok(NULL, " \t"))
+        words[n++] = line;
+    if (n == 0)
+        return 0;
+    if (line)
+        goto bad;
+    id = strtoul(words[0], &end, 0);
+    if (end == words[0] || *end || id >= SIM_NUM_IDS || n < 2)
+        goto bad;
+    for (i = 0; i < sizeof(action_names) / sizeof(action_names[0]); i++)
+        if (strcmp(words[1], action_names[i]) == 0)
+            break;
+    if (i == sizeof(action_names) / sizeof(action_names[0]))
+        goto bad;
+    b.action = i;
+    switch (b.action) {
+    case WMBB_CONST:
+        if (n != 3)
+            goto bad;
+        b.value = strtoul(words[2], &end, 0);
+        if (end == words[2] || *end)
+            goto bad;
+        break;
+    case WMBB_EC_GET:
+    case WMBB_EC_SET:
+        if (n != 3)
+            goto bad;
+        b.field = ec_map_find(&sim.map, words[2]);
+        if (b.field == NULL) {
+            fprintf(stderr, "%s:%u: no EC field %s\n", path, line_no, words[2]);
+            return -1;
+        }
+        break;
+    default:
+        if (n != 2)
+            goto bad;
+    }
+    sim.wmbb[id] = b;
+    return 0;
+
+bad:
+    fprintf(stderr, "%s:%u: expected ID fail|const VALUE|event|ec-get FIELD|ec-set FIELD|store\n",
+            path, line_no);
+    return -1;
+}
+
+int sim_load_wmbb(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256], *hash;
+    unsigned line_no = 0;
+    int ret = 0;
+
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), fp)) {
+        line_no++;
+        hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+        ret = parse_behaviour(line, path, line_no);
+    }
+    fclose(fp);
+    return ret;
+}
@@ -0,0 +1,84 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "ecmap.h"
+
+/*
+ * The firmware side of wmisim: 256 bytes of EC RAM and the WMBB method
+ * behind the CLEVO_GET GUID. The kernel shims (kernel.c) call in here for
+ * ec_read(), ec_write() and wmi_evaluate_method(), and each such call is
+ * one round trip to the firmware: it is counted, and waits for the
+ * configured latency so that wall clock benchmarks see it too.
+ */
+
+#define SIM_NUM_IDS     256     //WMBB method IDs simulated, 0x00-0xFF
+
+enum wmbb_action {
+    WMBB_FAIL,          //not handled: the call fails
+    WMBB_CONST,         //returns value
+    WMBB_EVENT,         //returns the last event latched, 0 if there was none
+    WMBB_EC_GET,        //returns an EC field
+    WMBB_EC_SET,        //writes its argument to an EC field, returns 0
+    WMBB_STORE,         //keeps its argument, returns 0
+};
+
+struct wmbb_behaviour {
+    enum wmbb_action action;
+    uint32_t value;                 //CONST: the result; STORE: the last argument
+    const struct ec_field *field;   //EC_GET, EC_SET
+};
+
+struct sim_counts {
+    unsigned long ec_reads, ec_writes;
+    unsigned long wmbb_calls, wmbb_failed;
+    unsigned long ec_failed;
+};
+
+struct sim {
+    uint8_t ec[256];
+    struct ec_map map;
+    struct wmbb_behaviour wmbb[SIM_NUM_IDS];
+    uint32_t evnt;                  //the last event, as the DSDT's EVNT
+    unsigned ec_latency_us, wmbb_latency_us;
+    unsigned ec_failures, wmbb_failures;    //the next so many calls fail
+    uint64_t firmware_us;           //latency charged so far
+    uint64_t clock_ns;              //simulated time: latencies and waits
+    struct sim_counts counts;
+    int verbose;
+    int trace;                      //print the driver's trace events
+};
+
+extern struct sim sim;
+
+/*
+ * Load the EC layout and set up WMBB as the DSDT has it (clevo-wmbb.h):
+ * the IDs it handles return 0 and the others fail. Returns 0 or -1.
+ */
+int sim_init(const char *ec_map_path);
+
+void sim_exit(void);
+
+/*
+ * Read the table of WMBB behaviours, one ID per line:
+ *
+ *     0x45    ec-get OEM2     # the keyboard brightness
+ *
+ * with fail, const VALUE, event, ec-get FIELD, ec-set FIELD or store as
+ * the behaviour. Returns 0, or -1 after printing what is wrong.
+ */
+int sim_load_wmbb(const char *path);
+
+//set an EC field, or a byte given as 0xNN, without a round trip; returns 0 or -1
+int sim_ec_poke(const char *field, uint32_t value);
+
+//latch an event for WMBB to return, as a _Qxx method sets EVNT
+void sim_latch_event(uint32_t event);
+
+//the round trips, as called by the shims; 0 or a negative errno
+int sim_ec_read(uint8_t addr, uint8_t *val);
+int sim_ec_write(uint8_t addr, uint8_t val);
+int sim_wmbb(uint32_t id, uint32_t arg, uint32_t *result);
+
+#endif
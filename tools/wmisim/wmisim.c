@@ -0,0 +1,496 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shim.h"
+#include "sim.h"
+
+/*
+ * wmisim: run src/clevo-wmi.c against a simulated EC and WMBB method, so
+ * that what the driver costs in firmware round trips can be measured on
+ * any Linux box. The driver is built against the stand-in kernel headers
+ * in include/ and linked with kernel.c; its ec_read(), ec_write() and
+ * wmi_evaluate_method() calls end up in sim.c.
+ *
+ * A script says what the user does, one action per line:
+ *
+ *     load
+ *     led-set clevo::airplane 1   = 2
+ *     event 0xF4
+ *
+ * and an action followed by = N must cost N round trips, so that a
+ * change to the driver that costs more is caught: wmisim exits with 1.
+ * = N keys K also checks that it reported K key presses.
+ */
+
+#ifndef EC_MAP
+#define EC_MAP "../../code-dump/clevo-wmi/Clevo_B7130-EC_RAM.txt"
+#endif
+#ifndef WMBB_TABLE
+#define WMBB_TABLE "wmbb.tbl"
+#endif
+
+//the notify value of the Clevo event GUID
+#define WMI_EVENT 0xD0
+
+enum action_type {
+    ACT_LOAD,
+    ACT_UNLOAD,
+    ACT_LED_SET,
+    ACT_LED_GET,
+    ACT_EVENT,
+    ACT_NOTIFY,
+    ACT_OPEN,
+    ACT_CLOSE,
+    ACT_SUSPEND,
+    ACT_RESUME,
+    ACT_EC,
+    ACT_FAIL,
+    ACT_DEBUGFS,
+    ACT_WAIT,
+    ACT_LID,
+    ACT_KEYMAP,
+};
+
+static const struct {
+    const char *name;
+    unsigned args;                  //words after the name
+} action_names[] = {
+    [ACT_LOAD] =    { "load",       0 },
+    [ACT_UNLOAD] =  { "unload",     0 },
+    [ACT_LED_SET] = { "led-set",    2 },
+    [ACT_LED_GET] = { "led-get",    1 },
+    [ACT_EVENT] =   { "event",      1 },
+    [ACT_NOTIFY] =  { "notify",     1 },
+    [ACT_OPEN] =    { "open",       0 },
+    [ACT_CLOSE] =   { "close",      0 },
+    [ACT_SUSPEND] = { "suspend",    0 },
+    [ACT_RESUME] =  { "resume",     0 },
+    [ACT_EC] =      { "ec",         1 },
+    [ACT_FAIL] =    { "fail",       2 },
+    [ACT_DEBUGFS] = { "debugfs",    1 },
+    [ACT_WAIT] =    { "wait",       1 },
+    [ACT_LID] =     { "lid",        1 },
+    [ACT_KEYMAP] =  { "keymap",     2 },
+};
+
+struct action {
+    enum action_type type;
+    char text[64];                  //as written, for the report
+    char name[32];                  //LED, EC field, "ec" or "wmbb", debugfs file
+    uint32_t value;
+    uint32_t keycode;               //keymap
+    long expect;                    //round trips, -1 if not checked
+    long expect_keys;               //key presses, -1 if not checked
+    unsigned line;
+    //summed over the runs
+    struct sim_counts counts;
+    unsigned long keys, wakeups;
+    uint64_t firmware_us, wall_ns;
+};
+
+struct script {
+    struct action *actions;
+    size_t num;
+};
+
+static void print_usage(char *prog_name)
+{
+    fprintf(stderr, "\
+Usage: %s [-E ecmap] [-W table] [-e us] [-w us] [-n runs] [-v] [-t] [script]\n", prog_name);
+    fputs("\
+Run the driver against a simulated EC and WMBB method, and count the\n\
+firmware round trips each action of the script costs (standard input\n\
+if there is no script).\n\
+\n\
+\t-E ecmap\tthe EC RAM layout (default " EC_MAP ")\n\
+\t-W table\twhat each WMBB method ID does (default " WMBB_TABLE ")\n\
+\t-e us\t\tlatency of an EC read or write, in microseconds\n\
+\t-w us\t\tlatency of a WMBB call, in microseconds\n\
+\t-n runs\t\trun the script this many times, and average the times\n\
+\t-v\t\tprint each round trip\n\
+\t-t\t\tprint the driver's trace events\n\
+\n\
+Actions: load, unload, led-set NAME VALUE, led-get NAME, event CODE\n\
+(latched for GET_EVENT and notified), notify VALUE, open and close (the input devices), suspend, resume,\n\
+ec FIELD=VALUE (set the EC RAM without a round trip), fail ec|wmbb N\n\
+(the next N calls fail), debugfs FILE (print clevo_wmi/stats, say),\n\
+wait MS (let time pass, and the driver's timers fire), lid open|close,\n\
+keymap CODE KEY (map an event to a keycode, as EVIOCSKEYCODE would). An\n\
+action followed by = N is checked to cost N, and by = N keys K also to\n\
+report K key presses.\n\
+\n", stderr);
+    exit(EXIT_FAILURE);
+}
+
+static int parse_number(const char *s, uint32_t *value)
+{
+    char *end;
+    unsigned long v;
+
+    errno = 0;
+    v = strtoul(s, &end, 0);
+    if (end == s || *end || errno || v > UINT32_MAX)
+        return -1;
+    *value = v;
+    return 0;
+}
+
+//one line of the script: 1 for an action, 0 for none, -1 if malformed
+static int parse_action(char *line, struct action *a)
+{
+    char *words[4], *eq, *end;
+    size_t n = 0, i;
+
+    memset(a, 0, sizeof(*a));
+    a->expect = -1;
+    a->expect_keys = -1;
+    eq = strchr(line, '#');
+    if (eq)
+        *eq = '\0';
+    //"= N" after a blank; ec FIELD=VALUE has none before its =
+    for (eq = strchr(line, '='); eq; eq = strchr(eq + 1, '='))
+        if (eq > line && (eq[-1] == ' ' || eq[-1] == '\t'))
+            break;
+    if (eq) {
+        *eq = '\0';
+        a->expect = strtol(eq + 1, &end, 0);
+        if (end == eq + 1 || a->expect < 0)
+            return -1;
+        while (*end == ' ' || *end == '\t')
+            end++;
+        if (strncmp(end, "keys", 4) == 0) {
+            eq = end + 4;
+            a->expect_keys = strtol(eq, &end, 0);
+            if (end == eq || a->expect_keys < 0)
+                return -1;
+            while (*end == ' ' || *end == '\t')
+                end++;
+        }
+        if (*end)
+            return -1;
+    }
+    for (line = strtok(line, " \t"); line && n < 4; line = strtok(NULL, " \t"))
+        words[n++] = line;
+    if (n == 0)
+        return a->expect < 0 ? 0 : -1;
+    for (i = 0; i < sizeof(action_names) / sizeof(action_names[0]); i++)
+        if (strcmp(words[0], action_names[i].name) == 0)
+            break;
+    if (i == sizeof(action_names) / sizeof(action_names[0]) || n != action_names[i].args + 1)
+        return -1;
+    a->type = i;
+    snprintf(a->text, sizeof(a->text), "%s%s%s%s%s", words[0], n > 1 ? " " : "",
+             n > 1 ? words[1] : "", n > 2 ? " " : "", n > 2 ? words[2] : "");
+
+    switch (a->type) {
+    case ACT_LED_SET:
+        if (parse_number(words[2], &a->value))
+            return -1;
+        //fall through
+    case ACT_LED_GET:
+    case ACT_DEBUGFS:
+        snprintf(a->name, sizeof(a->name), "%s", words[1]);
+        break;
+    case ACT_KEYMAP:
+        if (parse_number(words[1], &a->value) || parse_number(words[2], &a->keycode))
+            return -1;
+        break;
+    case ACT_FAIL:
+        if ((strcmp(words[1], "ec") && strcmp(words[1], "wmbb"))
+                || parse_number(words[2], &a->value))
+            return -1;
+        snprintf(a->name, sizeof(a->name), "%s", words[1]);
+        break;
+    case ACT_EVENT:
+    case ACT_NOTIFY:
+    case ACT_WAIT:
+        if (parse_number(words[1], &a->value))
+            return -1;
+        break;
+    case ACT_LID:
+        if (strcmp(words[1], "open") && strcmp(words[1], "close"))
+            return -1;
+        a->value = strcmp(words[1], "open") == 0;
+        break;
+    case ACT_EC:
+        eq = strchr(words[1], '=');
+        if (eq == NULL || eq - words[1] >= (long)sizeof(a->name))
+            return -1;
+        *eq = '\0';
+        snprintf(a->name, sizeof(a->name), "%s", words[1]);
+        if (parse_number(eq + 1, &a->value))
+            return -1;
+        break;
+    default:
+        break;
+    }
+    return 1;
+}
+
+static int read_script(struct script *s, FILE *fp, const char *path)
+{
+    char line[256];
+    size_t size = 0;
+    unsigned line_no = 0;
+    struct action a, *tmp;
+    int n;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        n = parse_action(line, &a);
+        if (n < 0) {
+            fprintf(stderr, "%s:%u: not an action\n", path, line_no);
+            return -1;
+        }
+        if (n == 0)
+            continue;
+        a.line = line_no;
+        if (s->num == size) {
+            size = size ? 2 * size : 32;
+            tmp = realloc(s->actions, size * sizeof(*tmp));
+            if (tmp == NULL) {
+                perror("Error allocating memory");
+                return -1;
+            }
+            s->actions = tmp;
+        }
+        s->actions[s->num++] = a;
+    }
+    if (ferror(fp)) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_action(struct action *a)
+{
+    int value, err = 0;
+
+    switch (a->type) {
+    case ACT_LOAD:
+        err = shim_load();
+        break;
+    case ACT_UNLOAD:
+        shim_unload();
+        break;
+    case ACT_LED_SET:
+        err = shim_led_set(a->name, a->value);
+        break;
+    case ACT_LED_GET:
+        err = shim_led_get(a->name, &value);
+        if (err == 0 && sim.verbose)
+            fprintf(stderr, "  %s = %d\n", a->name, value);
+        break;
+    case ACT_EVENT:
+        sim_latch_event(a->value);
+        shim_notify(WMI_EVENT);
+        break;
+    case ACT_NOTIFY:
+        shim_notify(a->value);
+        break;
+    case ACT_OPEN:
+        err = shim_input_open();
+        break;
+    case ACT_CLOSE:
+        shim_input_close();
+        break;
+    case ACT_SUSPEND:
+        err = shim_suspend();
+        break;
+    case ACT_RESUME:
+        err = shim_resume();
+        break;
+    case ACT_EC:
+        if (sim_ec_poke(a->name, a->value))
+            return -EINVAL;
+        break;
+    case ACT_FAIL:
+        if (strcmp(a->name, "ec") == 0)
+            sim.ec_failures = a->value;
+        else
+            sim.wmbb_failures = a->value;
+        break;
+    case ACT_DEBUGFS:
+        err = shim_debugfs_read(a->name);
+        break;
+    case ACT_WAIT:
+        shim_advance(a->value);
+        break;
+    case ACT_LID:
+        shim_lid(a->value);
+        break;
+    case ACT_KEYMAP:
+        err = shim_setkeycode(a->value, a->keycode);
+        break;
+    }
+    //whatever the action left to the driver's workers is part of its cost
+    shim_run_work();
+    return err;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int run_script(struct script *s)
+{
+    struct sim_counts before;
+    unsigned long keys, wakeups;
+    uint64_t fw_us, start;
+    size_t i;
+    int err;
+
+    for (i = 0; i < s->num; i++) {
+        struct action *a = &s->actions[i];
+
+        if (sim.verbose)
+            fprintf(stderr, "%u: %s\n", a->line, a->text);
+        before = sim.counts;
+        keys = shim_counts.keys;
+        wakeups = shim_counts.wakeups;
+        fw_us = sim.firmware_us;
+        start = now_ns();
+        err = run_action(a);
+        a->wall_ns += now_ns() - start;
+        a->firmware_us += sim.firmware_us - fw_us;
+        a->keys += shim_counts.keys - keys;
+        a->wakeups += shim_counts.wakeups - wakeups;
+        a->counts.ec_reads += sim.counts.ec_reads - before.ec_reads;
+        a->counts.ec_writes += sim.counts.ec_writes - before.ec_writes;
+        a->counts.wmbb_calls += sim.counts.wmbb_calls - before.wmbb_calls;
+        a->counts.wmbb_failed += sim.counts.wmbb_failed - before.wmbb_failed;
+        a->counts.ec_failed += sim.counts.ec_failed - before.ec_failed;
+        if (err) {
+            fprintf(stderr, "line %u: %s: %s\n", a->line, a->text, strerror(-err));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//print the counts per run, check them; returns how many were off
+static unsigned report(const struct script *s, unsigned runs)
+{
+    unsigned long total;
+    unsigned wrong = 0, off;
+    size_t i;
+
+    printf("%5s  %-28s %6s %6s %6s %6s %5s %5s %5s %9s %9s\n", "line", "action", "ec-rd",
+           "ec-wr", "wmbb", "trips", "fail", "keys", "wake", "fw-us", "wall-us");
+    for (i = 0; i < s->num; i++) {
+        const struct action *a = &s->actions[i];
+        const struct sim_counts *c = &a->counts;
+
+        total = (c->ec_reads + c->ec_writes + c->wmbb_calls) / runs;
+        printf("%5u  %-28s %6lu %6lu %6lu %6lu %5lu %5lu %5lu %9.1f %9.1f", a->line, a->text,
+               c->ec_reads / runs, c->ec_writes / runs, c->wmbb_calls / runs, total,
+               (c->ec_failed + c->wmbb_failed) / runs, a->keys / runs, a->wakeups / runs,
+               (double)a->firmware_us / runs, a->wall_ns / 1000.0 / runs);
+        off = 0;
+        if (a->expect >= 0 && total != (unsigned long)a->expect) {
+            printf("  expected %ld", a->expect);
+            off = 1;
+        }
+        if (a->expect_keys >= 0 && a->keys / runs != (unsigned long)a->expect_keys) {
+            printf("  expected %ld keys", a->expect_keys);
+            off = 1;
+        }
+        wrong += off;
+        putchar('\n');
+    }
+    return wrong;
+}
+
+int main(int argc, char **argv)
+{
+    const char *ec_map = EC_MAP, *table = WMBB_TABLE, *path = "standard input";
+    struct script script = { NULL, 0 };
+    unsigned runs = 1, i, wrong;
+    uint32_t ec_us = 0, wmbb_us = 0;
+    int verbose = 0, trace = 0;
+    FILE *fp = stdin;
+    int opt, ret = EXIT_FAILURE;
+
+    while ((opt = getopt(argc, argv, "E:W:e:w:n:vt")) != -1) {
+        switch (opt) {
+        case 'E':
+            ec_map = optarg;
+            break;
+        case 'W':
+            table = optarg;
+            break;
+        case 'e':
+            if (parse_number(optarg, &ec_us))
+                print_usage(argv[0]);
+            break;
+        case 'w':
+            if (parse_number(optarg, &wmbb_us))
+                print_usage(argv[0]);
+            break;
+        case 'n':
+            if (parse_number(optarg, &runs) || runs == 0)
+                print_usage(argv[0]);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 't':
+            trace = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if (argc - optind > 1)
+        print_usage(argv[0]);
+    if (argc - optind == 1) {
+        path = argv[optind];
+        fp = fopen(path, "r");
+        if (fp == NULL) {
+            perror(path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (sim_init(ec_map))
+        goto out;
+    sim.ec_latency_us = ec_us;
+    sim.wmbb_latency_us = wmbb_us;
+    sim.verbose = verbose;
+    sim.trace = trace;
+    if (sim_load_wmbb(table) || read_script(&script, fp, path))
+        goto out_sim;
+
+    for (i = 0; i < runs; i++)
+        if (run_script(&script))
+            goto out_sim;
+    wrong = report(&script, runs);
+    if (fflush(stdout) || ferror(stdout)) {
+        perror("Error writing the output");
+        goto out_sim;
+    }
+    if (wrong)
+        fprintf(stderr, "%u action%s did not cost the round trips, or report the keys, expected\n", wrong,
+                wrong == 1 ? "" : "s");
+    else
+        ret = EXIT_SUCCESS;
+
+out_sim:
+    sim_exit();
+out:
+    free(script.actions);
+    if (fp != stdin)
+        fclose(fp);
+    return ret;
+}